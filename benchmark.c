@@ -0,0 +1,611 @@
+/********************************************************************************
+* benchmark.c: Contains static variables and function definitions for the
+*              microbenchmarks of the interpreter hot paths.
+********************************************************************************/
+#include "benchmark.h"
+#include <string.h>
+#include <math.h>
+
+/********************************************************************************
+* benchmark_kernel: Structure for a benchmark kernel, assembled by a function
+*                   for specified start address.
+********************************************************************************/
+struct benchmark_kernel
+{
+   const char* name;                     /* Name of the kernel. */
+   size_t (*assemble)(uint32_t* code,
+                      const uint16_t address); /* Assembles the kernel, returns its size. */
+};
+
+/* Static functions: */
+static size_t assemble_straight_line(uint32_t* code,
+                                     const uint16_t address);
+static size_t assemble_call_ret(uint32_t* code,
+                                const uint16_t address);
+static size_t assemble_out_loop(uint32_t* code,
+                                const uint16_t address);
+static size_t assemble_st_ld(uint32_t* code,
+                             const uint16_t address);
+static size_t assemble_push_pop(uint32_t* code,
+                                const uint16_t address);
+static void measure(const struct benchmark_config* config,
+                    const size_t kernel,
+                    const enum control_unit_engine engine,
+                    struct perf_counters* counters,
+                    struct benchmark_result* result);
+static void print_counters(const struct benchmark_result* results,
+                           const size_t num_results);
+static const struct benchmark_result* find_result(const struct benchmark_result* results,
+                                                  const size_t num_results,
+                                                  const char* kernel,
+                                                  const char* engine);
+static uint16_t symbol_address(const char* name);
+static int compare_speeds(const void* a,
+                          const void* b);
+static inline uint32_t instruction(const uint8_t op_code,
+                                   const uint8_t op1,
+                                   const uint8_t op2);
+static inline uint32_t instruction_address(const uint8_t op_code,
+                                           const uint16_t address);
+
+/* Static variables: */
+static const struct benchmark_kernel kernels[] =
+{
+   { "ldi_mov",   assemble_straight_line },
+   { "call_ret",  assemble_call_ret },
+   { "out_loop",  assemble_out_loop },
+   { "st_ld",     assemble_st_ld },
+   { "push_pop",  assemble_push_pop }
+};
+
+static uint32_t saved_code[BENCHMARK_MAX_KERNEL_SIZE]; /* Program memory overwritten by the loaded kernel. */
+static size_t saved_size;                              /* Number of overwritten instructions. */
+
+/********************************************************************************
+* benchmark_kernel_count: Returns the number of benchmark kernels.
+********************************************************************************/
+size_t benchmark_kernel_count(void)
+{
+   return sizeof(kernels) / sizeof(kernels[0]);
+}
+
+/********************************************************************************
+* benchmark_kernel_name: Returns the name of the kernel at specified index.
+*
+*                        - index: Index of the kernel.
+********************************************************************************/
+const char* benchmark_kernel_name(const size_t index)
+{
+   return index < benchmark_kernel_count() ? kernels[index].name : "Unknown";
+}
+
+/********************************************************************************
+* benchmark_load_kernel: Resets the system, writes the kernel at specified
+*                        index to program memory and continues execution at
+*                        its start. The kernel is kept until
+*                        benchmark_unload_kernel is called.
+*
+*                        - index: Index of the kernel.
+********************************************************************************/
+void benchmark_load_kernel(const size_t index)
+{
+   uint32_t code[BENCHMARK_MAX_KERNEL_SIZE];
+   const size_t size = kernels[index].assemble(code, BENCHMARK_KERNEL_ADDRESS);
+
+   benchmark_unload_kernel();
+
+   for (size_t i = 0; i < size; ++i)
+   {
+      saved_code[i] = program_memory_patch((uint16_t)(BENCHMARK_KERNEL_ADDRESS + i), code[i]);
+   }
+
+   saved_size = size;
+   control_unit_set_program_counter(BENCHMARK_KERNEL_ADDRESS);
+   return;
+}
+
+/********************************************************************************
+* benchmark_unload_kernel: Restores the program memory overwritten by the
+*                          last loaded kernel and resets the system.
+********************************************************************************/
+void benchmark_unload_kernel(void)
+{
+   for (size_t i = 0; i < saved_size; ++i)
+   {
+      program_memory_patch((uint16_t)(BENCHMARK_KERNEL_ADDRESS + i), saved_code[i]);
+   }
+
+   saved_size = 0;
+   control_unit_reset();
+   return;
+}
+
+/********************************************************************************
+* benchmark_run: Runs all kernels on all execution engines and stores one
+*                result per kernel and engine, in the order of the kernels.
+*                The number of stored results is returned.
+*
+*                - config     : The benchmark parameters.
+*                - results    : Reference to storage for the results.
+*                - max_results: Max number of results to store.
+********************************************************************************/
+size_t benchmark_run(const struct benchmark_config* config,
+                     struct benchmark_result* results,
+                     const size_t max_results)
+{
+   size_t num_results = 0;
+   struct perf_counters counters;
+   perf_counters_open(&counters);
+
+   for (size_t i = 0; i < benchmark_kernel_count(); ++i)
+   {
+      for (int engine = 0; engine < CONTROL_UNIT_NUM_ENGINES && num_results < max_results; ++engine)
+      {
+         measure(config, i, (enum control_unit_engine)engine, &counters, &results[num_results++]);
+      }
+   }
+
+   perf_counters_close(&counters);
+   benchmark_unload_kernel();
+   return num_results;
+}
+
+/********************************************************************************
+* benchmark_print: Prints specified results as a table in millions of
+*                  instructions per second, with the speedup of each engine
+*                  relative to the reference engine.
+*
+*                  - results    : Reference to the results.
+*                  - num_results: The number of results.
+********************************************************************************/
+void benchmark_print(const struct benchmark_result* results,
+                     const size_t num_results)
+{
+   printf("--------------------------------------------------------------------------------\n");
+   printf("%-10s %-6s %12s %9s %8s %9s %9s %9s %8s\n", "Kernel", "Engine", "Instructions",
+          "Mean", "Stddev", "Min", "Median", "Max", "Speedup");
+
+   for (size_t i = 0; i < num_results; ++i)
+   {
+      const struct benchmark_result* self = &results[i];
+      double reference = 0.0;
+
+      for (size_t j = 0; j < num_results; ++j)
+      {
+         if (results[j].engine == CONTROL_UNIT_ENGINE_STEP && !strcmp(results[j].kernel, self->kernel))
+         {
+            reference = results[j].mean;
+         }
+      }
+
+      printf("%-10s %-6s %12llu %9.2f %8.2f %9.2f %9.2f %9.2f %7.2fx\n", self->kernel,
+             control_unit_engine_name(self->engine), (unsigned long long)self->instructions,
+             self->mean / 1e6, self->stddev / 1e6, self->min / 1e6, self->median / 1e6,
+             self->max / 1e6, reference > 0.0 ? self->mean / reference : 0.0);
+   }
+
+   printf("\nSpeeds in millions of simulated instructions per second (MIPS).\n");
+   printf("--------------------------------------------------------------------------------\n\n");
+   print_counters(results, num_results);
+   return;
+}
+
+/********************************************************************************
+* benchmark_save_baseline: Writes the median speeds of specified results to
+*                          a baseline file, one line per kernel and engine,
+*                          after a header line with the benchmark parameters.
+*                          After success, 0 is returned. If the file couldn't
+*                          be written, error code 1 is returned.
+*
+*                          - path       : Path to the baseline file.
+*                          - config     : The benchmark parameters of the results.
+*                          - results    : Reference to the results.
+*                          - num_results: The number of results.
+********************************************************************************/
+int benchmark_save_baseline(const char* path,
+                            const struct benchmark_config* config,
+                            const struct benchmark_result* results,
+                            const size_t num_results)
+{
+   FILE* file = fopen(path, "w");
+   if (!file) return 1;
+
+   fprintf(file, "# warmup_cycles %llu cycles %llu repetitions %llu\n",
+           (unsigned long long)config->warmup_cycles, (unsigned long long)config->cycles,
+           (unsigned long long)config->repetitions);
+   fprintf(file, "# kernel engine median_ips mean_ips\n");
+
+   for (size_t i = 0; i < num_results; ++i)
+   {
+      fprintf(file, "%s %s %.0f %.0f\n", results[i].kernel, control_unit_engine_name(results[i].engine),
+              results[i].median, results[i].mean);
+   }
+
+   return fclose(file) ? 1 : 0;
+}
+
+/********************************************************************************
+* benchmark_check_baseline: Compares the median speeds of specified results
+*                           with a baseline file and prints the change per
+*                           kernel and engine. A result slower than the
+*                           baseline by more than the tolerance counts as a
+*                           regression. Results missing in the baseline are
+*                           reported as new. A warning is printed if the
+*                           baseline was measured with other parameters,
+*                           since the speeds then aren't fully comparable.
+*                           After success, 0 is returned. If the baseline
+*                           couldn't be read, error code 1 is returned.
+*
+*                           - path           : Path to the baseline file.
+*                           - config         : The benchmark parameters of the results.
+*                           - results        : Reference to the results.
+*                           - num_results    : The number of results.
+*                           - tolerance      : Allowed slowdown as a fraction, e.g. 0.1.
+*                           - num_regressions: Reference to storage for the number
+*                                              of regressions.
+********************************************************************************/
+int benchmark_check_baseline(const char* path,
+                             const struct benchmark_config* config,
+                             const struct benchmark_result* results,
+                             const size_t num_results,
+                             const double tolerance,
+                             size_t* num_regressions)
+{
+   bool found[BENCHMARK_MAX_RESULTS] = { false };
+   unsigned long long warmup_cycles, cycles, repetitions;
+   char line[256];
+   char format[32];
+   FILE* file = fopen(path, "r");
+   if (!file) return 1;
+
+   snprintf(format, sizeof(format), "%%%ds %%%ds %%lf", BENCHMARK_MAX_NAME_SIZE - 1, BENCHMARK_MAX_NAME_SIZE - 1);
+
+   *num_regressions = 0;
+   printf("--------------------------------------------------------------------------------\n");
+   printf("Baseline %s, tolerance %.1f%%:\n\n", path, tolerance * 100.0);
+
+   if (!fgets(line, sizeof(line), file) ||
+       sscanf(line, "# warmup_cycles %llu cycles %llu repetitions %llu", &warmup_cycles, &cycles, &repetitions) != 3)
+   {
+      printf("Warning: The baseline doesn't record the benchmark parameters!\n\n");
+      rewind(file);
+   }
+   else if (warmup_cycles != config->warmup_cycles || cycles != config->cycles ||
+            repetitions != config->repetitions)
+   {
+      printf("Warning: The baseline was measured with %llu warmup cycles and %llu repetitions of %llu "
+             "clock cycles!\n\n", warmup_cycles, repetitions, cycles);
+   }
+
+   printf("%-10s %-6s %9s %9s %8s\n", "Kernel", "Engine", "Baseline", "Median", "Change");
+
+   while (fgets(line, sizeof(line), file))
+   {
+      char kernel[BENCHMARK_MAX_NAME_SIZE];
+      char engine[BENCHMARK_MAX_NAME_SIZE];
+      double baseline;
+
+      if (line[0] == '#' || sscanf(line, format, kernel, engine, &baseline) != 3) continue;
+
+      const struct benchmark_result* self = find_result(results, num_results, kernel, engine);
+      if (!self || baseline <= 0.0) continue;
+
+      const double change = self->median / baseline - 1.0;
+      const bool regression = change < -tolerance;
+      if (regression) (*num_regressions)++;
+      if ((size_t)(self - results) < BENCHMARK_MAX_RESULTS) found[self - results] = true;
+
+      printf("%-10s %-6s %9.2f %9.2f %+7.1f%%%s\n", kernel, engine, baseline / 1e6,
+             self->median / 1e6, change * 100.0, regression ? "  REGRESSION" : "");
+   }
+
+   for (size_t i = 0; i < num_results && i < BENCHMARK_MAX_RESULTS; ++i)
+   {
+      if (found[i]) continue;
+      printf("%-10s %-6s %9s %9.2f %8s\n", results[i].kernel, control_unit_engine_name(results[i].engine),
+             "-", results[i].median / 1e6, "new");
+   }
+
+   printf("\n%llu regressions beyond the tolerance.\n", (unsigned long long)*num_regressions);
+   printf("--------------------------------------------------------------------------------\n\n");
+   fclose(file);
+   return 0;
+}
+
+/********************************************************************************
+* measure: Runs specified kernel on specified engine, first for the warmup
+*          and then for the measured repetitions, and summarizes the speeds.
+*
+*          - config  : The benchmark parameters.
+*          - kernel  : Index of the kernel.
+*          - engine  : The execution engine.
+*          - counters: Reference to the host performance counters.
+*          - result  : Reference to storage for the result.
+********************************************************************************/
+static void measure(const struct benchmark_config* config,
+                    const size_t kernel,
+                    const enum control_unit_engine engine,
+                    struct perf_counters* counters,
+                    struct benchmark_result* result)
+{
+   double speeds[BENCHMARK_MAX_REPETITIONS];
+   const size_t repetitions = config->repetitions < 1 ? 1 :
+      config->repetitions > BENCHMARK_MAX_REPETITIONS ? BENCHMARK_MAX_REPETITIONS : config->repetitions;
+   double sum = 0.0;
+   double square_sum = 0.0;
+
+   benchmark_load_kernel(kernel);
+   control_unit_run_engine(engine, config->warmup_cycles);
+   result->instructions = 0;
+   result->total_instructions = 0;
+
+   for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+   {
+      result->counters[i] = perf_counters_available(counters, (enum perf_counter)i) ?
+         0 : PERF_COUNTERS_UNAVAILABLE;
+   }
+
+   for (size_t i = 0; i < repetitions; ++i)
+   {
+      const uint64_t start_instructions = control_unit_instruction_count();
+      const uint64_t start_time = host_time_ns();
+      perf_counters_start(counters);
+      control_unit_run_engine(engine, config->cycles);
+      perf_counters_stop(counters);
+      const uint64_t time = host_time_ns() - start_time;
+      const uint64_t instructions = control_unit_instruction_count() - start_instructions;
+
+      speeds[i] = time ? instructions * 1e9 / time : 0.0;
+      sum += speeds[i];
+      result->instructions = instructions;
+      result->total_instructions += instructions;
+      perf_counters_accumulate(counters, result->counters);
+   }
+
+   result->kernel = kernels[kernel].name;
+   result->engine = engine;
+   result->mean = sum / repetitions;
+
+   for (size_t i = 0; i < repetitions; ++i)
+   {
+      square_sum += (speeds[i] - result->mean) * (speeds[i] - result->mean);
+   }
+
+   qsort(speeds, repetitions, sizeof(speeds[0]), compare_speeds);
+   result->stddev = repetitions > 1 ? sqrt(square_sum / (repetitions - 1)) : 0.0;
+   result->min = speeds[0];
+   result->max = speeds[repetitions - 1];
+   result->median = repetitions % 2 ? speeds[repetitions / 2] :
+      (speeds[repetitions / 2 - 1] + speeds[repetitions / 2]) / 2;
+   return;
+}
+
+/********************************************************************************
+* print_counters: Prints the host performance counters of specified results
+*                 per simulated instruction, or a note if no counter was
+*                 available.
+*
+*                 - results    : Reference to the results.
+*                 - num_results: The number of results.
+********************************************************************************/
+static void print_counters(const struct benchmark_result* results,
+                           const size_t num_results)
+{
+   bool available = false;
+
+   for (size_t i = 0; i < num_results; ++i)
+   {
+      for (int j = 0; j < PERF_NUM_COUNTERS; ++j)
+      {
+         if (results[i].counters[j] != PERF_COUNTERS_UNAVAILABLE) available = true;
+      }
+   }
+
+   if (!available)
+   {
+      printf("Host performance counters not available.\n\n");
+      return;
+   }
+
+   printf("--------------------------------------------------------------------------------\n");
+   printf("%-10s %-6s", "Kernel", "Engine");
+   perf_counters_print_names();
+
+   for (size_t i = 0; i < num_results; ++i)
+   {
+      printf("%-10s %-6s", results[i].kernel, control_unit_engine_name(results[i].engine));
+      perf_counters_print_row(results[i].counters, results[i].total_instructions);
+   }
+
+   printf("\nHost events per simulated instruction, user space only.\n");
+   printf("--------------------------------------------------------------------------------\n\n");
+   return;
+}
+
+/********************************************************************************
+* find_result: Returns the result of specified kernel and engine, or a null
+*              pointer if there is none.
+*
+*              - results    : Reference to the results.
+*              - num_results: The number of results.
+*              - kernel     : Name of the kernel.
+*              - engine     : Name of the execution engine.
+********************************************************************************/
+static const struct benchmark_result* find_result(const struct benchmark_result* results,
+                                                  const size_t num_results,
+                                                  const char* kernel,
+                                                  const char* engine)
+{
+   for (size_t i = 0; i < num_results; ++i)
+   {
+      if (!strcmp(results[i].kernel, kernel) &&
+          !strcmp(control_unit_engine_name(results[i].engine), engine))
+      {
+         return &results[i];
+      }
+   }
+   return 0;
+}
+
+/********************************************************************************
+* assemble_straight_line: Assembles a kernel of alternating LDI and MOV
+*                         instructions without branches, closed by a jump
+*                         back to the start.
+*
+*                         - code   : Reference to storage for the kernel.
+*                         - address: Start address of the kernel.
+********************************************************************************/
+static size_t assemble_straight_line(uint32_t* code,
+                                     const uint16_t address)
+{
+   size_t size = 0;
+
+   for (uint8_t i = 0; i < 32; ++i)
+   {
+      code[size++] = instruction(LDI, R16 + i % 8, i);
+      code[size++] = instruction(MOV, R24 + i % 4, R16 + i % 8);
+   }
+
+   code[size++] = instruction_address(JMP, address);
+   return size;
+}
+
+/********************************************************************************
+* assemble_call_ret: Assembles a kernel calling the subroutine setup of the
+*                    program in a loop, which in turn calls init_ports and
+*                    init_registers, hence mostly CALL and RET are executed.
+*
+*                    - code   : Reference to storage for the kernel.
+*                    - address: Start address of the kernel.
+********************************************************************************/
+static size_t assemble_call_ret(uint32_t* code,
+                                const uint16_t address)
+{
+   code[0] = instruction_address(CALL, symbol_address("setup"));
+   code[1] = instruction_address(JMP, address);
+   return 2;
+}
+
+/********************************************************************************
+* assemble_out_loop: Assembles a kernel calling the subroutine led_blink of
+*                    the program in a loop, which writes PORTB with OUT.
+*
+*                    - code   : Reference to storage for the kernel.
+*                    - address: Start address of the kernel.
+********************************************************************************/
+static size_t assemble_out_loop(uint32_t* code,
+                                const uint16_t address)
+{
+   code[0] = instruction_address(CALL, symbol_address("led_blink"));
+   code[1] = instruction_address(JMP, address);
+   return 2;
+}
+
+/********************************************************************************
+* assemble_st_ld: Assembles a kernel storing and loading data memory via the
+*                 X pointer register. The pointer is set once before the loop.
+*
+*                 - code   : Reference to storage for the kernel.
+*                 - address: Start address of the kernel.
+********************************************************************************/
+static size_t assemble_st_ld(uint32_t* code,
+                             const uint16_t address)
+{
+   const uint16_t pointer = 1000;
+   size_t size = 0;
+
+   code[size++] = instruction(LDI, XL, low(pointer));
+   code[size++] = instruction(LDI, XH, high(pointer));
+
+   for (uint8_t i = 0; i < 16; ++i)
+   {
+      code[size++] = instruction(ST, XREG, R16 + i % 8);
+      code[size++] = instruction(LD, R24, XREG);
+   }
+
+   code[size++] = instruction_address(JMP, address + 2);
+   return size;
+}
+
+/********************************************************************************
+* assemble_push_pop: Assembles a kernel pushing eight CPU registers to the
+*                    stack and popping them in reverse order.
+*
+*                    - code   : Reference to storage for the kernel.
+*                    - address: Start address of the kernel.
+********************************************************************************/
+static size_t assemble_push_pop(uint32_t* code,
+                                const uint16_t address)
+{
+   size_t size = 0;
+
+   for (uint8_t i = 0; i < 8; ++i)
+   {
+      code[size++] = instruction(PUSH, R16 + i, 0x00);
+   }
+
+   for (uint8_t i = 0; i < 8; ++i)
+   {
+      code[size++] = instruction(POP, R23 - i, 0x00);
+   }
+
+   code[size++] = instruction_address(JMP, address);
+   return size;
+}
+
+/********************************************************************************
+* symbol_address: Returns the start address of the subroutine of the program
+*                 with specified name.
+*
+*                 - name: Name of the subroutine.
+********************************************************************************/
+static uint16_t symbol_address(const char* name)
+{
+   for (size_t i = 0; i < program_memory_symbol_count(); ++i)
+   {
+      if (!strcmp(program_memory_symbol_name(i), name)) return program_memory_symbol_address(i);
+   }
+   return RESET_vect;
+}
+
+/********************************************************************************
+* compare_speeds: Compares two speeds for sorting in ascending order.
+*
+*                 - a: Reference to the first speed.
+*                 - b: Reference to the second speed.
+********************************************************************************/
+static int compare_speeds(const void* a,
+                          const void* b)
+{
+   const double first = *(const double*)a;
+   const double second = *(const double*)b;
+   return (first > second) - (first < second);
+}
+
+/********************************************************************************
+* instruction: Returns instruction assembled from specified OP code and
+*              operands, see program_memory.c.
+*
+*              - op_code: OP code of the instruction.
+*              - op1    : First operand.
+*              - op2    : Second operand.
+********************************************************************************/
+static inline uint32_t instruction(const uint8_t op_code,
+                                   const uint8_t op1,
+                                   const uint8_t op2)
+{
+   return ((uint32_t)op_code << 16) | ((uint32_t)op1 << 8) | op2;
+}
+
+/********************************************************************************
+* instruction_address: Returns instruction assembled from specified OP code
+*                      and 16-bit address, for jumps and calls.
+*
+*                      - op_code: OP code of the instruction.
+*                      - address: The address in program memory.
+********************************************************************************/
+static inline uint32_t instruction_address(const uint8_t op_code,
+                                           const uint16_t address)
+{
+   return ((uint32_t)op_code << 16) | address;
+}
@@ -0,0 +1,162 @@
+/********************************************************************************
+* benchmark.h: Contains definitions and function declarations for the
+*              microbenchmarks of the interpreter hot paths. Each kernel is
+*              a small endless loop exercising one kind of instruction, which
+*              is run on every execution engine, see control_unit.h. After a
+*              warmup, the kernel is run a number of times and the speed in
+*              simulated instructions per second is summarized as mean,
+*              standard deviation, minimum, median and maximum.
+*
+*              The kernels are written to program memory above the program
+*              at BENCHMARK_KERNEL_ADDRESS and the program memory is restored
+*              afterwards. The CALL/RET and OUT kernels call the subroutines
+*              setup and led_blink of the program.
+*
+*              Where the host permits, the hardware performance counters of
+*              the host are read during the measured runs, see
+*              perf_counters.h, and reported per simulated instruction.
+*              Results can be saved to a baseline file, with one line per
+*              kernel and engine, and later runs checked against it to
+*              catch throughput regressions.
+********************************************************************************/
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+/* Include directives: */
+#include "control_unit.h"
+#include "perf_counters.h"
+
+/* Macro definitions: */
+#define BENCHMARK_KERNEL_ADDRESS 0x4000 /* Program memory address the kernels are written to. */
+#define BENCHMARK_MAX_KERNEL_SIZE 256   /* Max number of instructions per kernel. */
+#define BENCHMARK_MAX_REPETITIONS 100   /* Max number of measured runs per kernel and engine. */
+#define BENCHMARK_MAX_RESULTS     32    /* Fits one result per kernel and engine. */
+#define BENCHMARK_MAX_NAME_SIZE   32    /* Max size of kernel and engine names in baseline files. */
+
+/********************************************************************************
+* benchmark_config: Structure for the parameters of a benchmark run.
+********************************************************************************/
+struct benchmark_config
+{
+   uint64_t warmup_cycles; /* Clock cycles run before measuring. */
+   uint64_t cycles;        /* Clock cycles run per measured repetition. */
+   size_t repetitions;     /* Number of measured repetitions, max BENCHMARK_MAX_REPETITIONS. */
+};
+
+/********************************************************************************
+* benchmark_result: Structure for the summary of one kernel on one engine,
+*                   with speeds in simulated instructions per second.
+********************************************************************************/
+struct benchmark_result
+{
+   const char* kernel;              /* Name of the kernel. */
+   enum control_unit_engine engine; /* The execution engine. */
+   uint64_t instructions;           /* Instructions executed per repetition. */
+   uint64_t total_instructions;     /* Instructions executed in all repetitions. */
+   uint64_t counters[PERF_NUM_COUNTERS]; /* Host counts over all repetitions, or PERF_COUNTERS_UNAVAILABLE. */
+   double mean;                     /* Mean speed. */
+   double stddev;                   /* Sample standard deviation of the speed. */
+   double min;                      /* Lowest speed. */
+   double median;                   /* Median speed. */
+   double max;                      /* Highest speed. */
+};
+
+/********************************************************************************
+* benchmark_kernel_count: Returns the number of benchmark kernels.
+********************************************************************************/
+size_t benchmark_kernel_count(void);
+
+/********************************************************************************
+* benchmark_kernel_name: Returns the name of the kernel at specified index.
+*
+*                        - index: Index of the kernel.
+********************************************************************************/
+const char* benchmark_kernel_name(const size_t index);
+
+/********************************************************************************
+* benchmark_load_kernel: Resets the system, writes the kernel at specified
+*                        index to program memory and continues execution at
+*                        its start. The kernel is kept until
+*                        benchmark_unload_kernel is called.
+*
+*                        - index: Index of the kernel.
+********************************************************************************/
+void benchmark_load_kernel(const size_t index);
+
+/********************************************************************************
+* benchmark_unload_kernel: Restores the program memory overwritten by the
+*                          last loaded kernel and resets the system.
+********************************************************************************/
+void benchmark_unload_kernel(void);
+
+/********************************************************************************
+* benchmark_run: Runs all kernels on all execution engines and stores one
+*                result per kernel and engine, in the order of the kernels.
+*                The number of stored results is returned.
+*
+*                - config     : The benchmark parameters.
+*                - results    : Reference to storage for the results.
+*                - max_results: Max number of results to store.
+********************************************************************************/
+size_t benchmark_run(const struct benchmark_config* config,
+                     struct benchmark_result* results,
+                     const size_t max_results);
+
+/********************************************************************************
+* benchmark_print: Prints specified results as a table in millions of
+*                  instructions per second, with the speedup of each engine
+*                  relative to the reference engine, followed by the host
+*                  performance counters per simulated instruction if any
+*                  were available.
+*
+*                  - results    : Reference to the results.
+*                  - num_results: The number of results.
+********************************************************************************/
+void benchmark_print(const struct benchmark_result* results,
+                     const size_t num_results);
+
+/********************************************************************************
+* benchmark_save_baseline: Writes the median speeds of specified results to
+*                          a baseline file, one line per kernel and engine,
+*                          after a header line with the benchmark parameters.
+*                          After success, 0 is returned. If the file couldn't
+*                          be written, error code 1 is returned.
+*
+*                          - path       : Path to the baseline file.
+*                          - config     : The benchmark parameters of the results.
+*                          - results    : Reference to the results.
+*                          - num_results: The number of results.
+********************************************************************************/
+int benchmark_save_baseline(const char* path,
+                            const struct benchmark_config* config,
+                            const struct benchmark_result* results,
+                            const size_t num_results);
+
+/********************************************************************************
+* benchmark_check_baseline: Compares the median speeds of specified results
+*                           with a baseline file and prints the change per
+*                           kernel and engine. A result slower than the
+*                           baseline by more than the tolerance counts as a
+*                           regression. Results missing in the baseline are
+*                           reported as new. A warning is printed if the
+*                           baseline was measured with other parameters,
+*                           since the speeds then aren't fully comparable.
+*                           After success, 0 is returned. If the baseline
+*                           couldn't be read, error code 1 is returned.
+*
+*                           - path           : Path to the baseline file.
+*                           - config         : The benchmark parameters of the results.
+*                           - results        : Reference to the results.
+*                           - num_results    : The number of results.
+*                           - tolerance      : Allowed slowdown as a fraction, e.g. 0.1.
+*                           - num_regressions: Reference to storage for the number
+*                                              of regressions.
+********************************************************************************/
+int benchmark_check_baseline(const char* path,
+                             const struct benchmark_config* config,
+                             const struct benchmark_result* results,
+                             const size_t num_results,
+                             const double tolerance,
+                             size_t* num_regressions);
+
+#endif /* BENCHMARK_H_ */
@@ -0,0 +1,215 @@
+/********************************************************************************
+* breakpoint.c: Contains static variables and function definitions for
+*               program breakpoints. The table is small and only searched
+*               when a breakpoint is set, removed or hit, hence a linear
+*               search is used.
+********************************************************************************/
+#include "breakpoint.h"
+
+/* Static variables: */
+static struct breakpoint breakpoints[BREAKPOINT_MAX]; /* Breakpoints in the order they were set. */
+static size_t num_breakpoints;                         /* Number of breakpoints. */
+
+/********************************************************************************
+* breakpoint_set: Sets a breakpoint at specified address, replacing the
+*                 condition of an existing breakpoint at the address.
+*                 Breakpoints are kept on reset. After success, 0 is
+*                 returned. If the address is outside the program memory or
+*                 the breakpoint table is full, error code 1 is returned.
+*
+*                 - address  : Address in program memory.
+*                 - condition: Condition for stopping (null to always stop).
+*                 - temporary: Indicates if the breakpoint is removed when hit.
+********************************************************************************/
+int breakpoint_set(const uint16_t address,
+                   const struct breakpoint_condition* condition,
+                   const bool temporary)
+{
+   struct breakpoint* self = breakpoint_find(address);
+
+   if (address >= PROGRAM_MEMORY_ADDRESS_WIDTH) return 1;
+
+   if (!self)
+   {
+      if (num_breakpoints == BREAKPOINT_MAX) return 1;
+      self = &breakpoints[num_breakpoints++];
+      self->address = address;
+      self->hits = 0;
+      self->instruction = program_memory_patch(address, BREAKPOINT_INSTRUCTION);
+   }
+
+   if (condition)
+   {
+      self->condition = *condition;
+   }
+   else
+   {
+      self->condition.source = BREAKPOINT_ALWAYS;
+      self->condition.operand = 0;
+      self->condition.compare = BREAKPOINT_EQUAL;
+      self->condition.value = 0;
+   }
+
+   self->temporary = temporary;
+   return 0;
+}
+
+/********************************************************************************
+* breakpoint_remove: Removes the breakpoint at specified address and restores
+*                    the original instruction. After success, 0 is returned.
+*                    If there is no breakpoint at the address, error code 1
+*                    is returned.
+*
+*                    - address: Address in program memory.
+********************************************************************************/
+int breakpoint_remove(const uint16_t address)
+{
+   struct breakpoint* self = breakpoint_find(address);
+   if (!self) return 1;
+
+   program_memory_patch(address, self->instruction);
+
+   for (struct breakpoint* i = self; i + 1 < breakpoints + num_breakpoints; ++i)
+   {
+      *i = *(i + 1);
+   }
+
+   num_breakpoints--;
+   return 0;
+}
+
+/********************************************************************************
+* breakpoint_clear: Removes all breakpoints.
+********************************************************************************/
+void breakpoint_clear(void)
+{
+   while (num_breakpoints)
+   {
+      breakpoint_remove(breakpoints[num_breakpoints - 1].address);
+   }
+   return;
+}
+
+/********************************************************************************
+* breakpoint_find: Returns the breakpoint at specified address, or null if
+*                  there is none.
+*
+*                  - address: Address in program memory.
+********************************************************************************/
+struct breakpoint* breakpoint_find(const uint16_t address)
+{
+   for (size_t i = 0; i < num_breakpoints; ++i)
+   {
+      if (breakpoints[i].address == address) return &breakpoints[i];
+   }
+   return 0;
+}
+
+/********************************************************************************
+* breakpoint_count: Returns the number of breakpoints.
+********************************************************************************/
+size_t breakpoint_count(void)
+{
+   return num_breakpoints;
+}
+
+/********************************************************************************
+* breakpoint_get: Returns the breakpoint at specified index, in the order the
+*                 breakpoints were set.
+*
+*                 - index: Index of the breakpoint, below breakpoint_count().
+********************************************************************************/
+const struct breakpoint* breakpoint_get(const size_t index)
+{
+   return &breakpoints[index];
+}
+
+/********************************************************************************
+* breakpoint_original_instruction: Returns the instruction at specified
+*                                  address as written by the program, i.e.
+*                                  the original instruction if a breakpoint
+*                                  is set at the address.
+*
+*                                  - address: Address in program memory.
+********************************************************************************/
+uint32_t breakpoint_original_instruction(const uint16_t address)
+{
+   const struct breakpoint* self = breakpoint_find(address & (PROGRAM_MEMORY_ADDRESS_WIDTH - 1));
+   return self ? self->instruction : program_memory_read(address);
+}
+
+/********************************************************************************
+* breakpoint_condition_met: Indicates if the condition of specified breakpoint
+*                           is met. Data memory is read without I/O hooks and
+*                           watchpoints.
+*
+*                           - self: Reference to the breakpoint.
+*                           - reg : The CPU registers R0 - R31.
+********************************************************************************/
+bool breakpoint_condition_met(const struct breakpoint* self,
+                              const uint8_t* reg)
+{
+   const struct breakpoint_condition* condition = &self->condition;
+   uint8_t operand;
+
+   if (condition->source == BREAKPOINT_REGISTER && condition->operand < CPU_REGISTER_ADDRESS_WIDTH)
+   {
+      operand = reg[condition->operand];
+   }
+   else if (condition->source == BREAKPOINT_DATA && condition->operand < DATA_MEMORY_ADDRESS_WIDTH)
+   {
+      operand = data_memory_content[condition->operand];
+   }
+   else
+   {
+      return true;
+   }
+
+   if (condition->compare == BREAKPOINT_EQUAL)          return operand == condition->value;
+   else if (condition->compare == BREAKPOINT_NOT_EQUAL) return operand != condition->value;
+   else if (condition->compare == BREAKPOINT_LOWER)     return operand < condition->value;
+   else                                                 return operand > condition->value;
+}
+
+/********************************************************************************
+* breakpoint_print: Prints all breakpoints with conditions and hit counts.
+********************************************************************************/
+void breakpoint_print(void)
+{
+   static const char* comparisons[] = { "==", "!=", "<", ">" };
+   char assembly[32];
+
+   printf("--------------------------------------------------------------------------------\n");
+
+   if (!num_breakpoints)
+   {
+      printf("No breakpoints are set!\n");
+   }
+
+   for (size_t i = 0; i < num_breakpoints; ++i)
+   {
+      const struct breakpoint* self = &breakpoints[i];
+      const struct breakpoint_condition* condition = &self->condition;
+
+      cpu_disassemble(self->instruction, assembly, sizeof(assembly));
+      printf("Breakpoint at address %-5hu %-16s %-20s hits %llu", self->address,
+             program_memory_subroutine_name(self->address), assembly,
+             (unsigned long long)self->hits);
+
+      if (condition->source == BREAKPOINT_REGISTER)
+      {
+         printf(", if R%hu %s %hu", condition->operand, comparisons[condition->compare],
+                (uint16_t)condition->value);
+      }
+      else if (condition->source == BREAKPOINT_DATA)
+      {
+         printf(", if [%hu] %s %hu", condition->operand, comparisons[condition->compare],
+                (uint16_t)condition->value);
+      }
+
+      printf(self->temporary ? " (temporary)\n" : "\n");
+   }
+
+   printf("--------------------------------------------------------------------------------\n\n");
+   return;
+}
@@ -0,0 +1,147 @@
+/********************************************************************************
+* breakpoint.h: Contains definitions and function declarations for program
+*               breakpoints. A breakpoint is set by replacing the instruction
+*               at its address in program memory with the BRK marker, while
+*               the original instruction is kept in the breakpoint table.
+*               Hence the CPU doesn't compare the program counter against
+*               the breakpoints; only the execution of a marker, dispatched
+*               like any other instruction, looks up the breakpoint and
+*               evaluates its condition.
+********************************************************************************/
+#ifndef BREAKPOINT_H_
+#define BREAKPOINT_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "program_memory.h"
+#include "data_memory.h"
+
+/* Macro definitions: */
+#define BREAKPOINT_MAX          32                          /* Max number of breakpoints. */
+#define BREAKPOINT_INSTRUCTION  ((uint32_t)BRK << 16)       /* Marker stored in program memory. */
+
+/********************************************************************************
+* breakpoint_source: Enumeration for the operand compared by the condition of
+*                    a breakpoint.
+********************************************************************************/
+enum breakpoint_source
+{
+   BREAKPOINT_ALWAYS,   /* No condition, the breakpoint stops every time. */
+   BREAKPOINT_REGISTER, /* Compares a CPU register. */
+   BREAKPOINT_DATA      /* Compares a data memory location. */
+};
+
+/********************************************************************************
+* breakpoint_compare: Enumeration for the comparisons of a condition.
+********************************************************************************/
+enum breakpoint_compare
+{
+   BREAKPOINT_EQUAL,     /* Operand == value. */
+   BREAKPOINT_NOT_EQUAL, /* Operand != value. */
+   BREAKPOINT_LOWER,     /* Operand < value. */
+   BREAKPOINT_GREATER    /* Operand > value. */
+};
+
+/********************************************************************************
+* breakpoint_condition: Structure for the condition of a breakpoint, which is
+*                       evaluated before the instruction at the breakpoint is
+*                       executed.
+********************************************************************************/
+struct breakpoint_condition
+{
+   enum breakpoint_source source;   /* The compared operand. */
+   uint16_t operand;                /* CPU register or data memory address. */
+   enum breakpoint_compare compare; /* The comparison. */
+   uint8_t value;                   /* The value compared against. */
+};
+
+/********************************************************************************
+* breakpoint: Structure for a breakpoint.
+********************************************************************************/
+struct breakpoint
+{
+   uint16_t address;                      /* Address of the breakpoint in program memory. */
+   uint32_t instruction;                  /* The original instruction at the address. */
+   struct breakpoint_condition condition; /* Condition for stopping. */
+   bool temporary;                        /* Indicates if the breakpoint is removed when hit. */
+   uint64_t hits;                         /* Number of times the breakpoint stopped the CPU. */
+};
+
+/********************************************************************************
+* breakpoint_set: Sets a breakpoint at specified address, replacing the
+*                 condition of an existing breakpoint at the address.
+*                 Breakpoints are kept on reset. After success, 0 is
+*                 returned. If the address is outside the program memory or
+*                 the breakpoint table is full, error code 1 is returned.
+*
+*                 - address  : Address in program memory.
+*                 - condition: Condition for stopping (null to always stop).
+*                 - temporary: Indicates if the breakpoint is removed when hit.
+********************************************************************************/
+int breakpoint_set(const uint16_t address,
+                   const struct breakpoint_condition* condition,
+                   const bool temporary);
+
+/********************************************************************************
+* breakpoint_remove: Removes the breakpoint at specified address and restores
+*                    the original instruction. After success, 0 is returned.
+*                    If there is no breakpoint at the address, error code 1
+*                    is returned.
+*
+*                    - address: Address in program memory.
+********************************************************************************/
+int breakpoint_remove(const uint16_t address);
+
+/********************************************************************************
+* breakpoint_clear: Removes all breakpoints.
+********************************************************************************/
+void breakpoint_clear(void);
+
+/********************************************************************************
+* breakpoint_find: Returns the breakpoint at specified address, or null if
+*                  there is none.
+*
+*                  - address: Address in program memory.
+********************************************************************************/
+struct breakpoint* breakpoint_find(const uint16_t address);
+
+/********************************************************************************
+* breakpoint_count: Returns the number of breakpoints.
+********************************************************************************/
+size_t breakpoint_count(void);
+
+/********************************************************************************
+* breakpoint_get: Returns the breakpoint at specified index, in the order the
+*                 breakpoints were set.
+*
+*                 - index: Index of the breakpoint, below breakpoint_count().
+********************************************************************************/
+const struct breakpoint* breakpoint_get(const size_t index);
+
+/********************************************************************************
+* breakpoint_original_instruction: Returns the instruction at specified
+*                                  address as written by the program, i.e.
+*                                  the original instruction if a breakpoint
+*                                  is set at the address.
+*
+*                                  - address: Address in program memory.
+********************************************************************************/
+uint32_t breakpoint_original_instruction(const uint16_t address);
+
+/********************************************************************************
+* breakpoint_condition_met: Indicates if the condition of specified breakpoint
+*                           is met. Data memory is read without I/O hooks and
+*                           watchpoints.
+*
+*                           - self: Reference to the breakpoint.
+*                           - reg : The CPU registers R0 - R31.
+********************************************************************************/
+bool breakpoint_condition_met(const struct breakpoint* self,
+                              const uint8_t* reg);
+
+/********************************************************************************
+* breakpoint_print: Prints all breakpoints with conditions and hit counts.
+********************************************************************************/
+void breakpoint_print(void);
+
+#endif /* BREAKPOINT_H_ */
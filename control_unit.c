@@ -1,216 +1,1424 @@
-/********************************************************************************
-* control_unit.c: Contains static variables and function definitions for 
-*                 implementation of an 8-bit control unit.
-********************************************************************************/
-#include "control_unit.h"
-
-/* Static variables: */
-static uint32_t ir; /* Instruction register, stores next instruction to execute. */
-static uint8_t pc;  /* Program counter, stores address to next instruction to fetch. */
-static uint8_t mar; /* Memory address register, stores address for current instruction. */
-static uint8_t sr;  /* Status register, stores status bits ISNZVC. */
-
-static uint8_t op_code; /* Stores OP-code, for example LDI, OUT, JMP etc. */
-static uint8_t op1;     /* Stores first operand, most often a destination. */
-static uint8_t op2;     /* Stores second operand, most often a value or read address. */
-
-static enum cpu_state state;                    /* Stores current state. */
-static uint8_t reg[CPU_REGISTER_ADDRESS_WIDTH]; /* CPU-registers R0 - R31. */
-
-/********************************************************************************
-* control_unit_reset: Resets control unit registers and corresponding program.
-********************************************************************************/
-void control_unit_reset(void)
-{
-   ir = 0x00;
-   pc = 0x00;
-   mar = 0x00;
-   sr = 0x00;
-
-   op_code = 0x00;
-   op1 = 0x00;
-   op2 = 0x00;
-
-   state = CPU_STATE_FETCH;
-
-   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; ++i)
-   {
-      reg[i] = 0x00;
-   }
-
-   data_memory_reset();
-   stack_reset();
-   program_memory_write();
-   return;
-}
-
-/********************************************************************************
-* control_unit_run_next_state: Runs next state in the CPU instruction cycle:
-********************************************************************************/
-void control_unit_run_next_state(void)
-{
-   switch (state)
-   {
-      case CPU_STATE_FETCH:
-      {
-         ir = program_memory_read(pc); /* Fetches next instruction. */
-         mar = pc;                     /* Stores address of current instruction. */
-         pc++;                         /* Program counter points to next instruction. */
-         state = CPU_STATE_DECODE;     /* Decodes the instruction during next clock cycle. */
-         break;
-      }
-      case CPU_STATE_DECODE:
-      {        
-         op_code = ir >> 16;           /* Bit 23 downto 16 consists of the OP code. */
-         op1 = ir >> 8;                /* Bit 15 downto 8 consists of the first operand. */
-         op2 = ir;                     /* Bit 7 downto 0 consists of the second operand. */
-         state = CPU_STATE_EXECUTE;    /* Executes the instruction during next clock cycle. */
-         break;
-      }
-      case CPU_STATE_EXECUTE:
-      {
-         switch (op_code) /* Checks the OP code.*/
-         {
-         case NOP: /* NOP => do nothing. */
-         {
-            break; 
-         }
-         case LDI: /* LDI R16, 0x01 => op_code = LDI, op1 = R16, op2 = 0x01 */
-         {
-            reg[op1] = op2; 
-            break;
-         }
-         case MOV: /* MOV R17, R16 => op_code = MOV, op1 = R17, op2 = R16 */
-         {
-            reg[op1] = reg[op2]; 
-            break;
-         }
-         case OUT: /* OUT DDRB, R16 => op_code = OUT, op1 = DDRB, op2 = R16 */
-         {
-            data_memory_write(op1, reg[op2]);
-            break;
-         }
-         case IN: /* IN R16, PINB => op_code = IN, op1 = R16, op2 = PINB */
-         {
-            reg[op1] = data_memory_read(op2);
-            break;
-         }
-         case STS: /* STS counter, R16 => op_code = STS, op1 = counter, op2 = R16 */
-         {
-            data_memory_write(op1 + 256, reg[op2]);
-            break;
-         }
-         case LDS: /* LDS R16, counter => op_code = LDS, op1 = R16, op2 = counter */
-         {
-            reg[op1] = data_memory_read(op2 + 256);
-            break;
-         }
-         case JMP: /* JMP 0x05 => op_code = JMP, op1 = 0x05 */
-         {
-            pc = op1; 
-            break;
-         }
-         case CALL: /* CALL 0x10 => op_code = CALL, op1 = 0x10 */
-         {
-            stack_push(pc); /* Pushes the return address to the stack. */
-            pc = op1;       /* Assigns the address of the subroutine to be called. */
-            break;
-         }
-         case RET: /* RET => op_code = RET */
-         {
-            pc = stack_pop(); /* Pops the return address from the stack. */
-            break;
-         }
-         case PUSH: /* PUSH R16 => op_code = PUSH, op1 = R16 */
-         {
-            stack_push(reg[op1]); /* Pushes content of specified CPU register to the stack. */
-            break;
-         }
-         case POP: /* POP R16 => op_code = POP, op1 = R16 */
-         {
-            reg[op1] = stack_pop(); /* Pops content of the stack to specified CPU register. */
-            break;
-         }
-         case ST: /* ST XREG, R16 => op_code = ST, op1 = XREG, op2 = R16 */
-         {
-            data_memory_write((reg[op1 + 1] << 8) | reg[op1], reg[op2]);
-            break;
-         }
-         case LD: /* LD R16, XREG => op_code = LD, op1 = R16, op2 = XREG */
-         {
-            reg[op1] = data_memory_read((reg[op2 + 1] << 8) | reg[op2]);
-            break;
-         }
-         default:
-         {
-            control_unit_reset(); /* System reset if error occurs. */
-            break;
-         }
-         }
-
-         state = CPU_STATE_FETCH; /* Fetches next instruction during next clock cycle. */
-         break;
-      }
-      default: /* System reset if error occurs. */
-      {
-         control_unit_reset();
-         break;
-      }
-   }
-   return;
-}
-
-/********************************************************************************
-* control_unit_run_next_state: Runs next CPU instruction cycle, i.e. fetches
-*                              a new instruction from program memory, decodes
-*                              and executes it.
-********************************************************************************/
-void control_unit_run_next_instruction_cycle(void)
-{
-   do
-   {
-      control_unit_run_next_state();
-   } while (state != CPU_STATE_EXECUTE);
-   return;
-}
-
-/********************************************************************************
-* control_unit_print: Prints information about the processor, for instance
-*                     current subroutine, instruction, state, content in
-*                     CPU-registers and I/O registers DDRB, PORTB and PINB.
-********************************************************************************/
-void control_unit_print(void)
-{
-   printf("--------------------------------------------------------------------------------\n");
-   printf("Current subroutine:\t\t\t\t%s\n", program_memory_subroutine_name(mar));
-   printf("Current instruction:\t\t\t\t%s\n", cpu_instruction_name(op_code));
-   printf("Current state:\t\t\t\t\t%s\n", cpu_state_name(state));
-
-   printf("Program counter:\t\t\t\t%hu\n", pc);
-   printf("Stack pointer:\t\t\t\t\t%hu\n", stack_pointer());
-   printf("Value last added to the stack:\t\t\t%hu\n\n", stack_last_added_value());
-
-   printf("Instruction register:\t\t\t\t%s ", get_binary((ir >> 16) & 0xFF, 8));
-   printf("%s ", get_binary((ir >> 8) & 0xFF, 8));
-   printf("%s\n", get_binary(ir & 0xFF, 8));
-
-   printf("Status register (ISNZVC):\t\t\t%s\n\n", get_binary(sr, 6));
-
-   printf("Content in CPU register R16:\t\t\t%s\n", get_binary(reg[R16], 8));
-   printf("Content in CPU register R17:\t\t\t%s\n", get_binary(reg[R17], 8));
-   printf("Content in CPU register R18:\t\t\t%s\n", get_binary(reg[R18], 8));
-   printf("Content in CPU register R24:\t\t\t%s\n\n", get_binary(reg[R24], 8));
-
-   printf("Content in X pointer register:\t\t\t%hu\n", (reg[XH] << 8) | reg[XL]);
-   printf("Content in Y pointer register:\t\t\t%hu\n", (reg[YH] << 8) | reg[YL]);
-   printf("Content in Z pointer register:\t\t\t%hu\n\n", (reg[ZH] << 8) | reg[ZL]);
-
-   printf("Content in data direction register DDRB:\t%s\n", get_binary(data_memory_read(DDRB), 8));
-   printf("Content in data register PORTB:\t\t\t%s\n", get_binary(data_memory_read(PORTB), 8));
-   printf("Content in pin input register PINB:\t\t%s\n", get_binary(data_memory_read(PINB), 8));
-
-   printf("--------------------------------------------------------------------------------\n\n");
-   return;
-}
-
-
+/********************************************************************************
+* control_unit.c: Contains static variables and function definitions for 
+*                 implementation of an 8-bit control unit.
+********************************************************************************/
+#include "control_unit.h"
+#include <string.h>
+
+/* Static variables: */
+static uint32_t ir;  /* Instruction register, stores next instruction to execute. */
+static uint16_t pc;  /* Program counter, stores address to next instruction to fetch. */
+static uint16_t mar; /* Memory address register, stores address for current instruction. */
+static uint8_t sr;   /* Status register, stores status bits ISNZVC. */
+
+static uint8_t op_code; /* Stores OP-code, for example LDI, OUT, JMP etc. */
+static uint8_t op1;     /* Stores first operand, most often a destination. */
+static uint8_t op2;     /* Stores second operand, most often a value or read address. */
+
+static enum cpu_state state;                    /* Stores current state. */
+static uint8_t reg[CPU_REGISTER_ADDRESS_WIDTH]; /* CPU-registers R0 - R31. */
+
+static uint64_t cycles;       /* Number of clock cycles elapsed since last reset. */
+static uint64_t instructions; /* Number of instructions executed since last reset. */
+static uint64_t run_cycles;   /* Number of clock cycles elapsed during continuous runs. */
+static uint64_t run_time_ns;  /* Host time spent on continuous runs in nanoseconds. */
+
+static enum control_unit_engine selected_engine = CONTROL_UNIT_ENGINE_RUN; /* Engine of control_unit_run. */
+static struct perf_counters perf;                                         /* Host counters of continuous runs. */
+static bool perf_enabled;                                                 /* Indicates if the counters are open. */
+static uint64_t perf_totals[CONTROL_UNIT_NUM_ENGINES][PERF_NUM_COUNTERS]; /* Host counts per engine. */
+static uint64_t perf_instructions[CONTROL_UNIT_NUM_ENGINES];             /* Instructions counted per engine. */
+
+static uint64_t next_event_cycle; /* Clock cycle of next event in the event queue. */
+
+#if CONTROL_UNIT_EXECUTION_COUNTERS
+static uint64_t opcode_counts[256];                           /* Number of executions per OP code. */
+static uint64_t address_counts[PROGRAM_MEMORY_ADDRESS_WIDTH]; /* Number of executions per program address. */
+#endif
+
+static enum cpu_stop_reason stop_reason;         /* Reason the CPU stopped, if stopped. */
+static bool reset_pending;                       /* Indicates if a trap requested a reset. */
+static enum stack_trap_policy stack_trap_policy; /* Action taken on stack faults, ignored by default. */
+static struct control_unit_exception exception;  /* Context of the last exception. */
+static struct control_unit_watch_hit watch_hit;  /* Last access to a watched address. */
+static bool tracing;                             /* Indicates if executed instructions are traced. */
+static bool skip_breakpoint;                     /* Indicates if the breakpoint at skip_address is passed once. */
+static uint16_t skip_address;                    /* Address of the breakpoint the CPU stopped at. */
+static bool entering_interrupt;                  /* Indicates if the return address of an interrupt is pushed. */
+
+/* Static functions: */
+static inline void fetch(void);
+static inline void decode(void);
+static void execute(void);
+static void execute_breakpoint(void);
+static void enter_interrupt(const uint8_t vector);
+static inline void push_address(const uint16_t address);
+static inline uint16_t pop_address(void);
+static void handle_stack_trap(const enum stack_fault fault,
+                              const uint16_t sp);
+static void capture_return_address(void);
+static void stop(const enum cpu_stop_reason reason);
+static inline void resume(void);
+static inline void refresh_next_event(void);
+static void handle_watch(const uint16_t address,
+                         const uint8_t value,
+                         const uint8_t access);
+static inline uint16_t access_address(void);
+static void trace_instruction(void);
+static void trace_interrupt(const uint8_t vector);
+#if CONTROL_UNIT_EXECUTION_COUNTERS
+static int compare_opcode_counts(const void* a,
+                                 const void* b);
+static int compare_address_counts(const void* a,
+                                  const void* b);
+#endif
+static void service_events(void);
+static void run_fused(const uint64_t num_cycles);
+static void run_states(const uint64_t num_cycles);
+static void add_perf_counts(const enum control_unit_engine engine,
+                            const uint64_t num_instructions);
+
+/********************************************************************************
+* control_unit_reset: Resets control unit registers and corresponding program.
+********************************************************************************/
+void control_unit_reset(void)
+{
+   vcd_reset();
+   profiler_reset();
+
+   ir = 0x00;
+   pc = 0x00;
+   mar = 0x00;
+   sr = 0x00;
+
+   op_code = 0x00;
+   op1 = 0x00;
+   op2 = 0x00;
+
+   state = CPU_STATE_FETCH;
+
+   stop_reason = CPU_STOP_NONE;
+   skip_breakpoint = false;
+   reset_pending = false;
+
+#if CONTROL_UNIT_EXECUTION_COUNTERS
+   memset(opcode_counts, 0, sizeof(opcode_counts));
+   memset(address_counts, 0, sizeof(address_counts));
+#endif
+
+   cycles = 0;
+   instructions = 0;
+   run_cycles = 0;
+   run_time_ns = 0;
+
+   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; ++i)
+   {
+      reg[i] = 0x00;
+   }
+
+   event_queue_reset();
+   data_memory_reset();
+   timer_reset();
+   uart_reset();
+   stack_reset();
+   stack_set_trap_handler(handle_stack_trap);
+   data_memory_set_watch_handler(handle_watch);
+   program_memory_write();
+   next_event_cycle = event_queue_next_cycle();
+   if (tracing) trace_restart();
+   return;
+}
+
+/********************************************************************************
+* control_unit_run_next_state: Runs next state in the CPU instruction cycle:
+********************************************************************************/
+void control_unit_run_next_state(void)
+{
+   resume();
+   if (stop_reason) return;
+
+   switch (state)
+   {
+      case CPU_STATE_FETCH:
+      {
+         fetch();
+         state = CPU_STATE_DECODE; /* Decodes the instruction during next clock cycle. */
+         break;
+      }
+      case CPU_STATE_DECODE:
+      {
+         decode();
+         state = CPU_STATE_EXECUTE; /* Executes the instruction during next clock cycle. */
+         break;
+      }
+      case CPU_STATE_EXECUTE:
+      {
+         execute();
+         service_events();
+         state = CPU_STATE_FETCH; /* Fetches next instruction during next clock cycle. */
+         if (reset_pending) control_unit_reset();
+         break;
+      }
+      default: /* System reset if error occurs. */
+      {
+         control_unit_reset();
+         break;
+      }
+   }
+   return;
+}
+
+/********************************************************************************
+* control_unit_run_next_state: Runs next CPU instruction cycle, i.e. fetches
+*                              a new instruction from program memory, decodes
+*                              and executes it.
+********************************************************************************/
+void control_unit_run_next_instruction_cycle(void)
+{
+   do
+   {
+      control_unit_run_next_state();
+   } while (state != CPU_STATE_EXECUTE && !stop_reason);
+   return;
+}
+
+/********************************************************************************
+* control_unit_run: Runs complete instruction cycles until at least specified
+*                   number of clock cycles have elapsed with the engine
+*                   selected via control_unit_set_engine, by default the
+*                   fused fetch, decode and execute loop. An instruction
+*                   cycle in progress is completed first. The host time
+*                   spent is accumulated for the timing statistics.
+*
+*                   - num_cycles: The number of clock cycles to run.
+********************************************************************************/
+void control_unit_run(const uint64_t num_cycles)
+{
+   control_unit_run_engine(selected_engine, num_cycles);
+   return;
+}
+
+/********************************************************************************
+* control_unit_run_engine: Runs complete instruction cycles with specified
+*                          execution engine until at least specified number
+*                          of clock cycles have elapsed or the CPU stops.
+*                          The host time spent and, if enabled, the host
+*                          performance counters are accumulated.
+*
+*                          - engine    : The execution engine.
+*                          - num_cycles: The number of clock cycles to run.
+********************************************************************************/
+void control_unit_run_engine(const enum control_unit_engine engine,
+                             const uint64_t num_cycles)
+{
+   const uint64_t start_time = host_time_ns();
+   const uint64_t start_cycle = cycles;
+   const uint64_t start_instructions = instructions;
+
+   if (perf_enabled) perf_counters_start(&perf);
+
+   if (engine == CONTROL_UNIT_ENGINE_STEP) run_states(num_cycles);
+   else run_fused(num_cycles);
+
+   if (perf_enabled)
+   {
+      perf_counters_stop(&perf);
+      add_perf_counts(engine, instructions >= start_instructions ? instructions - start_instructions : 0);
+   }
+
+   if (cycles >= start_cycle) run_cycles += cycles - start_cycle;
+   run_time_ns += host_time_ns() - start_time;
+   return;
+}
+
+/********************************************************************************
+* control_unit_set_engine: Selects the execution engine of control_unit_run.
+*                          The selection is kept on reset.
+*
+*                          - engine: The execution engine.
+********************************************************************************/
+void control_unit_set_engine(const enum control_unit_engine engine)
+{
+   if (engine < CONTROL_UNIT_NUM_ENGINES) selected_engine = engine;
+   return;
+}
+
+/********************************************************************************
+* control_unit_engine: Returns the execution engine of control_unit_run.
+********************************************************************************/
+enum control_unit_engine control_unit_engine(void)
+{
+   return selected_engine;
+}
+
+/********************************************************************************
+* control_unit_engine_name: Returns the name of specified execution engine.
+*
+*                           - engine: The execution engine.
+********************************************************************************/
+const char* control_unit_engine_name(const enum control_unit_engine engine)
+{
+   if (engine == CONTROL_UNIT_ENGINE_STEP)     return "step";
+   else if (engine == CONTROL_UNIT_ENGINE_RUN) return "run";
+   else return "Unknown";
+}
+
+/********************************************************************************
+* control_unit_run_until: Runs until the instruction at specified address is
+*                         reached, another stop occurs or specified number of
+*                         clock cycles have elapsed. A temporary breakpoint is
+*                         set at the address unless a breakpoint already
+*                         exists. If the address was reached, 0 is returned,
+*                         otherwise 1.
+*
+*                         - address   : Address in program memory.
+*                         - max_cycles: Max number of clock cycles to run.
+********************************************************************************/
+int control_unit_run_until(const uint16_t address,
+                           const uint64_t max_cycles)
+{
+   const bool temporary = !breakpoint_find(address);
+   if (temporary && breakpoint_set(address, 0, true)) return 1;
+
+   control_unit_run(max_cycles);
+
+   if (temporary) breakpoint_remove(address); /* Not reached, otherwise already removed. */
+   return !(stop_reason == CPU_STOP_BREAKPOINT && pc == address);
+}
+
+/********************************************************************************
+* control_unit_cycle_count: Returns the number of clock cycles elapsed since
+*                           last reset.
+********************************************************************************/
+uint64_t control_unit_cycle_count(void)
+{
+   return cycles;
+}
+
+/********************************************************************************
+* control_unit_instruction_count: Returns the number of instructions executed
+*                                 since last reset.
+********************************************************************************/
+uint64_t control_unit_instruction_count(void)
+{
+   return instructions;
+}
+
+/********************************************************************************
+* control_unit_run_cycle_count: Returns the number of clock cycles elapsed
+*                               during continuous runs since last reset.
+********************************************************************************/
+uint64_t control_unit_run_cycle_count(void)
+{
+   return run_cycles;
+}
+
+/********************************************************************************
+* control_unit_run_time_ns: Returns the host time spent on continuous runs
+*                           since last reset in nanoseconds.
+********************************************************************************/
+uint64_t control_unit_run_time_ns(void)
+{
+   return run_time_ns;
+}
+
+/********************************************************************************
+* control_unit_opcode_count: Returns the number of executions of specified OP
+*                            code since last reset, which is always 0 if the
+*                            execution counters are compiled out via
+*                            CONTROL_UNIT_EXECUTION_COUNTERS.
+*
+*                            - op_code: The OP code.
+********************************************************************************/
+uint64_t control_unit_opcode_count(const uint8_t op_code)
+{
+#if CONTROL_UNIT_EXECUTION_COUNTERS
+   return opcode_counts[op_code];
+#else
+   (void)op_code;
+   return 0;
+#endif
+}
+
+/********************************************************************************
+* control_unit_register: Returns the content of specified CPU register, or 0
+*                        if the index is invalid.
+*
+*                        - index: Index of the CPU register (0 - 31).
+********************************************************************************/
+uint8_t control_unit_register(const uint8_t index)
+{
+   return index < CPU_REGISTER_ADDRESS_WIDTH ? reg[index] : 0;
+}
+
+/********************************************************************************
+* control_unit_set_register: Writes specified value to specified CPU
+*                            register. Nothing is done if the index is
+*                            invalid.
+*
+*                            - index: Index of the CPU register (0 - 31).
+*                            - value: The new content of the register.
+********************************************************************************/
+void control_unit_set_register(const uint8_t index,
+                               const uint8_t value)
+{
+   if (index < CPU_REGISTER_ADDRESS_WIDTH) reg[index] = value;
+   return;
+}
+
+/********************************************************************************
+* control_unit_status_register: Returns the content of the status register.
+********************************************************************************/
+uint8_t control_unit_status_register(void)
+{
+   return sr;
+}
+
+/********************************************************************************
+* control_unit_set_status_register: Writes specified value to the status
+*                                   register.
+*
+*                                   - value: The new content of the register.
+********************************************************************************/
+void control_unit_set_status_register(const uint8_t value)
+{
+   sr = value;
+   return;
+}
+
+/********************************************************************************
+* control_unit_program_counter: Returns the address of the next instruction
+*                               to execute. For an instruction cycle in
+*                               progress, the address of its instruction is
+*                               returned.
+********************************************************************************/
+uint16_t control_unit_program_counter(void)
+{
+   return state == CPU_STATE_FETCH ? pc : mar;
+}
+
+/********************************************************************************
+* control_unit_set_program_counter: Continues execution at specified address.
+*                                   An instruction cycle in progress is
+*                                   abandoned.
+*
+*                                   - address: Address in program memory.
+********************************************************************************/
+void control_unit_set_program_counter(const uint16_t address)
+{
+   pc = address;
+   state = CPU_STATE_FETCH;
+   return;
+}
+
+/********************************************************************************
+* control_unit_capture_state: Captures the complete CPU state, for instance
+*                             for trace checkpoints. For an instruction cycle
+*                             in progress, the program counter is the address
+*                             of its instruction.
+*
+*                             - checkpoint: Reference to storage for the state.
+********************************************************************************/
+void control_unit_capture_state(struct trace_checkpoint* checkpoint)
+{
+   checkpoint->cycle = cycles;
+   checkpoint->instructions = instructions;
+   checkpoint->pc = state == CPU_STATE_FETCH ? pc : mar;
+   checkpoint->sp = stack_pointer();
+   checkpoint->sr = sr;
+   memcpy(checkpoint->reg, reg, sizeof(checkpoint->reg));
+   memcpy(checkpoint->data, data_memory_content, sizeof(checkpoint->data));
+   return;
+}
+
+/********************************************************************************
+* control_unit_set_stack_trap_policy: Sets the action taken on stack overflow
+*                                     and underflow. The policy is kept on
+*                                     reset. Faults are ignored by default.
+*
+*                                     - policy: The new trap policy.
+********************************************************************************/
+void control_unit_set_stack_trap_policy(const enum stack_trap_policy policy)
+{
+   stack_trap_policy = policy;
+   return;
+}
+
+/********************************************************************************
+* control_unit_stop_reason: Returns the reason the CPU stopped executing, or
+*                           CPU_STOP_NONE if it's running. A stopped CPU
+*                           doesn't execute any instructions until reset.
+********************************************************************************/
+enum cpu_stop_reason control_unit_stop_reason(void)
+{
+   return stop_reason;
+}
+
+/********************************************************************************
+* control_unit_exception: Returns the context of the last simulator exception.
+*                         Only valid if the stop reason is CPU_STOP_EXCEPTION.
+********************************************************************************/
+const struct control_unit_exception* control_unit_exception(void)
+{
+   return &exception;
+}
+
+/********************************************************************************
+* control_unit_watch_hit: Returns the last access to a watched address. Only
+*                         valid if the stop reason is CPU_STOP_WATCHPOINT.
+********************************************************************************/
+const struct control_unit_watch_hit* control_unit_watch_hit(void)
+{
+   return &watch_hit;
+}
+
+/********************************************************************************
+* control_unit_print: Prints information about the processor, for instance
+*                     current subroutine, instruction, state, content in
+*                     CPU-registers and I/O registers DDRB, PORTB and PINB.
+*                     The whole block is built in one buffer and written at
+*                     once, binary numbers are copied from a precomputed
+*                     table. I/O registers are read without I/O hooks and
+*                     watchpoints, so printing never affects the CPU.
+********************************************************************************/
+void control_unit_print(void)
+{
+   char storage[CONTROL_UNIT_PRINT_BUFFER_SIZE];
+   struct text_buffer text;
+   text_buffer_init(&text, storage, sizeof(storage));
+
+   text_buffer_append(&text, "--------------------------------------------------------------------------------\n");
+   text_buffer_append(&text, "Current subroutine:\t\t\t\t");
+   text_buffer_append(&text, program_memory_subroutine_name(mar));
+   text_buffer_append(&text, "\nCurrent instruction:\t\t\t\t");
+   text_buffer_append(&text, cpu_instruction_name(op_code == BRK ?
+                      (uint8_t)(breakpoint_original_instruction(mar) >> 16) : op_code)); /* Hides breakpoint markers. */
+   text_buffer_append(&text, "\nCurrent state:\t\t\t\t\t");
+   text_buffer_append(&text, cpu_state_name(state));
+   text_buffer_append(&text, "\nClock cycles elapsed:\t\t\t\t");
+   text_buffer_append_unsigned(&text, cycles);
+   text_buffer_append_char(&text, '\n');
+
+   if (stop_reason)
+   {
+      text_buffer_append(&text, "Execution stopped:\t\t\t\t");
+      text_buffer_append(&text, cpu_stop_reason_name(stop_reason));
+      text_buffer_append_char(&text, '\n');
+   }
+
+   if (stop_reason == CPU_STOP_EXCEPTION)
+   {
+      text_buffer_append(&text, "Exception:\t\t\t\t\tStack ");
+      text_buffer_append(&text, exception.fault == STACK_FAULT_OVERFLOW ? "overflow" : "underflow");
+      text_buffer_append(&text, " at address ");
+      text_buffer_append_unsigned(&text, exception.pc);
+      text_buffer_append(&text, " (");
+      text_buffer_append(&text, cpu_instruction_name(exception.op_code));
+      text_buffer_append(&text, "), SP = ");
+      text_buffer_append_unsigned(&text, exception.sp);
+      text_buffer_append(&text, ", cycle ");
+      text_buffer_append_unsigned(&text, exception.cycle);
+      text_buffer_append(&text, "\nReturn address on the stack:\t\t\t");
+
+      if (exception.return_address_valid)
+      {
+         text_buffer_append_unsigned(&text, exception.return_address);
+         text_buffer_append(&text, " (");
+         text_buffer_append(&text, program_memory_subroutine_name(exception.return_address));
+         text_buffer_append_char(&text, ')');
+      }
+      else
+      {
+         text_buffer_append_char(&text, '-');
+      }
+
+      for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; ++i)
+      {
+         if (i % 16 == 0) text_buffer_append(&text, i ? "\nRegisters R16 - R31:\t\t\t\t" : "\nRegisters R0 - R15:\t\t\t\t");
+         else text_buffer_append_char(&text, ' ');
+         text_buffer_append_hex(&text, exception.reg[i], 2);
+      }
+      text_buffer_append_char(&text, '\n');
+   }
+   else if (stop_reason == CPU_STOP_BREAKPOINT)
+   {
+      text_buffer_append(&text, "Breakpoint:\t\t\t\t\tAddress ");
+      text_buffer_append_unsigned(&text, pc);
+      text_buffer_append(&text, " (");
+      text_buffer_append(&text, program_memory_subroutine_name(pc));
+      text_buffer_append(&text, ")\n");
+   }
+   else if (stop_reason == CPU_STOP_WATCHPOINT)
+   {
+      text_buffer_append(&text, "Watchpoint:\t\t\t\t\t");
+      text_buffer_append(&text, watch_hit.access == DATA_MEMORY_WATCH_WRITE ? "Write" : "Read");
+      text_buffer_append(&text, " of address ");
+      text_buffer_append_unsigned(&text, watch_hit.address);
+      text_buffer_append(&text, " at address ");
+      text_buffer_append_unsigned(&text, watch_hit.pc);
+      text_buffer_append(&text, ", 0x");
+      text_buffer_append_hex(&text, watch_hit.old_value, 2);
+      text_buffer_append(&text, " -> 0x");
+      text_buffer_append_hex(&text, watch_hit.new_value, 2);
+      text_buffer_append(&text, ", cycle ");
+      text_buffer_append_unsigned(&text, watch_hit.cycle);
+      text_buffer_append_char(&text, '\n');
+   }
+
+   text_buffer_append(&text, "Program counter:\t\t\t\t");
+   text_buffer_append_unsigned(&text, pc);
+   text_buffer_append(&text, "\nStack pointer:\t\t\t\t\t");
+   text_buffer_append_unsigned(&text, stack_pointer());
+   text_buffer_append(&text, "\nValue last added to the stack:\t\t\t");
+   text_buffer_append_unsigned(&text, stack_last_added_value());
+
+   text_buffer_append(&text, "\n\nInstruction register:\t\t\t\t");
+   text_buffer_append_binary(&text, (uint8_t)(ir >> 16), 8);
+   text_buffer_append_char(&text, ' ');
+   text_buffer_append_binary(&text, (uint8_t)(ir >> 8), 8);
+   text_buffer_append_char(&text, ' ');
+   text_buffer_append_binary(&text, (uint8_t)ir, 8);
+
+   text_buffer_append(&text, "\nStatus register (ISNZVC):\t\t\t");
+   text_buffer_append_binary(&text, sr, 6);
+
+   text_buffer_append(&text, "\n\nContent in CPU register R16:\t\t\t");
+   text_buffer_append_binary(&text, reg[R16], 8);
+   text_buffer_append(&text, "\nContent in CPU register R17:\t\t\t");
+   text_buffer_append_binary(&text, reg[R17], 8);
+   text_buffer_append(&text, "\nContent in CPU register R18:\t\t\t");
+   text_buffer_append_binary(&text, reg[R18], 8);
+   text_buffer_append(&text, "\nContent in CPU register R24:\t\t\t");
+   text_buffer_append_binary(&text, reg[R24], 8);
+
+   text_buffer_append(&text, "\n\nContent in X pointer register:\t\t\t");
+   text_buffer_append_unsigned(&text, (reg[XH] << 8) | reg[XL]);
+   text_buffer_append(&text, "\nContent in Y pointer register:\t\t\t");
+   text_buffer_append_unsigned(&text, (reg[YH] << 8) | reg[YL]);
+   text_buffer_append(&text, "\nContent in Z pointer register:\t\t\t");
+   text_buffer_append_unsigned(&text, (reg[ZH] << 8) | reg[ZL]);
+
+   text_buffer_append(&text, "\n\nContent in data direction register DDRB:\t");
+   text_buffer_append_binary(&text, data_memory_content[DDRB], 8);
+   text_buffer_append(&text, "\nContent in data register PORTB:\t\t\t");
+   text_buffer_append_binary(&text, data_memory_content[PORTB], 8);
+   text_buffer_append(&text, "\nContent in pin input register PINB:\t\t");
+   text_buffer_append_binary(&text, data_memory_content[PINB], 8);
+
+   text_buffer_append(&text, "\n--------------------------------------------------------------------------------\n\n");
+   text_buffer_write(&text, stdout);
+   return;
+}
+
+/********************************************************************************
+* control_unit_print_timing: Prints timing statistics, i.e. the number of
+*                            elapsed clock cycles and executed instructions,
+*                            the corresponding simulated time as well as the
+*                            ratio between simulated time and host time and
+*                            the simulation speed as an equivalent clock
+*                            frequency. The two latter are measured over
+*                            continuous runs only, since stepping is paced
+*                            by the user.
+********************************************************************************/
+void control_unit_print_timing(void)
+{
+   const double simulated_time = (double)cycles / CPU_CLOCK_FREQUENCY;
+   const double run_simulated_time = (double)run_cycles / CPU_CLOCK_FREQUENCY;
+   const double run_host_time = run_time_ns / 1e9;
+
+   printf("--------------------------------------------------------------------------------\n");
+   printf("Clock cycles elapsed:\t\t\t\t%llu\n", (unsigned long long)cycles);
+   printf("Executed instructions:\t\t\t\t%llu\n", (unsigned long long)instructions);
+   printf("Cycles per instruction:\t\t\t\t%.3f\n", instructions ? (double)cycles / instructions : 0.0);
+   printf("Simulated time:\t\t\t\t\t%.6f s\n\n", simulated_time);
+
+   printf("Host time spent on continuous runs:\t\t%.6f s\n", run_host_time);
+   printf("Simulated time / host time:\t\t\t%.3f\n", run_host_time > 0 ? run_simulated_time / run_host_time : 0.0);
+   printf("Simulation speed:\t\t\t\t%.3f MHz\n", run_time_ns ? run_cycles * 1e3 / run_time_ns : 0.0);
+   printf("--------------------------------------------------------------------------------\n\n");
+   return;
+}
+
+/********************************************************************************
+* control_unit_start_perf: Starts counting host hardware events during
+*                          continuous runs, see perf_counters.h. The counts
+*                          are accumulated per execution engine and kept on
+*                          reset. After success, 0 is returned. If no counter
+*                          is available on the host, error code 1 is returned.
+********************************************************************************/
+int control_unit_start_perf(void)
+{
+   if (perf_enabled) return 0;
+   if (perf_counters_open(&perf))
+   {
+      perf_counters_close(&perf);
+      return 1;
+   }
+
+   memset(perf_totals, 0, sizeof(perf_totals));
+   memset(perf_instructions, 0, sizeof(perf_instructions));
+   perf_enabled = true;
+   return 0;
+}
+
+/********************************************************************************
+* control_unit_stop_perf: Stops counting host hardware events. The counts
+*                         are kept for control_unit_print_perf.
+********************************************************************************/
+void control_unit_stop_perf(void)
+{
+   if (!perf_enabled) return;
+   perf_counters_close(&perf);
+   perf_enabled = false;
+   return;
+}
+
+/********************************************************************************
+* control_unit_print_perf: Prints the host hardware events counted during
+*                          continuous runs per simulated instruction and
+*                          execution engine, most notably the host cycles
+*                          per simulated instruction. Nothing is printed if
+*                          no instruction was counted.
+********************************************************************************/
+void control_unit_print_perf(void)
+{
+   bool counted = false;
+
+   for (int i = 0; i < CONTROL_UNIT_NUM_ENGINES; ++i)
+   {
+      if (perf_instructions[i]) counted = true;
+   }
+   if (!counted) return;
+
+   printf("--------------------------------------------------------------------------------\n");
+   printf("Host events per simulated instruction during continuous runs:\n\n");
+   printf("%-6s %12s", "Engine", "Instructions");
+   perf_counters_print_names();
+
+   for (int i = 0; i < CONTROL_UNIT_NUM_ENGINES; ++i)
+   {
+      if (!perf_instructions[i]) continue;
+      printf("%-6s %12llu", control_unit_engine_name((enum control_unit_engine)i),
+             (unsigned long long)perf_instructions[i]);
+      perf_counters_print_row(perf_totals[i], perf_instructions[i]);
+   }
+
+   printf("--------------------------------------------------------------------------------\n\n");
+   return;
+}
+
+/********************************************************************************
+* control_unit_open_trace: Starts writing a binary trace of all executed
+*                          instructions to specified file, see trace.h.
+*                          After success, 0 is returned. If the file couldn't
+*                          be opened, error code 1 is returned.
+*
+*                          - path: Path to the trace file.
+********************************************************************************/
+int control_unit_open_trace(const char* path)
+{
+   if (trace_open(path, control_unit_capture_state)) return 1;
+   tracing = true;
+   return 0;
+}
+
+/********************************************************************************
+* control_unit_close_trace: Stops tracing and writes the rest of the trace.
+********************************************************************************/
+void control_unit_close_trace(void)
+{
+   tracing = false;
+   trace_close();
+   return;
+}
+
+/********************************************************************************
+* control_unit_print_hotness: Prints the number of executions per OP code and
+*                             per program address since last reset, sorted
+*                             with the most executed first. The addresses are
+*                             annotated with subroutine names and disassembly.
+*                             Nothing is counted if the execution counters
+*                             are compiled out via
+*                             CONTROL_UNIT_EXECUTION_COUNTERS.
+*
+*                             - max_addresses: Max number of addresses to print.
+********************************************************************************/
+void control_unit_print_hotness(const size_t max_addresses)
+{
+#if CONTROL_UNIT_EXECUTION_COUNTERS
+   static uint16_t addresses[PROGRAM_MEMORY_ADDRESS_WIDTH];
+   uint8_t opcodes[256];
+   size_t num_opcodes = 0;
+   size_t num_addresses = 0;
+   char assembly[32];
+
+   for (uint16_t i = 0; i < 256; ++i)
+   {
+      if (opcode_counts[i]) opcodes[num_opcodes++] = (uint8_t)i;
+   }
+
+   for (uint16_t i = 0; i < PROGRAM_MEMORY_ADDRESS_WIDTH; ++i)
+   {
+      if (address_counts[i]) addresses[num_addresses++] = i;
+   }
+
+   qsort(opcodes, num_opcodes, sizeof(opcodes[0]), compare_opcode_counts);
+   qsort(addresses, num_addresses, sizeof(addresses[0]), compare_address_counts);
+
+   printf("--------------------------------------------------------------------------------\n");
+   printf("%-12s %20s %10s\n", "Instruction", "Executions", "Share");
+
+   for (size_t i = 0; i < num_opcodes; ++i)
+   {
+      printf("%-12s %20llu %9.2f%%\n", cpu_instruction_name(opcodes[i]),
+             (unsigned long long)opcode_counts[opcodes[i]],
+             100.0 * opcode_counts[opcodes[i]] / instructions);
+   }
+
+   printf("\n%-8s %-16s %-20s %20s %10s\n", "Address", "Subroutine", "Instruction", "Executions", "Share");
+
+   for (size_t i = 0; i < num_addresses && i < max_addresses; ++i)
+   {
+      cpu_disassemble(breakpoint_original_instruction(addresses[i]), assembly, sizeof(assembly));
+      printf("%-8hu %-16s %-20s %20llu %9.2f%%\n", addresses[i],
+             program_memory_subroutine_name(addresses[i]), assembly,
+             (unsigned long long)address_counts[addresses[i]],
+             100.0 * address_counts[addresses[i]] / instructions);
+   }
+
+   printf("--------------------------------------------------------------------------------\n\n");
+#else
+   (void)max_addresses;
+   printf("Execution counters are disabled (CONTROL_UNIT_EXECUTION_COUNTERS = 0)!\n\n");
+#endif
+   return;
+}
+
+/********************************************************************************
+* fetch: Fetches next instruction from program memory to the instruction
+*        register and increments the program counter. If interrupts are
+*        enabled and an interrupt is pending, the interrupt routine is
+*        entered before the fetch.
+********************************************************************************/
+static inline void fetch(void)
+{
+   if (read(sr, I) && (timer_interrupt_pending() || uart_interrupt_pending()))
+   {
+      enter_interrupt(timer_interrupt_pending() ? timer_acknowledge_interrupt() :
+                                                  uart_acknowledge_interrupt());
+   }
+
+   ir = program_memory_read(pc); /* Fetches next instruction. */
+   mar = pc;                     /* Stores address of current instruction. */
+   pc++;                         /* Program counter points to next instruction. */
+   return;
+}
+
+/********************************************************************************
+* decode: Decodes the instruction stored in the instruction register into
+*         OP code and operands.
+********************************************************************************/
+static inline void decode(void)
+{
+   op_code = ir >> 16; /* Bit 23 downto 16 consists of the OP code. */
+   op1 = ir >> 8;      /* Bit 15 downto 8 consists of the first operand. */
+   op2 = ir;           /* Bit 7 downto 0 consists of the second operand. */
+   return;
+}
+
+/********************************************************************************
+* execute: Executes the decoded instruction and updates the cycle counter
+*          with the number of clock cycles the instruction takes. Writes to
+*          the I/O space may schedule new events, hence the clock cycle of
+*          next event is updated after such writes.
+********************************************************************************/
+static void execute(void)
+{
+   cycles += cpu_instruction_cycles(op_code);
+   instructions++;
+
+#if CONTROL_UNIT_EXECUTION_COUNTERS
+   opcode_counts[op_code]++;
+   address_counts[mar & (PROGRAM_MEMORY_ADDRESS_WIDTH - 1)]++;
+#endif
+
+   switch (op_code) /* Checks the OP code.*/
+   {
+   case NOP: /* NOP => do nothing. */
+   {
+      break; 
+   }
+   case LDI: /* LDI R16, 0x01 => op_code = LDI, op1 = R16, op2 = 0x01 */
+   {
+      reg[op1] = op2; 
+      break;
+   }
+   case MOV: /* MOV R17, R16 => op_code = MOV, op1 = R17, op2 = R16 */
+   {
+      reg[op1] = reg[op2]; 
+      break;
+   }
+   case OUT: /* OUT DDRB, R16 => op_code = OUT, op1 = DDRB, op2 = R16 */
+   {
+      data_memory_write(op1, reg[op2]);
+      refresh_next_event(); /* Peripherals may have scheduled events. */
+      break;
+   }
+   case IN: /* IN R16, PINB => op_code = IN, op1 = R16, op2 = PINB */
+   {
+      reg[op1] = data_memory_read(op2);
+      break;
+   }
+   case STS: /* STS counter, R16 => op_code = STS, op1 = counter, op2 = R16 */
+   {
+      data_memory_write(op1 + 256, reg[op2]);
+      break;
+   }
+   case LDS: /* LDS R16, counter => op_code = LDS, op1 = R16, op2 = counter */
+   {
+      reg[op1] = data_memory_read(op2 + 256);
+      break;
+   }
+   case JMP: /* JMP 0x0105 => op_code = JMP, address = 0x0105 (bit 15 downto 0) */
+   {
+      pc = (uint16_t)ir; 
+      break;
+   }
+   case CALL: /* CALL 0x0110 => op_code = CALL, address = 0x0110 (bit 15 downto 0) */
+   {
+      profiler_call((uint16_t)ir, mar);
+      push_address(pc); /* Pushes the return address to the stack. */
+      pc = (uint16_t)ir; /* Assigns the address of the subroutine to be called. */
+      break;
+   }
+   case RET: /* RET => op_code = RET */
+   {
+      profiler_return();
+      pc = pop_address(); /* Pops the return address from the stack. */
+      break;
+   }
+   case RETI: /* RETI => op_code = RETI */
+   {
+      profiler_return();
+      pc = pop_address(); /* Pops the return address from the stack. */
+      set(sr, I);       /* Enables interrupts again. */
+      break;
+   }
+   case SEI: /* SEI => op_code = SEI */
+   {
+      set(sr, I); /* Enables interrupts globally. */
+      break;
+   }
+   case CLI: /* CLI => op_code = CLI */
+   {
+      clr(sr, I); /* Disables interrupts globally. */
+      break;
+   }
+   case PUSH: /* PUSH R16 => op_code = PUSH, op1 = R16 */
+   {
+      stack_push(reg[op1]); /* Pushes content of specified CPU register to the stack. */
+      break;
+   }
+   case POP: /* POP R16 => op_code = POP, op1 = R16 */
+   {
+      reg[op1] = stack_pop(); /* Pops content of the stack to specified CPU register. */
+      break;
+   }
+   case ST: /* ST XREG, R16 => op_code = ST, op1 = XREG, op2 = R16 */
+   {
+      data_memory_write((reg[op1 + 1] << 8) | reg[op1], reg[op2]);
+      refresh_next_event(); /* Peripherals may have scheduled events. */
+      break;
+   }
+   case LD: /* LD R16, XREG => op_code = LD, op1 = R16, op2 = XREG */
+   {
+      reg[op1] = data_memory_read((reg[op2 + 1] << 8) | reg[op2]);
+      break;
+   }
+   case BRK: /* Breakpoint marker, see breakpoint.h. */
+   {
+      execute_breakpoint();
+      return;
+   }
+   default:
+   {
+      control_unit_reset(); /* System reset if error occurs. */
+      return;
+   }
+   }
+
+   if (tracing) trace_instruction();
+   return;
+}
+
+/********************************************************************************
+* execute_breakpoint: Executes a breakpoint marker. The marker is dispatched
+*                     like any other instruction, so breakpoints cost nothing
+*                     until they are reached. If the condition is met, the
+*                     CPU stops before the original instruction, which is
+*                     executed when execution is resumed. Otherwise the
+*                     original instruction is executed in place. A marker
+*                     without a breakpoint is an unknown instruction, which
+*                     resets the system.
+********************************************************************************/
+static void execute_breakpoint(void)
+{
+   struct breakpoint* breakpoint = breakpoint_find(mar);
+
+   if (!breakpoint)
+   {
+      control_unit_reset(); /* Unknown instruction, for instance written by the program. */
+      return;
+   }
+
+   /* The marker itself takes no time, the original instruction is accounted instead. */
+   cycles -= cpu_instruction_cycles(BRK);
+   instructions--;
+#if CONTROL_UNIT_EXECUTION_COUNTERS
+   opcode_counts[BRK]--;
+   address_counts[mar & (PROGRAM_MEMORY_ADDRESS_WIDTH - 1)]--;
+#endif
+
+   ir = breakpoint->instruction;
+   decode();
+
+   if (skip_breakpoint && skip_address == mar)
+   {
+      skip_breakpoint = false;
+      execute();
+      return;
+   }
+   else if (!breakpoint_condition_met(breakpoint, reg))
+   {
+      execute();
+      return;
+   }
+
+   breakpoint->hits++;
+   pc = mar; /* Fetches the original instruction again when resumed. */
+
+   if (breakpoint->temporary)
+   {
+      breakpoint_remove(mar);
+   }
+   else
+   {
+      skip_breakpoint = true;
+      skip_address = mar;
+   }
+
+   stop(CPU_STOP_BREAKPOINT);
+   return;
+}
+
+/********************************************************************************
+* enter_interrupt: Enters the interrupt routine at specified interrupt vector.
+*                  The return address is pushed to the stack and interrupts
+*                  are disabled until the routine returns via RETI.
+*
+*                  - vector: The interrupt vector to jump to.
+********************************************************************************/
+static void enter_interrupt(const uint8_t vector)
+{
+   profiler_call(vector, pc);
+   entering_interrupt = true;
+   push_address(pc);
+   entering_interrupt = false;
+   clr(sr, I);
+   cycles += CPU_INTERRUPT_RESPONSE_CYCLES;
+   if (tracing) trace_interrupt(vector);
+   pc = vector;
+   return;
+}
+
+/********************************************************************************
+* push_address: Pushes specified return address to the stack as two bytes,
+*               low byte first, so that the high byte ends up on top. The
+*               address is pushed whole or not at all: if the low byte
+*               overflows, the high byte isn't pushed, so that the overflow
+*               is reported once, and if the high byte overflows, the stack
+*               pointer is restored, so that the return address of the
+*               caller stays on top.
+*
+*               - address: The return address to push.
+********************************************************************************/
+static inline void push_address(const uint16_t address)
+{
+   const uint16_t sp = stack_pointer();
+
+   if (!stack_push(low(address)) && stack_push(high(address)))
+   {
+      stack_set_pointer(sp);
+      if (stop_reason == CPU_STOP_EXCEPTION) capture_return_address();
+   }
+   return;
+}
+
+/********************************************************************************
+* pop_address: Returns a return address popped from the stack, high byte
+*              first, as pushed by push_address. If the high byte underflows,
+*              the stack pointer is unchanged and the low byte isn't popped,
+*              so that the underflow is reported once.
+********************************************************************************/
+static inline uint16_t pop_address(void)
+{
+   const uint16_t sp = stack_pointer();
+   const uint8_t high_byte = stack_pop();
+   if (stack_pointer() == sp) return 0x0000;
+   return (high_byte << 8) | stack_pop();
+}
+
+/********************************************************************************
+* handle_stack_trap: Takes the action of the stack trap policy on specified
+*                    stack fault. Halts and resets take effect after the
+*                    current instruction; clearing the clock cycle of next
+*                    event makes continuous runs leave the inner loop, so
+*                    the fast path needs no check of its own.
+*
+*                    - fault: The detected fault.
+*                    - sp   : The stack pointer at the time of the fault.
+********************************************************************************/
+static void handle_stack_trap(const enum stack_fault fault,
+                              const uint16_t sp)
+{
+   if (stack_trap_policy == STACK_TRAP_HALT)
+   {
+      stop(CPU_STOP_HALT);
+   }
+   else if (stack_trap_policy == STACK_TRAP_EXCEPTION)
+   {
+      exception.fault = fault;
+      exception.pc = access_address();
+      exception.sp = sp;
+      capture_return_address();
+      exception.op_code = op_code;
+      exception.sr = sr;
+      memcpy(exception.reg, reg, sizeof(exception.reg));
+      exception.cycle = cycles;
+      stop(CPU_STOP_EXCEPTION);
+   }
+   else if (stack_trap_policy == STACK_TRAP_RESET)
+   {
+      reset_pending = true;
+      next_event_cycle = 0;
+   }
+   return;
+}
+
+/********************************************************************************
+* capture_return_address: Stores the return address on top of the stack in
+*                         the exception context, i.e. the address in the
+*                         caller of the current subroutine, if the stack
+*                         holds at least two bytes.
+********************************************************************************/
+static void capture_return_address(void)
+{
+   const uint16_t top = stack_pointer() + 1;
+   exception.return_address_valid = top >= STACK_BOTTOM && top < STACK_TOP;
+   exception.return_address = exception.return_address_valid ?
+      (uint16_t)((data_memory_content[top] << 8) | data_memory_content[top + 1]) : 0;
+   return;
+}
+
+/********************************************************************************
+* stop: Stops the CPU for specified reason after the current instruction.
+*
+*       - reason: The reason the CPU is stopped.
+********************************************************************************/
+static void stop(const enum cpu_stop_reason reason)
+{
+   stop_reason = reason;
+   next_event_cycle = 0;
+   return;
+}
+
+/********************************************************************************
+* resume: Clears a stop after which execution may be resumed, i.e. a
+*         watchpoint or breakpoint. Other stops are kept until reset.
+********************************************************************************/
+static inline void resume(void)
+{
+   if (stop_reason == CPU_STOP_WATCHPOINT || stop_reason == CPU_STOP_BREAKPOINT)
+   {
+      stop_reason = CPU_STOP_NONE;
+   }
+   return;
+}
+
+/********************************************************************************
+* refresh_next_event: Updates the clock cycle of next event after a write that
+*                     may have scheduled events, unless a watchpoint or trap
+*                     hit by the write requested the run loop to stop.
+********************************************************************************/
+static inline void refresh_next_event(void)
+{
+   if (next_event_cycle) next_event_cycle = event_queue_next_cycle();
+   return;
+}
+
+/********************************************************************************
+* handle_watch: Stops the CPU after the current instruction when a watched
+*               data memory address is accessed, capturing the access.
+*
+*               - address: The accessed address.
+*               - value  : The value written, or the stored value for reads.
+*               - access : DATA_MEMORY_WATCH_READ or DATA_MEMORY_WATCH_WRITE.
+********************************************************************************/
+static void handle_watch(const uint16_t address,
+                         const uint8_t value,
+                         const uint8_t access)
+{
+   if (stop_reason) return;
+
+   watch_hit.address = address;
+   watch_hit.access = access;
+   watch_hit.old_value = data_memory_content[address];
+   watch_hit.new_value = value;
+   watch_hit.pc = access_address();
+   watch_hit.cycle = cycles;
+   stop(CPU_STOP_WATCHPOINT);
+   return;
+}
+
+/********************************************************************************
+* access_address: Returns the program address a data memory access is
+*                 attributed to: the address of the executing instruction,
+*                 or the interrupted program address while the return
+*                 address of an interrupt is pushed, since the instruction
+*                 address register then still holds the previous instruction.
+********************************************************************************/
+static inline uint16_t access_address(void)
+{
+   return entering_interrupt ? pc : mar;
+}
+
+/********************************************************************************
+* service_events: Services all events in the event queue scheduled at or
+*                 before the current clock cycle and updates the clock cycle
+*                 of next event.
+********************************************************************************/
+static void service_events(void)
+{
+   if (cycles >= event_queue_next_cycle())
+   {
+      event_queue_service(cycles);
+   }
+   next_event_cycle = event_queue_next_cycle();
+   return;
+}
+
+/********************************************************************************
+* trace_instruction: Writes a trace record for the executed instruction with
+*                    the register or data memory location it wrote. The
+*                    written value is read back after execution, which keeps
+*                    the cost to a few stores per instruction.
+********************************************************************************/
+static void trace_instruction(void)
+{
+   struct trace_record record;
+   const uint16_t sp = stack_pointer();
+
+   record.cycle = cycles;
+   record.instruction = ir;
+   record.pc = mar;
+   record.sp = sp;
+   record.sr = sr;
+   record.kind = TRACE_KIND_NONE;
+   record.destination = 0;
+   record.value = 0;
+
+   switch (op_code)
+   {
+   case LDI: case MOV: case IN: case LDS: case CLR: case ORI: case ANDI: case XORI: case OR:
+   case AND: case XOR: case ADDI: case SUBI: case ADD: case SUB: case INC: case DEC: case LSL:
+   case LSR: case POP: case LD:
+      record.kind = TRACE_KIND_REGISTER;
+      record.destination = op1;
+      record.value = reg[op1];
+      break;
+   case OUT:
+      record.kind = TRACE_KIND_DATA;
+      record.destination = op1;
+      break;
+   case STS:
+      record.kind = TRACE_KIND_DATA;
+      record.destination = op1 + 256;
+      break;
+   case ST:
+      record.kind = TRACE_KIND_DATA;
+      record.destination = (reg[op1 + 1] << 8) | reg[op1];
+      break;
+   case PUSH:
+      record.kind = TRACE_KIND_DATA;
+      record.destination = sp + 1;
+      break;
+   case CALL:
+      record.kind = TRACE_KIND_DATA16;
+      record.destination = sp + 1;
+      break;
+   }
+
+   if (record.destination + (record.kind == TRACE_KIND_DATA16) >= DATA_MEMORY_ADDRESS_WIDTH)
+   {
+      record.kind = TRACE_KIND_NONE;
+   }
+   else if (record.kind == TRACE_KIND_DATA)
+   {
+      record.value = data_memory_content[record.destination];
+   }
+   else if (record.kind == TRACE_KIND_DATA16)
+   {
+      record.value = (data_memory_content[record.destination] << 8) | data_memory_content[record.destination + 1];
+   }
+
+   trace_write(&record);
+   return;
+}
+
+/********************************************************************************
+* trace_interrupt: Writes a trace record for entry of specified interrupt,
+*                  with the return address pushed to the stack.
+*
+*                  - vector: The entered interrupt vector.
+********************************************************************************/
+static void trace_interrupt(const uint8_t vector)
+{
+   struct trace_record record;
+   const uint16_t sp = stack_pointer();
+
+   record.cycle = cycles;
+   record.instruction = vector;
+   record.pc = pc;
+   record.sp = sp;
+   record.sr = sr;
+   record.kind = TRACE_KIND_NONE | TRACE_FLAG_INTERRUPT;
+   record.destination = 0;
+   record.value = 0;
+
+   if (sp + 2 < DATA_MEMORY_ADDRESS_WIDTH)
+   {
+      record.kind = TRACE_KIND_DATA16 | TRACE_FLAG_INTERRUPT;
+      record.destination = sp + 1;
+      record.value = (data_memory_content[sp + 1] << 8) | data_memory_content[sp + 2];
+   }
+
+   trace_write(&record);
+   return;
+}
+
+#if CONTROL_UNIT_EXECUTION_COUNTERS
+/********************************************************************************
+* compare_opcode_counts: Compares the execution counts of two OP codes for
+*                        sorting in descending order with qsort. Equal
+*                        counts are sorted by OP code.
+*
+*                        - a: Reference to the first OP code.
+*                        - b: Reference to the second OP code.
+********************************************************************************/
+static int compare_opcode_counts(const void* a,
+                                 const void* b)
+{
+   const uint8_t opcode_a = *(const uint8_t*)a;
+   const uint8_t opcode_b = *(const uint8_t*)b;
+   const uint64_t count_a = opcode_counts[opcode_a];
+   const uint64_t count_b = opcode_counts[opcode_b];
+   if (count_a != count_b) return count_a < count_b ? 1 : -1;
+   return (opcode_a > opcode_b) - (opcode_a < opcode_b);
+}
+
+/********************************************************************************
+* compare_address_counts: Compares the execution counts of two program
+*                         addresses for sorting in descending order with
+*                         qsort. Equal counts are sorted by address.
+*
+*                         - a: Reference to the first address.
+*                         - b: Reference to the second address.
+********************************************************************************/
+static int compare_address_counts(const void* a,
+                                  const void* b)
+{
+   const uint16_t address_a = *(const uint16_t*)a;
+   const uint16_t address_b = *(const uint16_t*)b;
+   const uint64_t count_a = address_counts[address_a];
+   const uint64_t count_b = address_counts[address_b];
+   if (count_a != count_b) return count_a < count_b ? 1 : -1;
+   return (address_a > address_b) - (address_a < address_b);
+}
+#endif
+
+/********************************************************************************
+* run_fused: Runs complete instruction cycles until at least specified number
+*            of clock cycles have elapsed. An instruction cycle in progress
+*            is completed first. Instructions are run uninterrupted until
+*            the clock cycle of the next event in the event queue, which is
+*            then serviced. The run ends early if the CPU is stopped or reset
+*            by a trap.
+*
+*            - num_cycles: The number of clock cycles to run.
+********************************************************************************/
+static void run_fused(const uint64_t num_cycles)
+{
+   const uint64_t stop_cycle = num_cycles > UINT64_MAX - cycles ? UINT64_MAX : cycles + num_cycles; /* Saturated. */
+
+   resume();
+   while (state != CPU_STATE_FETCH && !stop_reason)
+   {
+      control_unit_run_next_state();
+   }
+
+   next_event_cycle = event_queue_next_cycle();
+
+   while (cycles < stop_cycle && !stop_reason)
+   {
+      while (cycles < next_event_cycle && cycles < stop_cycle)
+      {
+         fetch();
+         decode();
+         execute();
+      }
+
+      if (reset_pending)
+      {
+         control_unit_reset();
+         break;
+      }
+      service_events();
+   }
+   return;
+}
+
+/********************************************************************************
+* run_states: Runs the states of the instruction cycle one by one, like the
+*             reference engine control_unit_run_next_state, until at least
+*             specified number of clock cycles have elapsed and the last
+*             instruction cycle is complete, or the CPU stops.
+*
+*             - num_cycles: The number of clock cycles to run.
+********************************************************************************/
+static void run_states(const uint64_t num_cycles)
+{
+   const uint64_t stop_cycle = num_cycles > UINT64_MAX - cycles ? UINT64_MAX : cycles + num_cycles; /* Saturated. */
+
+   resume();
+   while ((cycles < stop_cycle || state != CPU_STATE_FETCH) && !stop_reason)
+   {
+      control_unit_run_next_state();
+   }
+   return;
+}
+
+/********************************************************************************
+* add_perf_counts: Adds the host counts of the last run to the totals of
+*                  specified engine. A counter that couldn't be read once
+*                  stays unavailable.
+*
+*                  - engine          : The execution engine of the run.
+*                  - num_instructions: Instructions executed during the run.
+********************************************************************************/
+static void add_perf_counts(const enum control_unit_engine engine,
+                            const uint64_t num_instructions)
+{
+   perf_instructions[engine] += num_instructions;
+   perf_counters_accumulate(&perf, perf_totals[engine]);
+   return;
+}
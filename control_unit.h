@@ -1,38 +1,351 @@
-/********************************************************************************
-* control_unit.h: Contains function declarations for implementation of an
-*                 8-bit control unit.
-********************************************************************************/
-#ifndef CONTROL_UNIT_H_
-#define CONTROL_UNIT_H_
-
-/* Include directives: */
-#include "cpu.h"
-#include "program_memory.h"
-#include "data_memory.h"
-#include "stack.h"
-
-/********************************************************************************
-* control_unit_reset: Resets control unit and corresponding program.
-********************************************************************************/
-void control_unit_reset(void);
-
-/********************************************************************************
-* control_unit_run_next_state: Runs next state in the CPU instruction cycle.
-********************************************************************************/
-void control_unit_run_next_state(void);
-
-/********************************************************************************
-* control_unit_run_next_state: Runs next CPU instruction cycle, i.e. fetches
-*                              a new instruction from program memory, decodes
-*                              and executes it.
-********************************************************************************/
-void control_unit_run_next_instruction_cycle(void);
-
-/********************************************************************************
-* control_unit_print: Prints information about the processor, for instance
-*                     current subroutine, instruction, state, content in
-*                     CPU-registers and I/O registers DDRB, PORTB and PINB.
-********************************************************************************/
-void control_unit_print(void);
-
+/********************************************************************************
+* control_unit.h: Contains function declarations for implementation of an
+*                 8-bit control unit.
+********************************************************************************/
+#ifndef CONTROL_UNIT_H_
+#define CONTROL_UNIT_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "program_memory.h"
+#include "data_memory.h"
+#include "stack.h"
+#include "timer.h"
+#include "uart.h"
+#include "vcd.h"
+#include "profiler.h"
+#include "trace.h"
+#include "breakpoint.h"
+#include "text_buffer.h"
+#include "event_queue.h"
+#include "host.h"
+#include "perf_counters.h"
+
+/* Macro definitions: */
+#ifndef CONTROL_UNIT_EXECUTION_COUNTERS
+#define CONTROL_UNIT_EXECUTION_COUNTERS 1 /* Counts executions per OP code and address, 0 compiles out. */
+#endif
+
+#define CONTROL_UNIT_PRINT_BUFFER_SIZE 2048 /* Size of the buffer the processor state is printed from. */
+
+/********************************************************************************
+* control_unit_exception: Structure for the context of a simulator exception,
+*                         captured when a stack fault is trapped. If the
+*                         fault occurs while entering an interrupt, the
+*                         address is the interrupted program address.
+********************************************************************************/
+struct control_unit_exception
+{
+   enum stack_fault fault;                  /* The stack fault that raised the exception. */
+   uint16_t pc;                             /* Address of the executing instruction, or the interrupted address. */
+   uint16_t sp;                             /* Stack pointer at the time of the fault. */
+   uint16_t return_address;                 /* Return address on top of the stack, in the caller. */
+   bool return_address_valid;               /* Indicates if the stack held a return address. */
+   uint8_t op_code;                         /* OP code of the instruction being executed. */
+   uint8_t sr;                              /* Status register at the time of the fault. */
+   uint8_t reg[CPU_REGISTER_ADDRESS_WIDTH]; /* CPU registers R0 - R31 at the time of the fault. */
+   uint64_t cycle;                          /* Clock cycle at the time of the fault. */
+};
+
+/********************************************************************************
+* control_unit_watch_hit: Structure for an access to a watched data memory
+*                         address, captured when a watchpoint stops the CPU.
+*                         Pushes of the return address of an interrupt are
+*                         attributed to the interrupted program address.
+********************************************************************************/
+struct control_unit_watch_hit
+{
+   uint16_t address;  /* The accessed address. */
+   uint8_t access;    /* DATA_MEMORY_WATCH_READ or DATA_MEMORY_WATCH_WRITE. */
+   uint8_t old_value; /* Value stored before the access. */
+   uint8_t new_value; /* Value written, equal to the old value for reads. */
+   uint16_t pc;       /* Address of the accessing instruction, or the interrupted address. */
+   uint64_t cycle;    /* Clock cycle at the time of the access. */
+};
+
+/********************************************************************************
+* control_unit_engine: Enumeration for the execution engines, i.e. the ways
+*                      instructions can be run.
+********************************************************************************/
+enum control_unit_engine
+{
+   CONTROL_UNIT_ENGINE_STEP, /* Reference engine, one state of the instruction cycle per call. */
+   CONTROL_UNIT_ENGINE_RUN,  /* Fused fetch, decode and execute loop of control_unit_run. */
+   CONTROL_UNIT_NUM_ENGINES  /* Number of execution engines. */
+};
+
+/********************************************************************************
+* control_unit_reset: Resets control unit and corresponding program.
+********************************************************************************/
+void control_unit_reset(void);
+
+/********************************************************************************
+* control_unit_run_next_state: Runs next state in the CPU instruction cycle.
+********************************************************************************/
+void control_unit_run_next_state(void);
+
+/********************************************************************************
+* control_unit_run_next_state: Runs next CPU instruction cycle, i.e. fetches
+*                              a new instruction from program memory, decodes
+*                              and executes it.
+********************************************************************************/
+void control_unit_run_next_instruction_cycle(void);
+
+/********************************************************************************
+* control_unit_run: Runs complete instruction cycles until at least specified
+*                   number of clock cycles have elapsed with the engine
+*                   selected via control_unit_set_engine. By default, the
+*                   fused engine is used, where instructions are run
+*                   uninterrupted until the clock cycle of the next event in
+*                   the event queue, which is then serviced. An instruction
+*                   cycle in progress is completed first. The host time
+*                   spent is accumulated for the timing statistics. The run
+*                   ends early if the CPU is stopped or reset by a trap.
+*
+*                   - num_cycles: The number of clock cycles to run.
+********************************************************************************/
+void control_unit_run(const uint64_t num_cycles);
+
+/********************************************************************************
+* control_unit_run_engine: Runs complete instruction cycles with specified
+*                          execution engine until at least specified number
+*                          of clock cycles have elapsed or the CPU stops.
+*                          All engines produce the same machine state, so
+*                          they can be compared in speed and against each
+*                          other. The host time spent and, if enabled, the
+*                          host performance counters are accumulated.
+*
+*                          - engine    : The execution engine.
+*                          - num_cycles: The number of clock cycles to run.
+********************************************************************************/
+void control_unit_run_engine(const enum control_unit_engine engine,
+                             const uint64_t num_cycles);
+
+/********************************************************************************
+* control_unit_engine_name: Returns the name of specified execution engine.
+*
+*                           - engine: The execution engine.
+********************************************************************************/
+const char* control_unit_engine_name(const enum control_unit_engine engine);
+
+/********************************************************************************
+* control_unit_set_engine: Selects the execution engine of control_unit_run.
+*                          The selection is kept on reset.
+*
+*                          - engine: The execution engine.
+********************************************************************************/
+void control_unit_set_engine(const enum control_unit_engine engine);
+
+/********************************************************************************
+* control_unit_engine: Returns the execution engine of control_unit_run.
+********************************************************************************/
+enum control_unit_engine control_unit_engine(void);
+
+/********************************************************************************
+* control_unit_run_until: Runs until the instruction at specified address is
+*                         reached, another stop occurs or specified number of
+*                         clock cycles have elapsed. A temporary breakpoint is
+*                         set at the address unless a breakpoint already
+*                         exists. If the address was reached, 0 is returned,
+*                         otherwise 1.
+*
+*                         - address   : Address in program memory.
+*                         - max_cycles: Max number of clock cycles to run.
+********************************************************************************/
+int control_unit_run_until(const uint16_t address,
+                           const uint64_t max_cycles);
+
+/********************************************************************************
+* control_unit_cycle_count: Returns the number of clock cycles elapsed since
+*                           last reset.
+********************************************************************************/
+uint64_t control_unit_cycle_count(void);
+
+/********************************************************************************
+* control_unit_instruction_count: Returns the number of instructions executed
+*                                 since last reset.
+********************************************************************************/
+uint64_t control_unit_instruction_count(void);
+
+/********************************************************************************
+* control_unit_run_cycle_count: Returns the number of clock cycles elapsed
+*                               during continuous runs since last reset.
+********************************************************************************/
+uint64_t control_unit_run_cycle_count(void);
+
+/********************************************************************************
+* control_unit_run_time_ns: Returns the host time spent on continuous runs
+*                           since last reset in nanoseconds.
+********************************************************************************/
+uint64_t control_unit_run_time_ns(void);
+
+/********************************************************************************
+* control_unit_opcode_count: Returns the number of executions of specified OP
+*                            code since last reset, which is always 0 if the
+*                            execution counters are compiled out via
+*                            CONTROL_UNIT_EXECUTION_COUNTERS.
+*
+*                            - op_code: The OP code.
+********************************************************************************/
+uint64_t control_unit_opcode_count(const uint8_t op_code);
+
+/********************************************************************************
+* control_unit_register: Returns the content of specified CPU register, or 0
+*                        if the index is invalid.
+*
+*                        - index: Index of the CPU register (0 - 31).
+********************************************************************************/
+uint8_t control_unit_register(const uint8_t index);
+
+/********************************************************************************
+* control_unit_set_register: Writes specified value to specified CPU
+*                            register. Nothing is done if the index is
+*                            invalid.
+*
+*                            - index: Index of the CPU register (0 - 31).
+*                            - value: The new content of the register.
+********************************************************************************/
+void control_unit_set_register(const uint8_t index,
+                               const uint8_t value);
+
+/********************************************************************************
+* control_unit_status_register: Returns the content of the status register.
+********************************************************************************/
+uint8_t control_unit_status_register(void);
+
+/********************************************************************************
+* control_unit_set_status_register: Writes specified value to the status
+*                                   register.
+*
+*                                   - value: The new content of the register.
+********************************************************************************/
+void control_unit_set_status_register(const uint8_t value);
+
+/********************************************************************************
+* control_unit_program_counter: Returns the address of the next instruction
+*                               to execute. For an instruction cycle in
+*                               progress, the address of its instruction is
+*                               returned.
+********************************************************************************/
+uint16_t control_unit_program_counter(void);
+
+/********************************************************************************
+* control_unit_set_program_counter: Continues execution at specified address.
+*                                   An instruction cycle in progress is
+*                                   abandoned.
+*
+*                                   - address: Address in program memory.
+********************************************************************************/
+void control_unit_set_program_counter(const uint16_t address);
+
+/********************************************************************************
+* control_unit_capture_state: Captures the complete CPU state, for instance
+*                             for trace checkpoints. For an instruction cycle
+*                             in progress, the program counter is the address
+*                             of its instruction.
+*
+*                             - checkpoint: Reference to storage for the state.
+********************************************************************************/
+void control_unit_capture_state(struct trace_checkpoint* checkpoint);
+
+/********************************************************************************
+* control_unit_set_stack_trap_policy: Sets the action taken on stack overflow
+*                                     and underflow. The policy is kept on
+*                                     reset. Faults are ignored by default.
+*
+*                                     - policy: The new trap policy.
+********************************************************************************/
+void control_unit_set_stack_trap_policy(const enum stack_trap_policy policy);
+
+/********************************************************************************
+* control_unit_stop_reason: Returns the reason the CPU stopped executing, or
+*                           CPU_STOP_NONE if it's running. A stopped CPU
+*                           doesn't execute any instructions until reset,
+*                           except after a watchpoint or breakpoint.
+********************************************************************************/
+enum cpu_stop_reason control_unit_stop_reason(void);
+
+/********************************************************************************
+* control_unit_watch_hit: Returns the last access to a watched address. Only
+*                         valid if the stop reason is CPU_STOP_WATCHPOINT.
+********************************************************************************/
+const struct control_unit_watch_hit* control_unit_watch_hit(void);
+
+/********************************************************************************
+* control_unit_exception: Returns the context of the last simulator exception.
+*                         Only valid if the stop reason is CPU_STOP_EXCEPTION.
+********************************************************************************/
+const struct control_unit_exception* control_unit_exception(void);
+
+/********************************************************************************
+* control_unit_print: Prints information about the processor, for instance
+*                     current subroutine, instruction, state, content in
+*                     CPU-registers and I/O registers DDRB, PORTB and PINB.
+********************************************************************************/
+void control_unit_print(void);
+
+/********************************************************************************
+* control_unit_print_timing: Prints timing statistics, i.e. the number of
+*                            elapsed clock cycles and executed instructions,
+*                            the corresponding simulated time as well as the
+*                            ratio between simulated time and host time and
+*                            the simulation speed as an equivalent clock
+*                            frequency. The two latter are measured over
+*                            continuous runs only, since stepping is paced
+*                            by the user.
+********************************************************************************/
+void control_unit_print_timing(void);
+
+/********************************************************************************
+* control_unit_start_perf: Starts counting host hardware events during
+*                          continuous runs, see perf_counters.h. The counts
+*                          are accumulated per execution engine and kept on
+*                          reset. After success, 0 is returned. If no counter
+*                          is available on the host, error code 1 is returned.
+********************************************************************************/
+int control_unit_start_perf(void);
+
+/********************************************************************************
+* control_unit_stop_perf: Stops counting host hardware events. The counts
+*                         are kept for control_unit_print_perf.
+********************************************************************************/
+void control_unit_stop_perf(void);
+
+/********************************************************************************
+* control_unit_print_perf: Prints the host hardware events counted during
+*                          continuous runs per simulated instruction and
+*                          execution engine, most notably the host cycles
+*                          per simulated instruction. Nothing is printed if
+*                          no instruction was counted.
+********************************************************************************/
+void control_unit_print_perf(void);
+
+/********************************************************************************
+* control_unit_open_trace: Starts writing a binary trace of all executed
+*                          instructions to specified file, see trace.h.
+*                          After success, 0 is returned. If the file couldn't
+*                          be opened, error code 1 is returned.
+*
+*                          - path: Path to the trace file.
+********************************************************************************/
+int control_unit_open_trace(const char* path);
+
+/********************************************************************************
+* control_unit_close_trace: Stops tracing and writes the rest of the trace.
+********************************************************************************/
+void control_unit_close_trace(void);
+
+/********************************************************************************
+* control_unit_print_hotness: Prints the number of executions per OP code and
+*                             per program address since last reset, sorted
+*                             with the most executed first. The addresses are
+*                             annotated with subroutine names and disassembly.
+*                             Nothing is counted if the execution counters
+*                             are compiled out via
+*                             CONTROL_UNIT_EXECUTION_COUNTERS.
+*
+*                             - max_addresses: Max number of addresses to print.
+********************************************************************************/
+void control_unit_print_hotness(const size_t max_addresses);
+
 #endif /* CONTROL_UNIT_H_ */
\ No newline at end of file
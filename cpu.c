@@ -1,121 +1,195 @@
-/********************************************************************************
-* cpu.c: Contains function definitions for getting names of CPU instructions,
-*        CPU registers and number of binary digits in unsigned numbers as text.
-********************************************************************************/
-#include "cpu.h"
-
-/* Static functions: */
-static inline size_t num_binary_digits(uint32_t num);
-static inline char integer_to_char(const int num);
-
-/********************************************************************************
-* cpu_instruction_name: Returns the name of specified instruction.
-*
-*                       - instruction: The specified CPU instruction.
-********************************************************************************/
-const char* cpu_instruction_name(const uint8_t instruction)
-{
-   if (instruction == NOP)       return "NOP";
-   else if (instruction == LDI)  return "LDI";
-   else if (instruction == MOV)  return "MOV";
-   else if (instruction == IN)   return "IN";
-   else if (instruction == OUT)  return "OUT";
-   else if (instruction == STS)  return "STS";
-   else if (instruction == LDS)  return "LDS";
-   else if (instruction == ORI)  return "ORI";
-   else if (instruction == ANDI) return "ANDI";
-   else if (instruction == XORI) return "XORI";
-   else if (instruction == OR)   return "OR";
-   else if (instruction == AND)  return "AND";
-   else if (instruction == XOR)  return "XOR";
-   else if (instruction == CLR)  return "CLR";
-   else if (instruction == INC)  return "INC";
-   else if (instruction == DEC)  return "DEC";
-   else if (instruction == ADDI) return "ADDI";
-   else if (instruction == SUBI) return "SUBI";
-   else if (instruction == ADDI) return "ADD";
-   else if (instruction == SUBI) return "SUB";
-   else if (instruction == LSL)  return "LSL";
-   else if (instruction == LSR)  return "LSR";
-   else if (instruction == BREQ) return "BREQ";
-   else if (instruction == BRNE) return "BRNE";
-   else if (instruction == BRGE) return "BRGE";
-   else if (instruction == BRGT) return "BRGT";
-   else if (instruction == BRLE) return "BRLE";
-   else if (instruction == BRLT) return "BRLT";
-   else if (instruction == JMP)  return "JMP";
-   else if (instruction == CPI)  return "CPI";
-   else if (instruction == CP)   return "CP";
-   else if (instruction == CALL) return "CALL";
-   else if (instruction == RET)  return "RET";
-   else if (instruction == PUSH) return "PUSH";
-   else if (instruction == POP)  return "POP";
-   else if (instruction == SEI)  return "SEI";
-   else if (instruction == CLI)  return "CLI";
-   else if (instruction == RETI) return "RETI";
-   else if (instruction == ST)   return "ST";
-   else if (instruction == LD)   return "LD";
-   else return "Unknown";
-}
-
-/********************************************************************************
-* cpu_state_name: Returns the name of specified CPU state.
-*
-*                 - state: The specified CPU state.
-********************************************************************************/
-const char* cpu_state_name(const enum cpu_state state)
-{
-   if (state == CPU_STATE_FETCH)        return "Fetch";
-   else if (state == CPU_STATE_DECODE)  return "Decode";
-   else if (state == CPU_STATE_EXECUTE) return "Execute";
-   else return "Unknown";
-}
-
-/********************************************************************************
-* get_binary: Returns specified number as a binary string with specified
-*             minimum number of characters.
-*
-*             - num      : The specified number.
-*             - min_chars: Minimum number of characters in the returned string.
-********************************************************************************/
-const char* get_binary(uint32_t num,
-                       const uint8_t min_chars)
-{
-   static char s[33] = { '\0' };
-
-   size_t size = num_binary_digits(num);
-   if (size < min_chars) size = min_chars;
-   s[size] = '\0';
-
-   for (size_t i = 0; i < size; ++i)
-   {
-      s[size - 1 - i] = integer_to_char(num % 2);
-      num /= 2;
-   }
-
-   s[size] = '\0';
-   return s;
-}
-
-/********************************************************************************
-* get_binary_digits: Returns the number of binary digits in specified number.
-* 
-*                    - num: The number in unsigned integer form.
-********************************************************************************/
-static inline size_t num_binary_digits(uint32_t num)
-{
-   size_t num_digits = 1;
-   while (num /= 2) num_digits++;
-   return num_digits;
-}
-
-/********************************************************************************
-* integer_to_char: Converts specified number from integer to corresponding 
-*                  character in the ASCII-table.
-*
-*                    - num: The number in integer form.
-********************************************************************************/
-static inline char integer_to_char(const int num)
-{
-   return num + 48;
-}
+/********************************************************************************
+* cpu.c: Contains function definitions for getting names of CPU instructions,
+*        CPU registers and binary strings of bytes as text.
+********************************************************************************/
+#include "cpu.h"
+
+/********************************************************************************
+* instruction_cycles: Number of clock cycles per instruction, indexed by OP code.
+*                     All 256 OP codes are covered so that no bounds check is
+*                     needed, unlisted OP codes are zero and counted as one cycle.
+********************************************************************************/
+static const uint8_t instruction_cycles[256] =
+{
+   [NOP]  = 1, [LDI]  = 1, [MOV]  = 1, [OUT]  = 1, [IN]   = 1, [STS]  = 2, [LDS]  = 2, [CLR]  = 1,
+   [ORI]  = 1, [ANDI] = 1, [XORI] = 1, [OR]   = 1, [AND]  = 1, [XOR]  = 1, [ADDI] = 1, [SUBI] = 1,
+   [ADD]  = 1, [SUB]  = 1, [INC]  = 1, [DEC]  = 1, [CPI]  = 1, [CP]   = 1, [JMP]  = 3, [BREQ] = 1,
+   [BRNE] = 1, [BRGE] = 1, [BRGT] = 1, [BRLE] = 1, [BRLT] = 1, [CALL] = 4, [RET]  = 4, [RETI] = 4,
+   [PUSH] = 2, [POP]  = 2, [LSL]  = 1, [LSR]  = 1, [SEI]  = 1, [CLI]  = 1, [ST]   = 2, [LD]   = 2
+};
+
+/********************************************************************************
+* binary_bytes: Binary strings of all bytes, indexed by the byte. The strings
+*               are built at compile time by appending one digit per level.
+********************************************************************************/
+#define BINARY_1(prefix) prefix "0", prefix "1"
+#define BINARY_2(prefix) BINARY_1(prefix "0"), BINARY_1(prefix "1")
+#define BINARY_3(prefix) BINARY_2(prefix "0"), BINARY_2(prefix "1")
+#define BINARY_4(prefix) BINARY_3(prefix "0"), BINARY_3(prefix "1")
+#define BINARY_5(prefix) BINARY_4(prefix "0"), BINARY_4(prefix "1")
+#define BINARY_6(prefix) BINARY_5(prefix "0"), BINARY_5(prefix "1")
+#define BINARY_7(prefix) BINARY_6(prefix "0"), BINARY_6(prefix "1")
+#define BINARY_8(prefix) BINARY_7(prefix "0"), BINARY_7(prefix "1")
+
+static const char binary_bytes[256][9] = { BINARY_8("") };
+
+/********************************************************************************
+* cpu_instruction_name: Returns the name of specified instruction.
+*
+*                       - instruction: The specified CPU instruction.
+********************************************************************************/
+const char* cpu_instruction_name(const uint8_t instruction)
+{
+   if (instruction == NOP)       return "NOP";
+   else if (instruction == LDI)  return "LDI";
+   else if (instruction == MOV)  return "MOV";
+   else if (instruction == IN)   return "IN";
+   else if (instruction == OUT)  return "OUT";
+   else if (instruction == STS)  return "STS";
+   else if (instruction == LDS)  return "LDS";
+   else if (instruction == ORI)  return "ORI";
+   else if (instruction == ANDI) return "ANDI";
+   else if (instruction == XORI) return "XORI";
+   else if (instruction == OR)   return "OR";
+   else if (instruction == AND)  return "AND";
+   else if (instruction == XOR)  return "XOR";
+   else if (instruction == CLR)  return "CLR";
+   else if (instruction == INC)  return "INC";
+   else if (instruction == DEC)  return "DEC";
+   else if (instruction == ADDI) return "ADDI";
+   else if (instruction == SUBI) return "SUBI";
+   else if (instruction == ADD)  return "ADD";
+   else if (instruction == SUB)  return "SUB";
+   else if (instruction == LSL)  return "LSL";
+   else if (instruction == LSR)  return "LSR";
+   else if (instruction == BREQ) return "BREQ";
+   else if (instruction == BRNE) return "BRNE";
+   else if (instruction == BRGE) return "BRGE";
+   else if (instruction == BRGT) return "BRGT";
+   else if (instruction == BRLE) return "BRLE";
+   else if (instruction == BRLT) return "BRLT";
+   else if (instruction == JMP)  return "JMP";
+   else if (instruction == CPI)  return "CPI";
+   else if (instruction == CP)   return "CP";
+   else if (instruction == CALL) return "CALL";
+   else if (instruction == RET)  return "RET";
+   else if (instruction == PUSH) return "PUSH";
+   else if (instruction == POP)  return "POP";
+   else if (instruction == SEI)  return "SEI";
+   else if (instruction == CLI)  return "CLI";
+   else if (instruction == RETI) return "RETI";
+   else if (instruction == ST)   return "ST";
+   else if (instruction == LD)   return "LD";
+   else if (instruction == BRK)  return "BRK";
+   else return "Unknown";
+}
+
+/********************************************************************************
+* cpu_instruction_cycles: Returns the number of clock cycles needed to execute
+*                         specified instruction, based on the timing of the
+*                         corresponding instructions of ATmega328P. For
+*                         conditional branches the cost of a branch not taken
+*                         is returned, a taken branch needs one more cycle.
+*                         Unknown instructions are counted as one cycle.
+*
+*                         - instruction: The specified CPU instruction.
+********************************************************************************/
+uint8_t cpu_instruction_cycles(const uint8_t instruction)
+{
+   const uint8_t cycles = instruction_cycles[instruction];
+   return cycles ? cycles : 1;
+}
+
+/********************************************************************************
+* cpu_state_name: Returns the name of specified CPU state.
+*
+*                 - state: The specified CPU state.
+********************************************************************************/
+const char* cpu_state_name(const enum cpu_state state)
+{
+   if (state == CPU_STATE_FETCH)        return "Fetch";
+   else if (state == CPU_STATE_DECODE)  return "Decode";
+   else if (state == CPU_STATE_EXECUTE) return "Execute";
+   else return "Unknown";
+}
+
+/********************************************************************************
+* cpu_stop_reason_name: Returns the name of specified stop reason.
+*
+*                       - reason: The specified stop reason.
+********************************************************************************/
+const char* cpu_stop_reason_name(const enum cpu_stop_reason reason)
+{
+   if (reason == CPU_STOP_NONE)           return "Running";
+   else if (reason == CPU_STOP_HALT)      return "Halted";
+   else if (reason == CPU_STOP_EXCEPTION) return "Exception";
+   else if (reason == CPU_STOP_WATCHPOINT) return "Watchpoint";
+   else if (reason == CPU_STOP_BREAKPOINT) return "Breakpoint";
+   else return "Unknown";
+}
+
+/********************************************************************************
+* cpu_disassemble: Writes specified instruction as assembly code to specified
+*                  buffer, for instance "LDI R16, 0x01" or "CALL 0x0020".
+*                  The buffer should fit at least 32 characters.
+*
+*                  - instruction: The instruction as stored in program memory.
+*                  - buffer     : Reference to buffer for the assembly code.
+*                  - size       : The size of the buffer in bytes.
+********************************************************************************/
+void cpu_disassemble(const uint32_t instruction,
+                     char* buffer,
+                     const size_t size)
+{
+   const uint8_t op_code = (uint8_t)(instruction >> 16);
+   const uint8_t op1 = (uint8_t)(instruction >> 8);
+   const uint8_t op2 = (uint8_t)instruction;
+   const char* name = cpu_instruction_name(op_code);
+
+   switch (op_code)
+   {
+   case LDI: case ORI: case ANDI: case XORI: case ADDI: case SUBI: case CPI:
+      snprintf(buffer, size, "%s R%u, 0x%02X", name, op1, op2);
+      break;
+   case MOV: case OR: case AND: case XOR: case ADD: case SUB: case CP:
+      snprintf(buffer, size, "%s R%u, R%u", name, op1, op2);
+      break;
+   case OUT: case STS:
+      snprintf(buffer, size, "%s 0x%02X, R%u", name, op1, op2);
+      break;
+   case IN: case LDS:
+      snprintf(buffer, size, "%s R%u, 0x%02X", name, op1, op2);
+      break;
+   case CLR: case INC: case DEC: case PUSH: case POP: case LSL: case LSR:
+      snprintf(buffer, size, "%s R%u", name, op1);
+      break;
+   case JMP: case CALL: case BREQ: case BRNE: case BRGE: case BRGT: case BRLE: case BRLT:
+      snprintf(buffer, size, "%s 0x%04X", name, (uint16_t)instruction);
+      break;
+   case ST:
+      snprintf(buffer, size, "%s %c, R%u", name, op1 == XREG ? 'X' : op1 == YREG ? 'Y' : 'Z', op2);
+      break;
+   case LD:
+      snprintf(buffer, size, "%s R%u, %c", name, op1, op2 == XREG ? 'X' : op2 == YREG ? 'Y' : 'Z');
+      break;
+   case NOP: case RET: case RETI: case SEI: case CLI: case BRK:
+      snprintf(buffer, size, "%s", name);
+      break;
+   default:
+      snprintf(buffer, size, ".dw 0x%06X", instruction & 0xFFFFFF);
+      break;
+   }
+   return;
+}
+
+/********************************************************************************
+* cpu_binary_byte: Returns specified byte as a binary string of eight
+*                  characters from a precomputed table, hence the string is
+*                  constant and may be used by several callers at once.
+*
+*                  - value: The byte.
+********************************************************************************/
+const char* cpu_binary_byte(const uint8_t value)
+{
+   return binary_bytes[value];
+}
@@ -1,145 +1,744 @@
-/********************************************************************************
-* cpu_controller.c: Contains functionality for control of the program flow
-*                   by input from the keyboard.
-********************************************************************************/
-#include "cpu_controller.h"
-
-/* Static functions: */
-static inline void print_information_at_start(void);
-static inline void print_menu(void);
-static int execute_selection(void);
-static uint8_t get_selection(void);
-static void readline(char* s,
-                     const int size);
-static inline uint8_t get_byte(void);
-
-/********************************************************************************
-* cpu_controller_run_by_input: Controls the program flow and input to the PINB
-*                              register by input from the keyboard.
-********************************************************************************/
-void cpu_controller_run_by_input(void)
-{
-   control_unit_reset();
-   /* print_information_at_start(); */
-
-   while (1)
-   {
-      control_unit_print();
-      print_menu();
-      if (execute_selection()) return;
-   }
-}
-
-/********************************************************************************
-* print_information_at_start: Prints information about connected devices.
-********************************************************************************/
-static inline void print_information_at_start(void)
-{
-   printf("A led is connected to pin 8 (PORTB0).\n");
-   printf("Press the button connected to pin 13 (PORTB5) to toggle the led.\n");
-   printf("To press the button, set the fifth bit of the PINB register, ");
-   printf("for instance by entering the value 32!\n\n");
-   return;
-}
-
-/********************************************************************************
-* print_menu: Prints menu for user control of program flow and input.
-********************************************************************************/
-static inline void print_menu(void)
-{
-   printf("Please select between the following alternatives:\n");
-   printf("1. Execute next instruction cycle\n");
-   printf("2. Run next clock cycle\n");
-   printf("3. Reset system\n");
-   printf("4. Enter new input for pin input register PINB\n");
-   printf("5. Finish execution\n\n");
-   return;
-}
-
-/********************************************************************************
-* execute_selection: Reads and executes user selection entered from keyboard.
-********************************************************************************/
-static int execute_selection(void)
-{
-   const uint8_t selection = get_selection();
-
-   if (selection == 1)
-   {
-      control_unit_run_next_instruction_cycle();
-   }
-   else if (selection == 2)
-   {
-      control_unit_run_next_state();
-   }
-   else if (selection == 3)
-   {
-      control_unit_reset();
-      printf("System reset!\n\n");
-   }
-   else if (selection == 4)
-   {
-      printf("Enter new data for pin input register PINB:\n");
-      const uint8_t input = get_byte();
-      data_memory_write(PINB, input);
-      printf("Wrote %s to pin input register PINB!\n\n", get_binary(input, 8));
-   }
-   else if (selection == 5)
-   {
-      printf("System exit!\n\n");
-      return 1;
-   }
-   return 0;
-}
-
-/********************************************************************************
-* get_selection: Retunrs user selection from keyboard after correct input.
-********************************************************************************/
-static uint8_t get_selection(void)
-{
-   while (1)
-   {
-      const uint8_t selection = get_byte();
-
-      if (selection >= 0 && selection <= 5)
-      {
-         return selection;
-      }
-      else
-      {
-         printf("Invalid input, try again!\n\n");
-      }
-   }
-}
-
-/********************************************************************************
-* readline: Reads text entered from keyboard into referenced string. 
-* 
-*           - s   : Reference to the string which stores entered content.
-*           - size: The capacity of the string.
-********************************************************************************/
-static void readline(char* s,
-                     const int size)
-{
-   fgets(s, size, stdin);
-   printf("\n");
-
-   for (char* i = s; *i; ++i)
-   {
-      if (*i == '\n')
-      {
-         *i = '\0';
-      }
-   }
-   return;
-}
-
-/********************************************************************************
-* get_byte: Returns an unsigned integer entered from the terminal.
-********************************************************************************/
-static inline uint8_t get_byte(void)
-{
-   char s[20] = { '\0' };
-   readline(s, sizeof(s));
-   return (uint8_t)atoi(s);
-}
-
+/********************************************************************************
+* cpu_controller.c: Contains functionality for control of the program flow
+*                   by input from the keyboard.
+********************************************************************************/
+#include "cpu_controller.h"
+#include <string.h>
+
+/* Macro definitions: */
+#define CPU_CONTROLLER_HOTNESS_ENTRIES 20       /* Number of program addresses printed by the hotness report. */
+#define CPU_CONTROLLER_SCRIPT_LINE_SIZE 256     /* Max length of a script line. */
+#define CPU_CONTROLLER_SCRIPT_MAX_WORDS 16      /* Max number of words in a script command. */
+#define CPU_CONTROLLER_UNTIL_CYCLES 100000000   /* Default max clock cycles of the until command. */
+
+/********************************************************************************
+* script_target: Enumeration for the kind of location named by a script
+*                command, for instance r16 or pinb.
+********************************************************************************/
+enum script_target
+{
+   SCRIPT_TARGET_REGISTER,    /* CPU register R0 - R31. */
+   SCRIPT_TARGET_DATA,        /* Data memory address, including the I/O registers. */
+   SCRIPT_TARGET_PC,          /* Address of the next instruction. */
+   SCRIPT_TARGET_SR,          /* Status register. */
+   SCRIPT_TARGET_SP,          /* Stack pointer. */
+   SCRIPT_TARGET_CYCLES,      /* Clock cycles since reset, read only. */
+   SCRIPT_TARGET_INSTRUCTIONS /* Instructions since reset, read only. */
+};
+
+/********************************************************************************
+* script_io_register: Structure for the name of an I/O register usable as
+*                     target in scripts.
+********************************************************************************/
+struct script_io_register
+{
+   const char* name; /* The name in lower case. */
+   uint16_t address; /* The data memory address. */
+};
+
+/* Static variables: */
+static const struct script_io_register script_io_registers[] =
+{
+   { "ddrb", DDRB }, { "portb", PORTB }, { "pinb", PINB },
+   { "ddrc", DDRC }, { "portc", PORTC }, { "pinc", PINC },
+   { "ddrd", DDRD }, { "portd", PORTD }, { "pind", PIND }
+};
+
+static bool changes_only = false; /* Indicates if the menu only displays changed locations. */
+
+/* Static functions: */
+static inline void print_information_at_start(void);
+static inline void print_menu(void);
+static int execute_selection(void);
+static uint8_t get_selection(void);
+static void readline(char* s,
+                     const int size);
+static inline uint8_t get_byte(void);
+static inline uint64_t get_unsigned(void);
+static void write_pinb(const uint64_t cycle,
+                       const uint32_t value);
+static int execute_command(char** words,
+                           const size_t num_words);
+static size_t split_words(char* line,
+                          char** words);
+static int parse_number(const char* text,
+                        uint64_t* value);
+static int parse_target(const char* text,
+                        enum script_target* target,
+                        uint16_t* index);
+static uint64_t read_target(const enum script_target target,
+                            const uint16_t index);
+static int write_target(const enum script_target target,
+                        const uint16_t index,
+                        const uint64_t value);
+static void print_registers(void);
+
+/********************************************************************************
+* cpu_controller_run_by_input: Controls the program flow and input to the PINB
+*                              register by input from the keyboard.
+********************************************************************************/
+void cpu_controller_run_by_input(void)
+{
+   control_unit_reset();
+   state_delta_update();
+   /* print_information_at_start(); */
+
+   while (1)
+   {
+      if (changes_only) state_delta_print();
+      else control_unit_print();
+      print_menu();
+      if (execute_selection()) return;
+   }
+}
+
+/********************************************************************************
+* cpu_controller_run_script: Controls the program flow by a script of
+*                            commands, see cpu_controller.h. If the script
+*                            couldn't be opened or any command failed, 1 is
+*                            returned, otherwise 0.
+*
+*                            - path: Path to the script, or "-" for stdin.
+********************************************************************************/
+int cpu_controller_run_script(const char* path)
+{
+   FILE* script = strcmp(path, "-") ? fopen(path, "r") : stdin;
+   char line[CPU_CONTROLLER_SCRIPT_LINE_SIZE];
+   char* words[CPU_CONTROLLER_SCRIPT_MAX_WORDS + 1];
+   uint64_t line_number = 0;
+   uint64_t failures = 0;
+
+   if (!script) return 1;
+   control_unit_reset();
+   state_delta_update();
+
+   while (fgets(line, sizeof(line), script))
+   {
+      char* comment = strchr(line, '#');
+      size_t num_words;
+      int result;
+
+      line_number++;
+      if (comment) *comment = '\0';
+      num_words = split_words(line, words);
+      if (!num_words) continue;
+
+      if (!strcmp(words[0], "exit")) break;
+      result = num_words <= CPU_CONTROLLER_SCRIPT_MAX_WORDS ? execute_command(words, num_words) : 1;
+
+      if (result)
+      {
+         fprintf(stderr, "%s:%llu: %s\n", path, (unsigned long long)line_number,
+                 result == 1 ? "invalid command" : "command failed");
+         failures++;
+      }
+   }
+
+   if (script != stdin) fclose(script);
+   return failures > 0;
+}
+
+/********************************************************************************
+* print_information_at_start: Prints information about connected devices.
+********************************************************************************/
+static inline void print_information_at_start(void)
+{
+   printf("A led is connected to pin 8 (PORTB0).\n");
+   printf("Press the button connected to pin 13 (PORTB5) to toggle the led.\n");
+   printf("To press the button, set the fifth bit of the PINB register, ");
+   printf("for instance by entering the value 32!\n\n");
+   return;
+}
+
+/********************************************************************************
+* print_menu: Prints menu for user control of program flow and input.
+********************************************************************************/
+static inline void print_menu(void)
+{
+   printf("Please select between the following alternatives:\n");
+   printf("1. Execute next instruction cycle\n");
+   printf("2. Run next clock cycle\n");
+   printf("3. Reset system\n");
+   printf("4. Enter new input for pin input register PINB\n");
+   printf("5. Finish execution\n");
+   printf("6. Run specified number of clock cycles\n");
+   printf("7. Print timing statistics\n");
+   printf("8. Schedule new input for pin input register PINB\n");
+   printf("9. Print execution counts per instruction and address\n");
+   printf("10. Set watchpoint on data memory addresses\n");
+   printf("11. Set breakpoint\n");
+   printf("12. Remove breakpoint\n");
+   printf("13. Print breakpoints\n");
+   printf("14. Run until address\n");
+   printf("15. Toggle display of changed locations only\n");
+   printf("16. Select locations displayed when changed\n\n");
+   return;
+}
+
+/********************************************************************************
+* execute_selection: Reads and executes user selection entered from keyboard.
+********************************************************************************/
+static int execute_selection(void)
+{
+   const uint8_t selection = get_selection();
+
+   if (selection == 1)
+   {
+      control_unit_run_next_instruction_cycle();
+   }
+   else if (selection == 2)
+   {
+      control_unit_run_next_state();
+   }
+   else if (selection == 3)
+   {
+      control_unit_reset();
+      printf("System reset!\n\n");
+   }
+   else if (selection == 4)
+   {
+      printf("Enter new data for pin input register PINB:\n");
+      const uint8_t input = get_byte();
+      data_memory_write(PINB, input);
+      printf("Wrote %s to pin input register PINB!\n\n", cpu_binary_byte(input));
+   }
+   else if (selection == 5)
+   {
+      printf("System exit!\n\n");
+      return 1;
+   }
+   else if (selection == 6)
+   {
+      printf("Enter number of clock cycles to run:\n");
+      const uint64_t num_cycles = get_unsigned();
+      control_unit_run(num_cycles);
+      printf("Ran %llu clock cycles!\n\n", (unsigned long long)num_cycles);
+   }
+   else if (selection == 7)
+   {
+      control_unit_print_timing();
+   }
+   else if (selection == 8)
+   {
+      printf("Enter new data for pin input register PINB:\n");
+      const uint8_t input = get_byte();
+      printf("Enter clock cycle at which to write the data:\n");
+      const uint64_t cycle = get_unsigned();
+
+      if (event_queue_schedule(cycle, write_pinb, input))
+      {
+         printf("The event queue is full, no input was scheduled!\n\n");
+      }
+      else
+      {
+         printf("Scheduled %s to pin input register PINB at clock cycle %llu!\n\n",
+                cpu_binary_byte(input), (unsigned long long)cycle);
+      }
+   }
+   else if (selection == 9)
+   {
+      control_unit_print_hotness(CPU_CONTROLLER_HOTNESS_ENTRIES);
+   }
+   else if (selection == 10)
+   {
+      printf("Enter first data memory address to watch:\n");
+      const uint16_t first = (uint16_t)get_unsigned();
+      printf("Enter last data memory address to watch:\n");
+      const uint16_t last = (uint16_t)get_unsigned();
+      printf("Enter accesses to watch (0 = none, 1 = read, 2 = write, 3 = both):\n");
+      const uint8_t access = get_byte();
+
+      if (data_memory_set_watch(first, last, access))
+      {
+         printf("Invalid address range, no watchpoint was set!\n\n");
+      }
+      else
+      {
+         printf("Watching addresses %hu - %hu!\n\n", first, last);
+      }
+   }
+   else if (selection == 11)
+   {
+      struct breakpoint_condition condition = { BREAKPOINT_ALWAYS, 0, BREAKPOINT_EQUAL, 0 };
+      printf("Enter address of the breakpoint:\n");
+      const uint16_t address = (uint16_t)get_unsigned();
+      printf("Enter condition (0 = none, 1 = CPU register, 2 = data memory):\n");
+      condition.source = (enum breakpoint_source)get_byte();
+
+      if (condition.source != BREAKPOINT_ALWAYS)
+      {
+         printf("Enter CPU register or data memory address to compare:\n");
+         condition.operand = (uint16_t)get_unsigned();
+         printf("Enter comparison (0 = equal, 1 = not equal, 2 = lower, 3 = greater):\n");
+         condition.compare = (enum breakpoint_compare)(get_byte() & 0x03);
+         printf("Enter value to compare against:\n");
+         condition.value = get_byte();
+      }
+
+      if (breakpoint_set(address, &condition, false))
+      {
+         printf("Invalid address or too many breakpoints, no breakpoint was set!\n\n");
+      }
+      else
+      {
+         printf("Breakpoint set at address %hu!\n\n", address);
+      }
+   }
+   else if (selection == 12)
+   {
+      printf("Enter address of the breakpoint to remove:\n");
+      const uint16_t address = (uint16_t)get_unsigned();
+
+      if (breakpoint_remove(address))
+      {
+         printf("No breakpoint at address %hu!\n\n", address);
+      }
+      else
+      {
+         printf("Removed breakpoint at address %hu!\n\n", address);
+      }
+   }
+   else if (selection == 13)
+   {
+      breakpoint_print();
+   }
+   else if (selection == 14)
+   {
+      printf("Enter address to run until:\n");
+      const uint16_t address = (uint16_t)get_unsigned();
+      printf("Enter max number of clock cycles to run:\n");
+      const uint64_t max_cycles = get_unsigned();
+
+      if (control_unit_run_until(address, max_cycles))
+      {
+         printf("Address %hu was not reached!\n\n", address);
+      }
+      else
+      {
+         printf("Reached address %hu!\n\n", address);
+      }
+   }
+   else if (selection == 15)
+   {
+      changes_only = !changes_only;
+      state_delta_update();
+      printf(changes_only ? "Displaying changed locations only!\n\n" : "Displaying the full state!\n\n");
+   }
+   else if (selection == 16)
+   {
+      printf("Enter 0 for a CPU register, 1 for an I/O address, 2 for the stack or 3 for all:\n");
+      const uint8_t kind = get_byte();
+      uint8_t location = 0;
+
+      if (kind <= 1)
+      {
+         printf("Enter CPU register or I/O address:\n");
+         location = get_byte();
+      }
+
+      printf("Enter 1 to display or 0 to hide when changed:\n");
+      const bool watch = get_byte() != 0;
+
+      if (kind == 0)      state_delta_watch_register(location, watch);
+      else if (kind == 1) state_delta_watch_io(location, watch);
+      else if (kind == 2) state_delta_watch_stack(watch);
+      else                state_delta_watch_all(watch);
+      printf("Updated the displayed locations!\n\n");
+   }
+   return 0;
+}
+
+/********************************************************************************
+* get_selection: Retunrs user selection from keyboard after correct input.
+********************************************************************************/
+static uint8_t get_selection(void)
+{
+   while (1)
+   {
+      const uint8_t selection = get_byte();
+
+      if (selection >= 0 && selection <= 16)
+      {
+         return selection;
+      }
+      else
+      {
+         printf("Invalid input, try again!\n\n");
+      }
+   }
+}
+
+/********************************************************************************
+* readline: Reads text entered from keyboard into referenced string. 
+* 
+*           - s   : Reference to the string which stores entered content.
+*           - size: The capacity of the string.
+********************************************************************************/
+static void readline(char* s,
+                     const int size)
+{
+   fgets(s, size, stdin);
+   printf("\n");
+
+   for (char* i = s; *i; ++i)
+   {
+      if (*i == '\n')
+      {
+         *i = '\0';
+      }
+   }
+   return;
+}
+
+/********************************************************************************
+* get_byte: Returns an unsigned integer entered from the terminal.
+********************************************************************************/
+static inline uint8_t get_byte(void)
+{
+   char s[20] = { '\0' };
+   readline(s, sizeof(s));
+   return (uint8_t)atoi(s);
+}
+
+/********************************************************************************
+* get_unsigned: Returns an unsigned 64-bit integer entered from the terminal.
+********************************************************************************/
+static inline uint64_t get_unsigned(void)
+{
+   char s[30] = { '\0' };
+   readline(s, sizeof(s));
+   return (uint64_t)strtoull(s, 0, 10);
+}
+
+/********************************************************************************
+* write_pinb: Event handler which writes scheduled input to pin input
+*             register PINB.
+*
+*             - cycle: The clock cycle the input was scheduled at.
+*             - value: The input to write.
+********************************************************************************/
+static void write_pinb(const uint64_t cycle,
+                       const uint32_t value)
+{
+   (void)cycle;
+   data_memory_write(PINB, (uint8_t)value);
+   return;
+}
+
+/********************************************************************************
+* execute_command: Executes specified script command. After success, 0 is
+*                  returned. If the command is invalid, error code 1 is
+*                  returned. If the command was valid but failed, for
+*                  instance a failed expectation, error code 2 is returned
+*                  after the failure was described on stderr.
+*
+*                  - words    : The words of the command.
+*                  - num_words: The number of words.
+********************************************************************************/
+static int execute_command(char** words,
+                           const size_t num_words)
+{
+   const char* command = words[0];
+   enum script_target target;
+   uint16_t index;
+   uint64_t value = 1;
+   uint64_t max_cycles = CPU_CONTROLLER_UNTIL_CYCLES;
+
+   if (!strcmp(command, "step") && num_words <= 2)
+   {
+      if (num_words == 2 && parse_number(words[1], &value)) return 1;
+
+      for (uint64_t i = 0; i < value; ++i)
+      {
+         control_unit_run(1); /* Executes exactly one instruction. */
+         if (control_unit_stop_reason()) break;
+      }
+   }
+   else if (!strcmp(command, "run") && num_words == 2)
+   {
+      if (parse_number(words[1], &value)) return 1;
+      control_unit_run(value);
+   }
+   else if (!strcmp(command, "until") && (num_words == 2 || num_words == 3))
+   {
+      if (parse_number(words[1], &value) || value >= PROGRAM_MEMORY_ADDRESS_WIDTH) return 1;
+      if (num_words == 3 && parse_number(words[2], &max_cycles)) return 1;
+
+      if (control_unit_run_until((uint16_t)value, max_cycles))
+      {
+         fprintf(stderr, "Address %llu was not reached (%s)!\n", (unsigned long long)value,
+                 cpu_stop_reason_name(control_unit_stop_reason()));
+         return 2;
+      }
+   }
+   else if (!strcmp(command, "reset") && num_words == 1)
+   {
+      control_unit_reset();
+   }
+   else if (!strcmp(command, "set") && num_words == 3)
+   {
+      if (parse_target(words[1], &target, &index) || parse_number(words[2], &value)) return 1;
+      return write_target(target, index, value);
+   }
+   else if (!strcmp(command, "expect") && num_words == 3)
+   {
+      if (parse_target(words[1], &target, &index) || parse_number(words[2], &value)) return 1;
+      const uint64_t actual = read_target(target, index);
+
+      if (actual != value)
+      {
+         fprintf(stderr, "Expected %s to be %llu, but it is %llu!\n", words[1],
+                 (unsigned long long)value, (unsigned long long)actual);
+         return 2;
+      }
+   }
+   else if ((!strcmp(command, "break") || !strcmp(command, "delete")) && num_words == 2)
+   {
+      if (parse_number(words[1], &value) || value >= PROGRAM_MEMORY_ADDRESS_WIDTH) return 1;
+
+      if (command[0] == 'b' ? breakpoint_set((uint16_t)value, 0, false) : breakpoint_remove((uint16_t)value))
+      {
+         fprintf(stderr, "Could not %s breakpoint at address %llu!\n", command, (unsigned long long)value);
+         return 2;
+      }
+   }
+   else if (!strcmp(command, "print") && num_words == 1)
+   {
+      control_unit_print();
+   }
+   else if (!strcmp(command, "changes") && num_words == 1)
+   {
+      state_delta_print();
+   }
+   else if ((!strcmp(command, "show") || !strcmp(command, "hide")) && num_words == 2)
+   {
+      const bool watch = command[0] == 's';
+
+      if (!strcmp(words[1], "all"))        state_delta_watch_all(watch);
+      else if (!strcmp(words[1], "stack")) state_delta_watch_stack(watch);
+      else if (parse_target(words[1], &target, &index)) return 1;
+      else if (target == SCRIPT_TARGET_REGISTER) state_delta_watch_register((uint8_t)index, watch);
+      else if (target == SCRIPT_TARGET_DATA && index < IO_REGISTER_ADDRESS_WIDTH) state_delta_watch_io((uint8_t)index, watch);
+      else return 1;
+   }
+   else if (!strcmp(command, "export") && num_words == 1)
+   {
+      if (!state_export_is_open())
+      {
+         fprintf(stderr, "No export file was opened, see --export!\n");
+         return 2;
+      }
+      state_export_write();
+   }
+   else if (!strcmp(command, "regs") && num_words == 1)
+   {
+      print_registers();
+   }
+   else if (!strcmp(command, "stats") && num_words == 1)
+   {
+      control_unit_print_timing();
+   }
+   else if (!strcmp(command, "hotness") && num_words <= 2)
+   {
+      value = CPU_CONTROLLER_HOTNESS_ENTRIES;
+      if (num_words == 2 && parse_number(words[1], &value)) return 1;
+      control_unit_print_hotness((size_t)value);
+   }
+   else if (!strcmp(command, "echo"))
+   {
+      for (size_t i = 1; i < num_words; ++i)
+      {
+         printf(i + 1 < num_words ? "%s " : "%s", words[i]);
+      }
+      printf("\n");
+   }
+   else
+   {
+      return 1;
+   }
+   return 0;
+}
+
+/********************************************************************************
+* split_words: Splits specified line into words separated by white space and
+*              returns the number of words, at most one more than the max
+*              number of words of a command.
+*
+*              - line : The line, which is modified in place.
+*              - words: Reference to storage for the words.
+********************************************************************************/
+static size_t split_words(char* line,
+                          char** words)
+{
+   static const char* separators = " \t\r\n";
+   size_t num_words = 0;
+
+   for (char* i = line; num_words <= CPU_CONTROLLER_SCRIPT_MAX_WORDS; )
+   {
+      i += strspn(i, separators);
+      if (!*i) break;
+      words[num_words++] = i;
+      i += strcspn(i, separators);
+      if (*i) *i++ = '\0';
+   }
+   return num_words;
+}
+
+/********************************************************************************
+* parse_number: Parses specified text as a decimal number, or hexadecimal
+*               with prefix 0x. After success, 0 is returned. If the text
+*               isn't a number, error code 1 is returned.
+*
+*               - text : The text to parse.
+*               - value: Reference to storage for the number.
+********************************************************************************/
+static int parse_number(const char* text,
+                        uint64_t* value)
+{
+   char* end;
+   if (*text < '0' || *text > '9') return 1;
+   *value = strtoull(text, &end, 0);
+   return *end != '\0';
+}
+
+/********************************************************************************
+* parse_target: Parses specified target of a set or expect command. After
+*               success, 0 is returned. If the target is unknown, error code
+*               1 is returned.
+*
+*               - text  : The target, for instance r16, pinb or 0x100.
+*               - target: Reference to storage for the kind of target.
+*               - index : Reference to storage for the register or address.
+********************************************************************************/
+static int parse_target(const char* text,
+                        enum script_target* target,
+                        uint16_t* index)
+{
+   uint64_t value;
+   *index = 0;
+
+   if ((text[0] == 'r' || text[0] == 'R') && !parse_number(text + 1, &value))
+   {
+      if (value >= CPU_REGISTER_ADDRESS_WIDTH) return 1;
+      *target = SCRIPT_TARGET_REGISTER;
+      *index = (uint16_t)value;
+      return 0;
+   }
+   else if (!parse_number(text, &value))
+   {
+      if (value >= DATA_MEMORY_ADDRESS_WIDTH) return 1;
+      *target = SCRIPT_TARGET_DATA;
+      *index = (uint16_t)value;
+      return 0;
+   }
+
+   for (size_t i = 0; i < sizeof(script_io_registers) / sizeof(script_io_registers[0]); ++i)
+   {
+      if (!strcmp(text, script_io_registers[i].name))
+      {
+         *target = SCRIPT_TARGET_DATA;
+         *index = script_io_registers[i].address;
+         return 0;
+      }
+   }
+
+   if (!strcmp(text, "pc"))                 *target = SCRIPT_TARGET_PC;
+   else if (!strcmp(text, "sr"))            *target = SCRIPT_TARGET_SR;
+   else if (!strcmp(text, "sp"))            *target = SCRIPT_TARGET_SP;
+   else if (!strcmp(text, "cycles"))        *target = SCRIPT_TARGET_CYCLES;
+   else if (!strcmp(text, "instructions"))  *target = SCRIPT_TARGET_INSTRUCTIONS;
+   else return 1;
+   return 0;
+}
+
+/********************************************************************************
+* read_target: Returns the value of specified target. Data memory is read
+*              without I/O hooks and watchpoints.
+*
+*              - target: The kind of target.
+*              - index : The register or address of the target.
+********************************************************************************/
+static uint64_t read_target(const enum script_target target,
+                            const uint16_t index)
+{
+   if (target == SCRIPT_TARGET_REGISTER)    return control_unit_register((uint8_t)index);
+   else if (target == SCRIPT_TARGET_DATA)   return data_memory_content[index];
+   else if (target == SCRIPT_TARGET_PC)     return control_unit_program_counter();
+   else if (target == SCRIPT_TARGET_SR)     return control_unit_status_register();
+   else if (target == SCRIPT_TARGET_SP)     return stack_pointer();
+   else if (target == SCRIPT_TARGET_CYCLES) return control_unit_cycle_count();
+   else                                     return control_unit_instruction_count();
+}
+
+/********************************************************************************
+* write_target: Writes specified value to specified target. After success, 0
+*               is returned. If the target is read only or the value doesn't
+*               fit, error code 1 is returned.
+*
+*               - target: The kind of target.
+*               - index : The register or address of the target.
+*               - value : The value to write.
+********************************************************************************/
+static int write_target(const enum script_target target,
+                        const uint16_t index,
+                        const uint64_t value)
+{
+   if (target == SCRIPT_TARGET_PC)
+   {
+      if (value >= PROGRAM_MEMORY_ADDRESS_WIDTH) return 1;
+      control_unit_set_program_counter((uint16_t)value);
+   }
+   else if (target == SCRIPT_TARGET_SP)
+   {
+      if (value > UINT16_MAX) return 1;
+      stack_set_pointer((uint16_t)value);
+   }
+   else if (value > UINT8_MAX)
+   {
+      return 1;
+   }
+   else if (target == SCRIPT_TARGET_REGISTER)
+   {
+      control_unit_set_register((uint8_t)index, (uint8_t)value);
+   }
+   else if (target == SCRIPT_TARGET_DATA)
+   {
+      data_memory_write(index, (uint8_t)value);
+   }
+   else if (target == SCRIPT_TARGET_SR)
+   {
+      control_unit_set_status_register((uint8_t)value);
+   }
+   else
+   {
+      return 1;
+   }
+   return 0;
+}
+
+/********************************************************************************
+* print_registers: Prints all CPU registers, eight per line, followed by the
+*                  program counter, status register and stack pointer.
+********************************************************************************/
+static void print_registers(void)
+{
+   char label[12];
+
+   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; i += 8)
+   {
+      snprintf(label, sizeof(label), "R%u-R%u:", i, i + 7);
+      printf("%-9s", label);
+
+      for (uint8_t j = i; j < i + 8; ++j)
+      {
+         printf(" 0x%02X", control_unit_register(j));
+      }
+      printf("\n");
+   }
+
+   printf("PC: %hu  SR (ISNZVC): %s  SP: 0x%04X  Cycles: %llu  Instructions: %llu\n\n",
+          control_unit_program_counter(), cpu_binary_byte(control_unit_status_register()) + 2, /* Six flags. */
+          stack_pointer(), (unsigned long long)control_unit_cycle_count(),
+          (unsigned long long)control_unit_instruction_count());
+   return;
+}
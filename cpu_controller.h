@@ -1,18 +1,66 @@
-/********************************************************************************
-* cpu_controller.h: Contains functionality for control of the program flow 
-*                   by input from the keyboard.
-********************************************************************************/
-#ifndef CPU_CONTROLLER_H_
-#define CPU_CONTROLLER_H_
-
-/* Include directives: */
-#include "cpu.h"
-#include "control_unit.h"
-
-/********************************************************************************
-* cpu_controller_run_by_input: Controls the program flow and input to the PINB
-*                              register by input from the keyboard.
-********************************************************************************/
-void cpu_controller_run_by_input(void);
-
+/********************************************************************************
+* cpu_controller.h: Contains functionality for control of the program flow 
+*                   by input from the keyboard.
+********************************************************************************/
+#ifndef CPU_CONTROLLER_H_
+#define CPU_CONTROLLER_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "control_unit.h"
+#include "state_delta.h"
+#include "state_export.h"
+
+/********************************************************************************
+* cpu_controller_run_by_input: Controls the program flow and input to the PINB
+*                              register by input from the keyboard.
+********************************************************************************/
+void cpu_controller_run_by_input(void);
+
+/********************************************************************************
+* cpu_controller_run_script: Controls the program flow by a script of
+*                            commands, one per line, without printing the
+*                            machine state unless a command requests it.
+*                            Words are separated by spaces and text after '#'
+*                            is ignored. Numbers are decimal, or hexadecimal
+*                            with prefix 0x. The following commands exist:
+*
+*                            step [n]               : Executes n instructions (default 1).
+*                            run <cycles>           : Runs the number of clock cycles.
+*                            until <address> [max]  : Runs until the instruction at the
+*                                                     address, at most max clock cycles.
+*                            reset                  : Resets the system.
+*                            set <target> <value>   : Writes a value, e.g. set pinb 32.
+*                            expect <target> <value>: Fails unless the target holds value.
+*                            break <address>        : Sets a breakpoint.
+*                            delete <address>       : Removes a breakpoint.
+*                            print                  : Prints the processor state.
+*                            changes                : Prints the watched locations that
+*                                                     changed, see state_delta.h.
+*                            show <target>          : Adds a register, I/O location, stack
+*                                                     or all to the changes display.
+*                            hide <target>          : Removes them from the changes display.
+*                            export                 : Writes a record to the export file,
+*                                                     see state_export.h.
+*                            regs                   : Prints all CPU registers.
+*                            stats                  : Prints the timing statistics.
+*                            hotness [n]            : Prints the n most executed addresses.
+*                            echo <text>            : Prints the text.
+*                            exit                   : Ends the script.
+*
+*                            Targets are r0 - r31, pc, sr, sp, the I/O port
+*                            registers ddrb - pind, data memory addresses and,
+*                            for expect only, cycles and instructions. Writes
+*                            to data memory call the I/O hooks like the menu.
+*
+*                            Failed expectations and invalid commands are
+*                            reported on stderr with their line number and
+*                            the script continues. If the script couldn't be
+*                            opened or any command failed, 1 is returned,
+*                            otherwise 0.
+*
+*                            - path: Path to the script, or "-" for stdin.
+********************************************************************************/
+int cpu_controller_run_script(const char* path);
+
 #endif /* CPU_CONTROLLER_H_ */
\ No newline at end of file
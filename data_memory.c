@@ -1,64 +1,266 @@
-/********************************************************************************
-* data_memory.c: Contains function definitions for implementation of a 2 kB 
-*                data memory.
-********************************************************************************/
-#include "data_memory.h"
-
-/********************************************************************************
-* data: 2 kB data memory, 2000 x 8 bit storage capacity.
-********************************************************************************/
-static uint8_t data[DATA_MEMORY_ADDRESS_WIDTH];
-
-/********************************************************************************
-* data_memory_reset: Clears content of the entire data memory.
-********************************************************************************/
-void data_memory_reset(void)
-{
-   for (uint16_t i = 0; i < DATA_MEMORY_ADDRESS_WIDTH; ++i)
-   {
-      data[i] = 0x00;
-   }
-   return;
-}
-
-/********************************************************************************
-* data_memory_write: Writes specified 8-bit value to specified address in
-*                    data memory. After successful write, 0 is returned.
-*                    If an invalid address is specified, no write is done
-*                    and error code 1 is returned.
-*
-*                    - address: Write address in data memory.
-*                    - value  : 8-bit value to write to specified address.
-********************************************************************************/
-int data_memory_write(const uint16_t address,
-                      const uint8_t value)
-{
-   if (address < DATA_MEMORY_ADDRESS_WIDTH)
-   {
-      data[address] = value;
-      return 0;
-   }
-   else
-   {
-      return 1;
-   }
-}
-
-/********************************************************************************
-* data_memory_read: Returns 8-bit value read from specified read location
-*                   in data memory. If an invalid address is specified,
-*                   the value 0x00 is returned.
-*
-*                   - address: Read location in data memory.
-********************************************************************************/
-uint8_t data_memory_read(const uint16_t address)
-{
-   if (address < DATA_MEMORY_ADDRESS_WIDTH)
-   {
-      return data[address];
-   }
-   else
-   {
-      return 0x00;
-   }
-}
\ No newline at end of file
+/********************************************************************************
+* data_memory.c: Contains function definitions for implementation of a 2 kB 
+*                data memory.
+********************************************************************************/
+#include "data_memory.h"
+
+/********************************************************************************
+* data_memory_content: 2 kB data memory, 2000 x 8 bit storage capacity.
+*                      Exposed for the inline stack operations in stack.h.
+********************************************************************************/
+uint8_t data_memory_content[DATA_MEMORY_ADDRESS_WIDTH];
+
+/********************************************************************************
+* write_hooks, read_hooks: Hooks attached to the I/O locations, null for
+*                          locations that are plain memory.
+********************************************************************************/
+static data_memory_write_hook write_hooks[IO_REGISTER_ADDRESS_WIDTH];
+static data_memory_read_hook read_hooks[IO_REGISTER_ADDRESS_WIDTH];
+
+/********************************************************************************
+* data_memory_fast_write_pages, data_memory_fast_read_pages: One bit per page,
+*                               set if the page is plain memory for writes
+*                               and reads respectively. Cleared bits take the
+*                               slow path, hence the zero-initialized bitmaps
+*                               are valid before the first reset. Exposed for
+*                               the inline stack operations in stack.h.
+********************************************************************************/
+uint8_t data_memory_fast_write_pages[DATA_MEMORY_NUM_PAGES / 8];
+uint8_t data_memory_fast_read_pages[DATA_MEMORY_NUM_PAGES / 8];
+
+/********************************************************************************
+* watches: Watched accesses per address, see DATA_MEMORY_WATCH_*.
+********************************************************************************/
+static uint8_t watches[DATA_MEMORY_ADDRESS_WIDTH];
+static data_memory_watch_handler watch_handler;
+
+/* Static functions: */
+static int write_slow(const uint16_t address,
+                      const uint8_t value);
+static uint8_t read_slow(const uint16_t address);
+static void update_page(const uint16_t page);
+
+/********************************************************************************
+* data_memory_reset: Clears content of the entire data memory.
+********************************************************************************/
+void data_memory_reset(void)
+{
+   for (uint16_t i = 0; i < DATA_MEMORY_ADDRESS_WIDTH; ++i)
+   {
+      data_memory_content[i] = 0x00;
+   }
+
+   for (uint16_t i = 0; i < DATA_MEMORY_NUM_PAGES; ++i)
+   {
+      update_page(i);
+   }
+   return;
+}
+
+/********************************************************************************
+* data_memory_write: Writes specified 8-bit value to specified address in
+*                    data memory. After successful write, 0 is returned.
+*                    If an invalid address is specified, no write is done
+*                    and error code 1 is returned.
+*
+*                    - address: Write address in data memory.
+*                    - value  : 8-bit value to write to specified address.
+********************************************************************************/
+int data_memory_write(const uint16_t address,
+                      const uint8_t value)
+{
+   if (data_memory_plain_write(address))
+   {
+      data_memory_content[address] = value;
+      return 0;
+   }
+   return write_slow(address, value);
+}
+
+/********************************************************************************
+* data_memory_read: Returns 8-bit value read from specified read location
+*                   in data memory. If an invalid address is specified,
+*                   the value 0x00 is returned.
+*
+*                   - address: Read location in data memory.
+********************************************************************************/
+uint8_t data_memory_read(const uint16_t address)
+{
+   if (data_memory_plain_read(address))
+   {
+      return data_memory_content[address];
+   }
+   return read_slow(address);
+}
+
+/********************************************************************************
+* data_memory_set_io_hooks: Attaches hooks to specified I/O location, which
+*                           are called on every write and read of the
+*                           location. A null pointer detaches the hook.
+*                           After successful attachment, 0 is returned.
+*                           If the address is not an I/O location, error
+*                           code 1 is returned.
+*
+*                           - address   : The I/O location.
+*                           - write_hook: Hook called on writes (or null).
+*                           - read_hook : Hook called on reads (or null).
+********************************************************************************/
+int data_memory_set_io_hooks(const uint16_t address,
+                             data_memory_write_hook write_hook,
+                             data_memory_read_hook read_hook)
+{
+   if (address < IO_REGISTER_ADDRESS_WIDTH)
+   {
+      write_hooks[address] = write_hook;
+      read_hooks[address] = read_hook;
+      update_page(address >> DATA_MEMORY_PAGE_SHIFT);
+      return 0;
+   }
+   else
+   {
+      return 1;
+   }
+}
+
+/********************************************************************************
+* data_memory_set_watch: Watches the accesses specified by access to the
+*                        specified address range, replacing any previous
+*                        watch of the addresses. Access 0 removes the watch.
+*                        Watches are kept on reset. Since the stack
+*                        operations access data_memory_content directly,
+*                        pushes and pops are not watched. After success, 0
+*                        is returned. If the range is outside the data
+*                        memory, error code 1 is returned.
+*
+*                        - first : The first watched address.
+*                        - last  : The last watched address.
+*                        - access: DATA_MEMORY_WATCH_READ and/or
+*                                  DATA_MEMORY_WATCH_WRITE, or 0.
+********************************************************************************/
+int data_memory_set_watch(const uint16_t first,
+                          const uint16_t last,
+                          const uint8_t access)
+{
+   if (first > last || last >= DATA_MEMORY_ADDRESS_WIDTH) return 1;
+
+   for (uint16_t i = first; i <= last; ++i)
+   {
+      watches[i] = access & (DATA_MEMORY_WATCH_READ | DATA_MEMORY_WATCH_WRITE);
+   }
+
+   for (uint16_t i = first >> DATA_MEMORY_PAGE_SHIFT; i <= last >> DATA_MEMORY_PAGE_SHIFT; ++i)
+   {
+      update_page(i);
+   }
+   return 0;
+}
+
+/********************************************************************************
+* data_memory_watch: Returns the watched accesses of specified address.
+*
+*                    - address: The address in data memory.
+********************************************************************************/
+uint8_t data_memory_watch(const uint16_t address)
+{
+   return address < DATA_MEMORY_ADDRESS_WIDTH ? watches[address] : 0;
+}
+
+/********************************************************************************
+* data_memory_set_watch_handler: Sets the function called on accesses to
+*                                watched addresses. A null pointer disables
+*                                notification without removing the watches.
+*
+*                                - handler: The new watch handler (or null).
+********************************************************************************/
+void data_memory_set_watch_handler(data_memory_watch_handler handler)
+{
+   watch_handler = handler;
+   return;
+}
+
+/********************************************************************************
+* write_slow: Writes specified value to an address on a page that isn't
+*             plain memory, via the watch handler and the I/O hook of the
+*             address. After successful write, 0 is returned. If the address
+*             is outside the data memory, error code 1 is returned.
+*
+*             - address: Write address in data memory.
+*             - value  : 8-bit value to write to specified address.
+********************************************************************************/
+static int write_slow(const uint16_t address,
+                      const uint8_t value)
+{
+   if (address >= DATA_MEMORY_ADDRESS_WIDTH) return 1;
+
+   if ((watches[address] & DATA_MEMORY_WATCH_WRITE) && watch_handler)
+   {
+      watch_handler(address, value, DATA_MEMORY_WATCH_WRITE);
+   }
+
+   if (address < IO_REGISTER_ADDRESS_WIDTH && write_hooks[address])
+   {
+      data_memory_content[address] = write_hooks[address](address, value);
+   }
+   else
+   {
+      data_memory_content[address] = value;
+   }
+   return 0;
+}
+
+/********************************************************************************
+* read_slow: Returns the value read from an address on a page that isn't
+*            plain memory, via the watch handler and the I/O hook of the
+*            address. If the address is outside the data memory, the value
+*            0x00 is returned.
+*
+*            - address: Read location in data memory.
+********************************************************************************/
+static uint8_t read_slow(const uint16_t address)
+{
+   if (address >= DATA_MEMORY_ADDRESS_WIDTH) return 0x00;
+
+   if ((watches[address] & DATA_MEMORY_WATCH_READ) && watch_handler)
+   {
+      watch_handler(address, data_memory_content[address], DATA_MEMORY_WATCH_READ);
+   }
+
+   if (address < IO_REGISTER_ADDRESS_WIDTH && read_hooks[address])
+   {
+      return read_hooks[address](address, data_memory_content[address]);
+   }
+   return data_memory_content[address];
+}
+
+/********************************************************************************
+* update_page: Updates the bits of specified page in the page bitmaps. A page
+*              is fast for writes if it's within the data memory and contains
+*              no write hooks or write watches, and likewise for reads.
+*
+*              - page: Index of the page.
+********************************************************************************/
+static void update_page(const uint16_t page)
+{
+   const uint32_t first = (uint32_t)page << DATA_MEMORY_PAGE_SHIFT;
+   const uint8_t bit = 1 << (page & 7);
+   bool fast_write = first + DATA_MEMORY_PAGE_SIZE <= DATA_MEMORY_ADDRESS_WIDTH;
+   bool fast_read = fast_write;
+
+   for (uint32_t i = first; (fast_write || fast_read) && i < first + DATA_MEMORY_PAGE_SIZE; ++i)
+   {
+      if (watches[i] & DATA_MEMORY_WATCH_WRITE) fast_write = false;
+      if (watches[i] & DATA_MEMORY_WATCH_READ) fast_read = false;
+
+      if (i < IO_REGISTER_ADDRESS_WIDTH)
+      {
+         if (write_hooks[i]) fast_write = false;
+         if (read_hooks[i]) fast_read = false;
+      }
+   }
+
+   data_memory_fast_write_pages[page >> 3] = fast_write ? data_memory_fast_write_pages[page >> 3] | bit :
+      data_memory_fast_write_pages[page >> 3] & ~bit;
+   data_memory_fast_read_pages[page >> 3] = fast_read ? data_memory_fast_read_pages[page >> 3] | bit :
+      data_memory_fast_read_pages[page >> 3] & ~bit;
+   return;
+}
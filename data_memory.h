@@ -1,41 +1,192 @@
-/********************************************************************************
-* data_memory.h: Contains function declarations and macro definitions for
-*                implementation of a 2 kB data memory.
-********************************************************************************/
-#ifndef DATA_MEMORY_H_
-#define DATA_MEMORY_H_
-
-/* Include directives: */
-#include "cpu.h"
-
-/* Macro definitions: */
-#define DATA_MEMORY_ADDRESS_WIDTH 2000 /* 2000 unique address in data memory. */
-#define DATA_MEMORY_DATA_WITDH    8    /* 8 bit storage capacity per address. */
-
-/********************************************************************************
-* data_memory_reset: Clears content of the entire data memory.
-********************************************************************************/
-void data_memory_reset(void);
-
-/********************************************************************************
-* data_memory_write: Writes specified 8-bit value to specified address in 
-*                    data memory. After successful write, 0 is returned.
-*                    If an invalid address is specified, no write is done
-*                    and error code 1 is returned.
-* 
-*                    - address: Write address in data memory.
-*                    - value  : 8-bit value to write to specified address.
-********************************************************************************/
-int data_memory_write(const uint16_t address,
-                      const uint8_t value);
-
-/********************************************************************************
-* data_memory_read: Returns 8-bit value read from specified read location
-*                   in data memory. If an invalid address is specified, 
-*                   the value 0x00 is returned.
-* 
-*                   - address: Read location in data memory.
-********************************************************************************/
-uint8_t data_memory_read(const uint16_t address);
-
+/********************************************************************************
+* data_memory.h: Contains function declarations and macro definitions for
+*                implementation of a 2 kB data memory.
+*
+*                Accesses are checked against a bitmap with one bit per page
+*                of DATA_MEMORY_PAGE_SIZE addresses, covering the complete
+*                16-bit address space. Pages containing I/O locations with
+*                hooks, watched addresses or addresses outside the memory
+*                take a slow path; all other accesses take a single bit test.
+********************************************************************************/
+#ifndef DATA_MEMORY_H_
+#define DATA_MEMORY_H_
+
+/* Include directives: */
+#include "cpu.h"
+
+/* Macro definitions: */
+#define DATA_MEMORY_ADDRESS_WIDTH 2000 /* 2000 unique address in data memory. */
+#define DATA_MEMORY_DATA_WITDH    8    /* 8 bit storage capacity per address. */
+#define DATA_MEMORY_PAGE_SHIFT    4    /* Number of address bits within a page. */
+#define DATA_MEMORY_PAGE_SIZE     (1 << DATA_MEMORY_PAGE_SHIFT) /* 16 addresses per page. */
+#define DATA_MEMORY_NUM_PAGES     (65536 >> DATA_MEMORY_PAGE_SHIFT) /* Pages of the 16-bit address space. */
+
+#define DATA_MEMORY_WATCH_READ    0x01 /* Watch reads of an address. */
+#define DATA_MEMORY_WATCH_WRITE   0x02 /* Watch writes of an address. */
+
+/********************************************************************************
+* data_memory_content: The data memory, exposed so that hot paths such as the
+*                      stack operations can access plain memory without a
+*                      function call. The I/O hooks are bypassed, hence only
+*                      locations without hooks may be accessed directly.
+********************************************************************************/
+extern uint8_t data_memory_content[DATA_MEMORY_ADDRESS_WIDTH];
+
+/********************************************************************************
+* data_memory_fast_write_pages, data_memory_fast_read_pages: One bit per page,
+*                               set if the page is plain memory for writes
+*                               and reads respectively. Exposed so that the
+*                               inline stack operations can send accesses to
+*                               watched pages through the slow path.
+********************************************************************************/
+extern uint8_t data_memory_fast_write_pages[DATA_MEMORY_NUM_PAGES / 8];
+extern uint8_t data_memory_fast_read_pages[DATA_MEMORY_NUM_PAGES / 8];
+
+/********************************************************************************
+* data_memory_write_hook: Function called instead of a plain write to an I/O
+*                         location, for instance to let a peripheral react on
+*                         the write. The returned value is stored at the
+*                         address in data memory.
+*
+*                         - address: The written I/O location.
+*                         - value  : The value written by the CPU.
+********************************************************************************/
+typedef uint8_t (*data_memory_write_hook)(const uint16_t address,
+                                          const uint8_t value);
+
+/********************************************************************************
+* data_memory_read_hook: Function called instead of a plain read from an I/O
+*                        location, for instance to let a peripheral return
+*                        its current register content. The returned value
+*                        is the value read by the CPU.
+*
+*                        - address: The read I/O location.
+*                        - value  : The value stored at the address.
+********************************************************************************/
+typedef uint8_t (*data_memory_read_hook)(const uint16_t address,
+                                         const uint8_t value);
+
+/********************************************************************************
+* data_memory_watch_handler: Function called when a watched address is
+*                            accessed, before the access is done, so that
+*                            the current value is still stored in
+*                            data_memory_content.
+*
+*                            - address: The accessed address.
+*                            - value  : The value written, or the stored
+*                                       value for reads.
+*                            - access : DATA_MEMORY_WATCH_READ or
+*                                       DATA_MEMORY_WATCH_WRITE.
+********************************************************************************/
+typedef void (*data_memory_watch_handler)(const uint16_t address,
+                                          const uint8_t value,
+                                          const uint8_t access);
+
+/********************************************************************************
+* data_memory_reset: Clears content of the entire data memory.
+********************************************************************************/
+void data_memory_reset(void);
+
+/********************************************************************************
+* data_memory_write: Writes specified 8-bit value to specified address in 
+*                    data memory. After successful write, 0 is returned.
+*                    If an invalid address is specified, no write is done
+*                    and error code 1 is returned.
+* 
+*                    - address: Write address in data memory.
+*                    - value  : 8-bit value to write to specified address.
+********************************************************************************/
+int data_memory_write(const uint16_t address,
+                      const uint8_t value);
+
+/********************************************************************************
+* data_memory_read: Returns 8-bit value read from specified read location
+*                   in data memory. If an invalid address is specified, 
+*                   the value 0x00 is returned.
+* 
+*                   - address: Read location in data memory.
+********************************************************************************/
+uint8_t data_memory_read(const uint16_t address);
+
+/********************************************************************************
+* data_memory_set_io_hooks: Attaches hooks to specified I/O location, which
+*                           are called on every write and read of the
+*                           location. A null pointer detaches the hook.
+*                           After successful attachment, 0 is returned.
+*                           If the address is not an I/O location, error
+*                           code 1 is returned.
+*
+*                           - address   : The I/O location.
+*                           - write_hook: Hook called on writes (or null).
+*                           - read_hook : Hook called on reads (or null).
+********************************************************************************/
+int data_memory_set_io_hooks(const uint16_t address,
+                             data_memory_write_hook write_hook,
+                             data_memory_read_hook read_hook);
+
+
+/********************************************************************************
+* data_memory_set_watch: Watches the accesses specified by access to the
+*                        specified address range, replacing any previous
+*                        watch of the addresses. Access 0 removes the watch.
+*                        Watches are kept on reset. Pushes and pops are
+*                        watched like other accesses, but the stack pointer
+*                        registers SPL and SPH are updated directly by the
+*                        stack operations and not watched. After success, 0
+*                        is returned. If the range is outside the data
+*                        memory, error code 1 is returned.
+*
+*                        - first : The first watched address.
+*                        - last  : The last watched address.
+*                        - access: DATA_MEMORY_WATCH_READ and/or
+*                                  DATA_MEMORY_WATCH_WRITE, or 0.
+********************************************************************************/
+int data_memory_set_watch(const uint16_t first,
+                          const uint16_t last,
+                          const uint8_t access);
+
+/********************************************************************************
+* data_memory_watch: Returns the watched accesses of specified address.
+*
+*                    - address: The address in data memory.
+********************************************************************************/
+uint8_t data_memory_watch(const uint16_t address);
+
+/********************************************************************************
+* data_memory_set_watch_handler: Sets the function called on accesses to
+*                                watched addresses. A null pointer disables
+*                                notification without removing the watches.
+*
+*                                - handler: The new watch handler (or null).
+********************************************************************************/
+void data_memory_set_watch_handler(data_memory_watch_handler handler);
+
+/********************************************************************************
+* data_memory_plain_write: Indicates if a write to specified address can be
+*                          done directly in data_memory_content, i.e. if its
+*                          page has no write hooks or write watches and is
+*                          within the data memory.
+*
+*                          - address: The written address.
+********************************************************************************/
+static inline bool data_memory_plain_write(const uint16_t address)
+{
+   return data_memory_fast_write_pages[address >> (DATA_MEMORY_PAGE_SHIFT + 3)] &
+      (1 << ((address >> DATA_MEMORY_PAGE_SHIFT) & 7));
+}
+
+/********************************************************************************
+* data_memory_plain_read: Indicates if a read from specified address can be
+*                         done directly in data_memory_content, i.e. if its
+*                         page has no read hooks or read watches and is
+*                         within the data memory.
+*
+*                         - address: The read address.
+********************************************************************************/
+static inline bool data_memory_plain_read(const uint16_t address)
+{
+   return data_memory_fast_read_pages[address >> (DATA_MEMORY_PAGE_SHIFT + 3)] &
+      (1 << ((address >> DATA_MEMORY_PAGE_SHIFT) & 7));
+}
+
 #endif /* DATA_MEMORY_H_ */
\ No newline at end of file
@@ -0,0 +1,492 @@
+/********************************************************************************
+* engine_diff.c: Contains static variables and function definitions for the
+*                differential testing of the execution engines.
+********************************************************************************/
+#include "engine_diff.h"
+#include <string.h>
+
+/* Macro definitions: */
+#define ENGINE_DIFF_NONE SIZE_MAX /* Returned if no interval or instruction diverged. */
+
+/********************************************************************************
+* engine_diff_state: Structure for the compared machine state, the CPU state
+*                    and data memory plus the peripheral state outside of
+*                    the I/O registers.
+********************************************************************************/
+struct engine_diff_state
+{
+   struct trace_checkpoint cpu; /* Registers, data memory, cycle and instruction counts. */
+   uint64_t next_event;         /* Clock cycle of the next scheduled event. */
+   uint8_t timer_interrupt;     /* Indicates if a timer interrupt is pending. */
+   uint8_t uart_interrupt;      /* Indicates if a UART interrupt is pending. */
+};
+
+/* Static functions: */
+static int test_engine(const struct engine_diff_config* config,
+                       const size_t program,
+                       const enum control_unit_engine engine,
+                       const uint64_t* reference,
+                       const size_t num_intervals,
+                       uint64_t* steps);
+static size_t record_intervals(const struct engine_diff_config* config,
+                               const size_t program,
+                               const size_t max_intervals,
+                               uint64_t* hashes);
+static size_t find_interval(const struct engine_diff_config* config,
+                            const size_t program,
+                            const enum control_unit_engine engine,
+                            const uint64_t* reference,
+                            const size_t num_intervals);
+static size_t find_instruction(const struct engine_diff_config* config,
+                               const size_t program,
+                               const enum control_unit_engine engine,
+                               const size_t interval,
+                               uint64_t* steps);
+static void replay(const struct engine_diff_config* config,
+                   const size_t program,
+                   const enum control_unit_engine engine,
+                   const size_t num_intervals,
+                   const uint64_t num_instructions);
+static void print_divergence(const enum control_unit_engine engine,
+                             const bool instruction_found);
+static void print_instruction(const char* label,
+                              const uint16_t address);
+static void load_program(const size_t program);
+static const char* program_name(const size_t program);
+static void capture_state(struct engine_diff_state* state);
+static uint64_t state_hash(void);
+
+/* Static variables: */
+static struct engine_diff_state state;    /* State of the last hash. */
+static struct engine_diff_state before;   /* State before the diverging instruction. */
+static struct engine_diff_state expected; /* State of the reference engine at the divergence. */
+static struct engine_diff_state actual;   /* State of the tested engine at the divergence. */
+
+/********************************************************************************
+* engine_diff_run: Runs the program and all benchmark kernels on every fast
+*                  engine in lockstep with the reference engine and prints
+*                  the result per program and engine, with the first
+*                  divergence if any. The system is reset afterwards. If no
+*                  engine diverged, 0 is returned, otherwise error code 1,
+*                  which is also returned if the hashes of all intervals
+*                  can't be stored or memory couldn't be allocated.
+*
+*                  - config: The test parameters.
+********************************************************************************/
+int engine_diff_run(const struct engine_diff_config* config)
+{
+   const struct engine_diff_config self = { config->cycles, config->interval < 1 ? 1 :
+      config->interval > ENGINE_DIFF_MAX_INTERVAL ? ENGINE_DIFF_MAX_INTERVAL : config->interval };
+   const uint64_t num_intervals = self.cycles / self.interval + (self.cycles % self.interval ? 1 : 0);
+   const size_t max_intervals = (size_t)num_intervals;
+   uint64_t* reference;
+   uint64_t* steps;
+   int result = 0;
+
+   if (num_intervals > SIZE_MAX / sizeof(uint64_t) - 1)
+   {
+      fprintf(stderr, "Too many intervals of %llu clock cycles in %llu clock cycles!\n",
+              (unsigned long long)self.interval, (unsigned long long)self.cycles);
+      return 1;
+   }
+
+   reference = (uint64_t*)malloc((max_intervals + 1) * sizeof(uint64_t));
+   steps = (uint64_t*)malloc(((size_t)self.interval + 1) * sizeof(uint64_t));
+
+   if (!reference || !steps)
+   {
+      fprintf(stderr, "Could not allocate the hashes of %llu intervals!\n", (unsigned long long)num_intervals);
+      free(reference);
+      free(steps);
+      return 1;
+   }
+
+   printf("Testing %d engines against the %s engine, %llu clock cycles compared every %llu...\n\n",
+          CONTROL_UNIT_NUM_ENGINES - 1, control_unit_engine_name(CONTROL_UNIT_ENGINE_STEP),
+          (unsigned long long)self.cycles, (unsigned long long)self.interval);
+
+   for (size_t i = 0; i <= benchmark_kernel_count(); ++i)
+   {
+      const size_t num_intervals = record_intervals(&self, i, max_intervals, reference);
+
+      for (int engine = 0; engine < CONTROL_UNIT_NUM_ENGINES; ++engine)
+      {
+         if (engine == CONTROL_UNIT_ENGINE_STEP) continue;
+         if (test_engine(&self, i, (enum control_unit_engine)engine, reference, num_intervals, steps))
+         {
+            result = 1;
+         }
+      }
+   }
+
+   benchmark_unload_kernel();
+   free(reference);
+   free(steps);
+   printf("\n%s\n", result ? "The engines diverged." : "All engines matched the reference engine.");
+   return result;
+}
+
+/********************************************************************************
+* test_engine: Compares specified engine with the recorded hashes of the
+*              reference engine for specified program and prints the result.
+*              On divergence, the first diverging instruction is searched
+*              and printed, and 1 is returned. Otherwise 0 is returned.
+*
+*              - config       : The test parameters.
+*              - program      : Index of the program, 0 for the program
+*                               itself, otherwise a benchmark kernel.
+*              - engine       : The tested execution engine.
+*              - reference    : Hashes of the reference engine per interval.
+*              - num_intervals: The number of recorded intervals.
+*              - steps        : Storage for hashes per instruction of an interval.
+********************************************************************************/
+static int test_engine(const struct engine_diff_config* config,
+                       const size_t program,
+                       const enum control_unit_engine engine,
+                       const uint64_t* reference,
+                       const size_t num_intervals,
+                       uint64_t* steps)
+{
+   const size_t interval = find_interval(config, program, engine, reference, num_intervals);
+
+   if (interval == ENGINE_DIFF_NONE)
+   {
+      printf("%-10s %-6s OK, %llu states compared\n", program_name(program),
+             control_unit_engine_name(engine), (unsigned long long)num_intervals + 1);
+      return 0;
+   }
+
+   printf("%-10s %-6s DIVERGED in interval %llu\n", program_name(program),
+          control_unit_engine_name(engine), (unsigned long long)interval);
+
+   if (!interval)
+   {
+      replay(config, program, CONTROL_UNIT_ENGINE_STEP, 0, 0);
+      capture_state(&expected);
+      replay(config, program, engine, 0, 0);
+      capture_state(&actual);
+      before = expected;
+      print_divergence(engine, false);
+      return 1;
+   }
+
+   const size_t step = find_instruction(config, program, engine, interval - 1, steps);
+
+   if (step == ENGINE_DIFF_NONE)
+   {
+      replay(config, program, CONTROL_UNIT_ENGINE_STEP, interval - 1, 0);
+      capture_state(&before);
+      replay(config, program, CONTROL_UNIT_ENGINE_STEP, interval, 0);
+      capture_state(&expected);
+      replay(config, program, engine, interval, 0);
+      capture_state(&actual);
+      print_divergence(engine, false);
+      return 1;
+   }
+
+   replay(config, program, CONTROL_UNIT_ENGINE_STEP, interval - 1, step - 1);
+   capture_state(&before);
+   control_unit_run_engine(CONTROL_UNIT_ENGINE_STEP, 1);
+   capture_state(&expected);
+   replay(config, program, engine, interval - 1, step);
+   capture_state(&actual);
+   print_divergence(engine, true);
+   return 1;
+}
+
+/********************************************************************************
+* record_intervals: Runs specified program on the reference engine and stores
+*                   the hash of the state at reset and at the end of each
+*                   interval. The run ends early if the CPU stops. The number
+*                   of recorded intervals is returned.
+*
+*                   - config       : The test parameters.
+*                   - program      : Index of the program.
+*                   - max_intervals: The number of intervals in the test cycles.
+*                   - hashes       : Storage for max_intervals + 1 hashes.
+********************************************************************************/
+static size_t record_intervals(const struct engine_diff_config* config,
+                               const size_t program,
+                               const size_t max_intervals,
+                               uint64_t* hashes)
+{
+   load_program(program);
+   hashes[0] = state_hash();
+
+   for (size_t i = 1; i <= max_intervals; ++i)
+   {
+      control_unit_run_engine(CONTROL_UNIT_ENGINE_STEP, config->interval);
+      hashes[i] = state_hash();
+      if (control_unit_stop_reason() != CPU_STOP_NONE) return i;
+   }
+   return max_intervals;
+}
+
+/********************************************************************************
+* find_interval: Runs specified program on specified engine and returns the
+*                first interval at whose end the state differs from the
+*                reference engine, 0 for a difference right after reset, or
+*                ENGINE_DIFF_NONE if all states match.
+*
+*                - config       : The test parameters.
+*                - program      : Index of the program.
+*                - engine       : The tested execution engine.
+*                - reference    : Hashes of the reference engine per interval.
+*                - num_intervals: The number of recorded intervals.
+********************************************************************************/
+static size_t find_interval(const struct engine_diff_config* config,
+                            const size_t program,
+                            const enum control_unit_engine engine,
+                            const uint64_t* reference,
+                            const size_t num_intervals)
+{
+   load_program(program);
+   if (state_hash() != reference[0]) return 0;
+
+   for (size_t i = 1; i <= num_intervals; ++i)
+   {
+      control_unit_run_engine(engine, config->interval);
+      if (state_hash() != reference[i]) return i;
+   }
+   return ENGINE_DIFF_NONE;
+}
+
+/********************************************************************************
+* find_instruction: Replays specified number of intervals on each engine and
+*                   then runs one instruction at a time for the length of an
+*                   interval. The number of the first instruction after which
+*                   the state differs from the reference engine is returned,
+*                   counted from 1, or ENGINE_DIFF_NONE if the states match.
+*                   The latter happens if the engines only diverge when run
+*                   in longer stretches, for instance in event handling.
+*
+*                   - config  : The test parameters.
+*                   - program : Index of the program.
+*                   - engine  : The tested execution engine.
+*                   - interval: The number of intervals replayed first.
+*                   - steps   : Storage for hashes per instruction of an interval.
+********************************************************************************/
+static size_t find_instruction(const struct engine_diff_config* config,
+                               const size_t program,
+                               const enum control_unit_engine engine,
+                               const size_t interval,
+                               uint64_t* steps)
+{
+   replay(config, program, CONTROL_UNIT_ENGINE_STEP, interval, 0);
+
+   for (size_t i = 1; i <= config->interval; ++i)
+   {
+      control_unit_run_engine(CONTROL_UNIT_ENGINE_STEP, 1);
+      steps[i] = state_hash();
+   }
+
+   replay(config, program, engine, interval, 0);
+
+   for (size_t i = 1; i <= config->interval; ++i)
+   {
+      control_unit_run_engine(engine, 1);
+      if (state_hash() != steps[i]) return i;
+   }
+   return ENGINE_DIFF_NONE;
+}
+
+/********************************************************************************
+* replay: Runs specified program from reset on specified engine for specified
+*         number of intervals, followed by specified number of instructions.
+*         The intervals are run exactly like when recorded or compared.
+*
+*         - config          : The test parameters.
+*         - program         : Index of the program.
+*         - engine          : The execution engine.
+*         - num_intervals   : The number of intervals to run.
+*         - num_instructions: The number of instructions to run afterwards.
+********************************************************************************/
+static void replay(const struct engine_diff_config* config,
+                   const size_t program,
+                   const enum control_unit_engine engine,
+                   const size_t num_intervals,
+                   const uint64_t num_instructions)
+{
+   load_program(program);
+
+   for (size_t i = 0; i < num_intervals; ++i)
+   {
+      control_unit_run_engine(engine, config->interval);
+   }
+
+   for (uint64_t i = 0; i < num_instructions; ++i)
+   {
+      control_unit_run_engine(engine, 1);
+   }
+   return;
+}
+
+/********************************************************************************
+* print_divergence: Prints the divergence captured in the static states, i.e.
+*                   the instruction executed from the state before and each
+*                   difference between the expected and the actual state.
+*
+*                   - engine           : The tested execution engine.
+*                   - instruction_found: Indicates if the diverging instruction
+*                                        was found, otherwise the states
+*                                        span the diverging interval.
+********************************************************************************/
+static void print_divergence(const enum control_unit_engine engine,
+                             const bool instruction_found)
+{
+   const char* reference = control_unit_engine_name(CONTROL_UNIT_ENGINE_STEP);
+   size_t num_differences = 0;
+
+   printf("--------------------------------------------------------------------------------\n");
+
+   if (instruction_found)
+   {
+      printf("First divergence after instruction %llu at clock cycle %llu:\n",
+             (unsigned long long)expected.cpu.instructions, (unsigned long long)before.cpu.cycle);
+      print_instruction("Executed", before.cpu.pc);
+   }
+   else
+   {
+      printf("Divergence between clock cycle %llu and %llu, not reproduced per instruction:\n",
+             (unsigned long long)before.cpu.cycle, (unsigned long long)expected.cpu.cycle);
+      print_instruction("Started at", before.cpu.pc);
+   }
+
+   print_instruction(reference, expected.cpu.pc);
+   print_instruction(control_unit_engine_name(engine), actual.cpu.pc);
+   printf("\n%-12s %12s %12s\n", "Location", reference, control_unit_engine_name(engine));
+
+   if (expected.cpu.cycle != actual.cpu.cycle)
+   {
+      printf("%-12s %12llu %12llu\n", "Cycles", (unsigned long long)expected.cpu.cycle,
+             (unsigned long long)actual.cpu.cycle);
+   }
+   if (expected.cpu.instructions != actual.cpu.instructions)
+   {
+      printf("%-12s %12llu %12llu\n", "Instructions", (unsigned long long)expected.cpu.instructions,
+             (unsigned long long)actual.cpu.instructions);
+   }
+   if (expected.cpu.pc != actual.cpu.pc)
+   {
+      printf("%-12s       0x%04x       0x%04x\n", "PC", expected.cpu.pc, actual.cpu.pc);
+   }
+   if (expected.cpu.sp != actual.cpu.sp)
+   {
+      printf("%-12s       0x%04x       0x%04x\n", "SP", expected.cpu.sp, actual.cpu.sp);
+   }
+   if (expected.cpu.sr != actual.cpu.sr)
+   {
+      printf("%-12s %12s %12s\n", "SR", cpu_binary_byte(expected.cpu.sr), cpu_binary_byte(actual.cpu.sr));
+   }
+
+   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; ++i)
+   {
+      if (expected.cpu.reg[i] == actual.cpu.reg[i]) continue;
+      printf("R%-11u         0x%02x         0x%02x\n", i, expected.cpu.reg[i], actual.cpu.reg[i]);
+   }
+
+   if (expected.next_event != actual.next_event)
+   {
+      printf("%-12s %12llu %12llu\n", "Next event", (unsigned long long)expected.next_event,
+             (unsigned long long)actual.next_event);
+   }
+   if (expected.timer_interrupt != actual.timer_interrupt)
+   {
+      printf("%-12s %12u %12u\n", "Timer IRQ", expected.timer_interrupt, actual.timer_interrupt);
+   }
+   if (expected.uart_interrupt != actual.uart_interrupt)
+   {
+      printf("%-12s %12u %12u\n", "UART IRQ", expected.uart_interrupt, actual.uart_interrupt);
+   }
+
+   for (uint16_t i = 0; i < DATA_MEMORY_ADDRESS_WIDTH; ++i)
+   {
+      if (expected.cpu.data[i] == actual.cpu.data[i]) continue;
+      if (num_differences++ < ENGINE_DIFF_MAX_DIFFERENCES)
+      {
+         printf("[0x%04x]             0x%02x         0x%02x\n", i, expected.cpu.data[i], actual.cpu.data[i]);
+      }
+   }
+
+   if (num_differences > ENGINE_DIFF_MAX_DIFFERENCES)
+   {
+      printf("... and %llu more data memory differences\n",
+             (unsigned long long)(num_differences - ENGINE_DIFF_MAX_DIFFERENCES));
+   }
+
+   printf("--------------------------------------------------------------------------------\n\n");
+   return;
+}
+
+/********************************************************************************
+* print_instruction: Prints the instruction at specified address with its
+*                    subroutine and disassembly.
+*
+*                    - label  : Text printed before the instruction.
+*                    - address: Address in program memory.
+********************************************************************************/
+static void print_instruction(const char* label,
+                              const uint16_t address)
+{
+   char assembly[32];
+   cpu_disassemble(program_memory_read(address), assembly, sizeof(assembly));
+   printf("   %-10s 0x%04x <%s>: %s\n", label, address, program_memory_subroutine_name(address), assembly);
+   return;
+}
+
+/********************************************************************************
+* load_program: Resets the system and loads specified program.
+*
+*               - program: Index of the program, 0 for the program itself,
+*                          otherwise 1 + index of a benchmark kernel.
+********************************************************************************/
+static void load_program(const size_t program)
+{
+   if (program) benchmark_load_kernel(program - 1);
+   else benchmark_unload_kernel();
+   return;
+}
+
+/********************************************************************************
+* program_name: Returns the name of specified program.
+*
+*               - program: Index of the program.
+********************************************************************************/
+static const char* program_name(const size_t program)
+{
+   return program ? benchmark_kernel_name(program - 1) : "program";
+}
+
+/********************************************************************************
+* capture_state: Captures the compared machine state. The state is cleared
+*                first, so that padding doesn't affect its hash.
+*
+*                - state: Reference to storage for the state.
+********************************************************************************/
+static void capture_state(struct engine_diff_state* state)
+{
+   memset(state, 0, sizeof(*state));
+   control_unit_capture_state(&state->cpu);
+   state->next_event = event_queue_next_cycle();
+   state->timer_interrupt = timer_interrupt_pending();
+   state->uart_interrupt = uart_interrupt_pending();
+   return;
+}
+
+/********************************************************************************
+* state_hash: Captures the compared machine state and returns its 64-bit
+*             FNV-1a hash.
+********************************************************************************/
+static uint64_t state_hash(void)
+{
+   const uint8_t* bytes = (const uint8_t*)&state;
+   uint64_t hash = 0xcbf29ce484222325ULL;
+
+   capture_state(&state);
+
+   for (size_t i = 0; i < sizeof(state); ++i)
+   {
+      hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+   }
+   return hash;
+}
@@ -0,0 +1,59 @@
+/********************************************************************************
+* engine_diff.h: Contains definitions and function declarations for the
+*                differential testing of the execution engines. Every fast
+*                engine is run against the reference engine, which runs the
+*                instruction cycle state by state via
+*                control_unit_run_next_state, and the machine state is
+*                compared at a configurable interval of clock cycles. The
+*                compared state is the CPU registers, the data memory
+*                including the I/O registers, the cycle and instruction
+*                counts, the next scheduled event and the pending timer and
+*                UART interrupts. Internal peripheral state beyond that, such
+*                as the timer counters and the UART shift register, is only
+*                compared through its effects. The program and each
+*                benchmark kernel, see benchmark.h, are run from reset.
+*
+*                Since the machine state can't be saved and restored as a
+*                whole, the engines are kept in lockstep by replay: the
+*                reference engine records a hash of the state at the end of
+*                each interval and the fast engine is compared against the
+*                hashes with the same run lengths. The first diverging
+*                interval is replayed instruction by instruction to find the
+*                first diverging instruction, which is reported with its
+*                disassembly and the differences in the state. UART input
+*                isn't replayed, so it shouldn't be fed while testing.
+********************************************************************************/
+#ifndef ENGINE_DIFF_H_
+#define ENGINE_DIFF_H_
+
+/* Include directives: */
+#include "control_unit.h"
+#include "benchmark.h"
+
+/* Macro definitions: */
+#define ENGINE_DIFF_MAX_DIFFERENCES 32      /* Max number of data memory differences printed. */
+#define ENGINE_DIFF_MAX_INTERVAL    1000000 /* Max clock cycles between comparisons, bounds the replay storage. */
+
+/********************************************************************************
+* engine_diff_config: Structure for the parameters of a differential test.
+********************************************************************************/
+struct engine_diff_config
+{
+   uint64_t cycles;   /* Clock cycles run for the program and for each kernel. */
+   uint64_t interval; /* Clock cycles between comparisons, max ENGINE_DIFF_MAX_INTERVAL. */
+};
+
+/********************************************************************************
+* engine_diff_run: Runs the program and all benchmark kernels on every fast
+*                  engine in lockstep with the reference engine and prints
+*                  the result per program and engine, with the first
+*                  divergence if any. The system is reset afterwards. If no
+*                  engine diverged, 0 is returned, otherwise error code 1,
+*                  which is also returned if the hashes of all intervals
+*                  can't be stored or memory couldn't be allocated.
+*
+*                  - config: The test parameters.
+********************************************************************************/
+int engine_diff_run(const struct engine_diff_config* config);
+
+#endif /* ENGINE_DIFF_H_ */
@@ -0,0 +1,201 @@
+/********************************************************************************
+* event_queue.c: Contains static variables and function definitions for
+*                implementation of a discrete event queue. The events are
+*                stored in a binary min-heap ordered by clock cycle, so the
+*                next event is always found at the root.
+********************************************************************************/
+#include "event_queue.h"
+
+/********************************************************************************
+* event: Structure for a scheduled event. The sequence number keeps events
+*        scheduled at the same clock cycle in the order they were scheduled.
+********************************************************************************/
+struct event
+{
+   uint64_t cycle;              /* Clock cycle at which to service the event. */
+   uint32_t sequence;           /* Order in which the event was scheduled. */
+   uint32_t arg;                /* Argument passed to the handler. */
+   event_queue_handler handler; /* Function called when the event is serviced. */
+};
+
+/* Static variables: */
+static struct event heap[EVENT_QUEUE_CAPACITY]; /* Binary min-heap of scheduled events. */
+static size_t num_events;                       /* Number of scheduled events. */
+static uint32_t next_sequence;                  /* Sequence number of next scheduled event. */
+
+/* Static functions: */
+static inline bool precedes(const struct event* a,
+                            const struct event* b);
+static inline void swap(struct event* a,
+                        struct event* b);
+static void sift_up(size_t index);
+static void sift_down(size_t index);
+
+/********************************************************************************
+* event_queue_reset: Removes all scheduled events.
+********************************************************************************/
+void event_queue_reset(void)
+{
+   num_events = 0;
+   next_sequence = 0;
+   return;
+}
+
+/********************************************************************************
+* event_queue_schedule: Schedules an event at specified clock cycle. Events
+*                       scheduled at the same clock cycle are serviced in the
+*                       order they were scheduled. After successful
+*                       scheduling, 0 is returned. If the queue is full, no
+*                       event is scheduled and error code 1 is returned.
+*
+*                       - cycle  : The clock cycle at which to service the event.
+*                       - handler: Function to call when the event is serviced.
+*                       - arg    : Argument to pass to the handler.
+********************************************************************************/
+int event_queue_schedule(const uint64_t cycle,
+                         event_queue_handler handler,
+                         const uint32_t arg)
+{
+   if (num_events >= EVENT_QUEUE_CAPACITY)
+   {
+      return 1;
+   }
+   else
+   {
+      struct event* self = &heap[num_events];
+      self->cycle = cycle;
+      self->sequence = next_sequence++;
+      self->arg = arg;
+      self->handler = handler;
+      sift_up(num_events++);
+      return 0;
+   }
+}
+
+/********************************************************************************
+* event_queue_cancel: Removes all scheduled events with specified handler
+*                     and argument.
+*
+*                     - handler: The handler of the events to remove.
+*                     - arg    : The argument of the events to remove.
+********************************************************************************/
+void event_queue_cancel(event_queue_handler handler,
+                        const uint32_t arg)
+{
+   size_t kept = 0;
+
+   for (size_t i = 0; i < num_events; ++i)
+   {
+      if (heap[i].handler != handler || heap[i].arg != arg)
+      {
+         heap[kept++] = heap[i];
+      }
+   }
+
+   if (kept != num_events)
+   {
+      num_events = kept;
+      for (size_t i = num_events / 2; i-- > 0;)
+      {
+         sift_down(i);
+      }
+   }
+   return;
+}
+
+/********************************************************************************
+* event_queue_next_cycle: Returns the clock cycle of the next scheduled event,
+*                         or EVENT_QUEUE_NO_EVENT if the queue is empty.
+********************************************************************************/
+uint64_t event_queue_next_cycle(void)
+{
+   return num_events ? heap[0].cycle : EVENT_QUEUE_NO_EVENT;
+}
+
+/********************************************************************************
+* event_queue_service: Services all events scheduled at or before specified
+*                      clock cycle in chronological order, including events
+*                      scheduled by the handlers themselves.
+*
+*                      - cycle: The current clock cycle.
+********************************************************************************/
+void event_queue_service(const uint64_t cycle)
+{
+   while (num_events && heap[0].cycle <= cycle)
+   {
+      const struct event next = heap[0];
+      heap[0] = heap[--num_events];
+      sift_down(0);
+      next.handler(next.cycle, next.arg);
+   }
+   return;
+}
+
+/********************************************************************************
+* precedes: Indicates if event a shall be serviced before event b.
+*
+*           - a: Reference to the first event.
+*           - b: Reference to the second event.
+********************************************************************************/
+static inline bool precedes(const struct event* a,
+                            const struct event* b)
+{
+   if (a->cycle != b->cycle) return a->cycle < b->cycle;
+   return (int32_t)(a->sequence - b->sequence) < 0;
+}
+
+/********************************************************************************
+* swap: Swaps the content of two events.
+*
+*       - a: Reference to the first event.
+*       - b: Reference to the second event.
+********************************************************************************/
+static inline void swap(struct event* a,
+                        struct event* b)
+{
+   const struct event temp = *a;
+   *a = *b;
+   *b = temp;
+   return;
+}
+
+/********************************************************************************
+* sift_up: Moves the event at specified index towards the root until its
+*          parent precedes it.
+*
+*          - index: Index of the event in the heap.
+********************************************************************************/
+static void sift_up(size_t index)
+{
+   while (index > 0)
+   {
+      const size_t parent = (index - 1) / 2;
+      if (!precedes(&heap[index], &heap[parent])) break;
+      swap(&heap[index], &heap[parent]);
+      index = parent;
+   }
+   return;
+}
+
+/********************************************************************************
+* sift_down: Moves the event at specified index towards the leaves until it
+*            precedes both its children.
+*
+*            - index: Index of the event in the heap.
+********************************************************************************/
+static void sift_down(size_t index)
+{
+   while (1)
+   {
+      const size_t left = 2 * index + 1;
+      const size_t right = left + 1;
+      size_t first = index;
+
+      if (left < num_events && precedes(&heap[left], &heap[first])) first = left;
+      if (right < num_events && precedes(&heap[right], &heap[first])) first = right;
+      if (first == index) return;
+
+      swap(&heap[index], &heap[first]);
+      index = first;
+   }
+}
@@ -0,0 +1,74 @@
+/********************************************************************************
+* event_queue.h: Contains function declarations and macro definitions for
+*                implementation of a discrete event queue, in which
+*                peripherals and external stimuli schedule events at
+*                specified clock cycles. The control unit runs instructions
+*                uninterrupted until the clock cycle of the next event and
+*                then services it, so the cost of peripherals is proportional
+*                to the number of events rather than the number of cycles.
+********************************************************************************/
+#ifndef EVENT_QUEUE_H_
+#define EVENT_QUEUE_H_
+
+/* Include directives: */
+#include "cpu.h"
+
+/* Macro definitions: */
+#define EVENT_QUEUE_CAPACITY 64         /* Max number of simultaneously scheduled events. */
+#define EVENT_QUEUE_NO_EVENT UINT64_MAX /* Clock cycle returned when the queue is empty. */
+
+/********************************************************************************
+* event_queue_handler: Function called when a scheduled event is serviced.
+*
+*                      - cycle: The clock cycle the event was scheduled at.
+*                      - arg  : The argument passed when the event was scheduled.
+********************************************************************************/
+typedef void (*event_queue_handler)(const uint64_t cycle,
+                                    const uint32_t arg);
+
+/********************************************************************************
+* event_queue_reset: Removes all scheduled events.
+********************************************************************************/
+void event_queue_reset(void);
+
+/********************************************************************************
+* event_queue_schedule: Schedules an event at specified clock cycle. Events
+*                       scheduled at the same clock cycle are serviced in the
+*                       order they were scheduled. After successful
+*                       scheduling, 0 is returned. If the queue is full, no
+*                       event is scheduled and error code 1 is returned.
+*
+*                       - cycle  : The clock cycle at which to service the event.
+*                       - handler: Function to call when the event is serviced.
+*                       - arg    : Argument to pass to the handler.
+********************************************************************************/
+int event_queue_schedule(const uint64_t cycle,
+                         event_queue_handler handler,
+                         const uint32_t arg);
+
+/********************************************************************************
+* event_queue_cancel: Removes all scheduled events with specified handler
+*                     and argument.
+*
+*                     - handler: The handler of the events to remove.
+*                     - arg    : The argument of the events to remove.
+********************************************************************************/
+void event_queue_cancel(event_queue_handler handler,
+                        const uint32_t arg);
+
+/********************************************************************************
+* event_queue_next_cycle: Returns the clock cycle of the next scheduled event,
+*                         or EVENT_QUEUE_NO_EVENT if the queue is empty.
+********************************************************************************/
+uint64_t event_queue_next_cycle(void);
+
+/********************************************************************************
+* event_queue_service: Services all events scheduled at or before specified
+*                      clock cycle in chronological order, including events
+*                      scheduled by the handlers themselves.
+*
+*                      - cycle: The current clock cycle.
+********************************************************************************/
+void event_queue_service(const uint64_t cycle);
+
+#endif /* EVENT_QUEUE_H_ */
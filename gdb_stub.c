@@ -0,0 +1,743 @@
+/********************************************************************************
+* gdb_stub.c: Contains static variables and function definitions for the GDB
+*             remote serial protocol stub. Packets are read and written one
+*             byte at a time, which is sufficient for the short packets of
+*             an interactive debugging session.
+********************************************************************************/
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#endif
+
+#include "gdb_stub.h"
+#include <string.h>
+
+/* Macro definitions: */
+#define GDB_STUB_NUM_REGISTERS  35 /* R0 - R31, SR, SP and PC. */
+#define GDB_STUB_REGISTER_SR    32 /* Number of the status register. */
+#define GDB_STUB_REGISTER_SP    33 /* Number of the stack pointer. */
+#define GDB_STUB_REGISTER_PC    34 /* Number of the program counter. */
+#define GDB_STUB_SIGINT         0x02 /* Signal reported when stopped by GDB. */
+#define GDB_STUB_SIGTRAP        0x05 /* Signal reported for breakpoints, watchpoints and steps. */
+#define GDB_STUB_SIGABRT        0x06 /* Signal reported when the CPU was halted. */
+#define GDB_STUB_SIGSEGV        0x0B /* Signal reported for simulator exceptions. */
+
+/* Static variables: */
+static int input = -1;                         /* Descriptor the packets are read from. */
+static int output = -1;                        /* Descriptor the packets are written to. */
+static char packet[GDB_STUB_PACKET_SIZE];      /* The last received packet. */
+static char reply[GDB_STUB_PACKET_SIZE];       /* The reply to the last received packet. */
+static uint8_t pending[GDB_STUB_PACKET_SIZE];  /* Bytes read while polling for an interrupt. */
+static size_t pending_start = 0;               /* Index of the next pending byte. */
+static size_t pending_end = 0;                 /* Index after the last pending byte. */
+
+/* Static functions: */
+static int open_connection(const char* path);
+static void close_connection(const char* path);
+static int read_byte(void);
+static int read_input(void);
+static void write_bytes(const char* data,
+                        const size_t size);
+static bool interrupt_requested(void);
+static int receive_packet(void);
+static void send_packet(const char* data);
+static int handle_packet(void);
+static void run(const bool single_step);
+static void write_stop_reply(const bool interrupted);
+static size_t read_registers(char* buffer);
+static void write_register(const uint8_t number,
+                           const uint32_t value);
+static uint32_t register_value(const uint8_t number);
+static uint8_t register_size(const uint8_t number);
+static int read_memory(const uint32_t address,
+                       uint8_t* value);
+static int write_memory(const uint32_t address,
+                        const uint8_t value);
+static int set_point(const char* arguments,
+                     const bool insert);
+static uint32_t parse_hex(const char** text);
+static uint32_t parse_hex_bytes(const char** text,
+                                const uint8_t size);
+static inline int hex_value(const int digit);
+static inline void write_hex(char* buffer,
+                             const uint8_t value);
+
+/********************************************************************************
+* gdb_stub_run: Waits for GDB to connect and serves its requests until GDB
+*               detaches, kills the target or disconnects. After success, 0
+*               is returned. If the connection couldn't be set up, error code
+*               1 is returned.
+*
+*               - path: Path to the Unix domain socket, or "-" for stdio.
+********************************************************************************/
+int gdb_stub_run(const char* path)
+{
+   if (open_connection(path)) return 1;
+
+   while (receive_packet() >= 0)
+   {
+      if (handle_packet()) break;
+   }
+
+   close_connection(path);
+   return 0;
+}
+
+/********************************************************************************
+* open_connection: Opens the connection to GDB. For a socket, the function
+*                  waits until GDB has connected. For stdio, the packets are
+*                  written to a duplicate of stdout, while stdout itself is
+*                  redirected to stderr, so that UART output and reports
+*                  can't corrupt the protocol stream. SIGPIPE is ignored,
+*                  so that the simulator isn't killed if GDB goes away while
+*                  a reply is written. After success, 0 is returned,
+*                  otherwise error code 1.
+*
+*                  - path: Path to the Unix domain socket, or "-" for stdio.
+********************************************************************************/
+static int open_connection(const char* path)
+{
+#ifdef _WIN32
+   (void)path;
+   fflush(stdout);
+   input = _fileno(stdin);
+   output = _dup(_fileno(stdout));
+   if (output < 0 || _dup2(_fileno(stderr), _fileno(stdout))) return 1;
+   _setmode(input, _O_BINARY);
+   _setmode(output, _O_BINARY);
+   return 0;
+#else
+   struct sockaddr_un address;
+   int listener;
+   signal(SIGPIPE, SIG_IGN); /* A closed connection fails the write instead of killing the process. */
+
+   if (!strcmp(path, "-"))
+   {
+      fflush(stdout);
+      input = STDIN_FILENO;
+      output = dup(STDOUT_FILENO);
+      return output < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0;
+   }
+
+   if (strlen(path) >= sizeof(address.sun_path)) return 1;
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   strcpy(address.sun_path, path);
+
+   listener = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (listener < 0) return 1;
+   unlink(path);
+
+   if (bind(listener, (struct sockaddr*)&address, sizeof(address)) || listen(listener, 1))
+   {
+      close(listener);
+      return 1;
+   }
+
+   fprintf(stderr, "Waiting for GDB to connect to %s...\n", path);
+   input = accept(listener, 0, 0);
+   output = input;
+   close(listener);
+   return input < 0;
+#endif
+}
+
+/********************************************************************************
+* close_connection: Closes the connection to GDB and removes the socket. For
+*                   stdio, stdout stays redirected to stderr, so that the
+*                   reports printed at exit don't reach GDB either.
+*
+*                   - path: Path to the Unix domain socket, or "-" for stdio.
+********************************************************************************/
+static void close_connection(const char* path)
+{
+#ifdef _WIN32
+   (void)path;
+   _close(output);
+#else
+   if (strcmp(path, "-"))
+   {
+      close(input);
+      unlink(path);
+   }
+   else
+   {
+      close(output);
+   }
+#endif
+   input = -1;
+   output = -1;
+   pending_start = pending_end = 0;
+   return;
+}
+
+/********************************************************************************
+* read_byte: Returns the next byte received from GDB, or -1 if the connection
+*            was closed. Bytes read while polling for an interrupt are
+*            returned first.
+********************************************************************************/
+static int read_byte(void)
+{
+   if (pending_start < pending_end)
+   {
+      const uint8_t byte = pending[pending_start++];
+      if (pending_start == pending_end) pending_start = pending_end = 0;
+      return byte;
+   }
+   return read_input();
+}
+
+/********************************************************************************
+* read_input: Reads the next byte from the connection and returns it, or -1
+*             if the connection was closed.
+********************************************************************************/
+static int read_input(void)
+{
+   uint8_t byte;
+#ifdef _WIN32
+   return _read(input, &byte, 1) == 1 ? byte : -1;
+#else
+   return (read)(input, &byte, 1) == 1 ? byte : -1; /* Parenthesized, read is a macro in cpu.h. */
+#endif
+}
+
+/********************************************************************************
+* write_bytes: Sends specified bytes to GDB.
+*
+*              - data: Reference to the bytes.
+*              - size: The number of bytes.
+********************************************************************************/
+static void write_bytes(const char* data,
+                        const size_t size)
+{
+   size_t written = 0;
+
+   while (written < size)
+   {
+#ifdef _WIN32
+      const int result = _write(output, data + written, (unsigned int)(size - written));
+#else
+      const ssize_t result = write(output, data + written, size - written);
+#endif
+      if (result <= 0) return;
+      written += (size_t)result;
+   }
+   return;
+}
+
+/********************************************************************************
+* interrupt_requested: Indicates if GDB has sent an interrupt request (0x03)
+*                      while the CPU is running. The connection is polled
+*                      without waiting. Other bytes are kept for the packet
+*                      reader, unless there is no room left for them. Not
+*                      supported on Windows, where the CPU runs until it
+*                      stops by itself.
+********************************************************************************/
+static bool interrupt_requested(void)
+{
+#ifdef _WIN32
+   return false;
+#else
+   struct pollfd descriptor = { input, POLLIN, 0 };
+   int byte;
+
+   if (pending_end == sizeof(pending) || poll(&descriptor, 1, 0) <= 0) return false;
+   if ((byte = read_input()) == 0x03) return true;
+   if (byte >= 0) pending[pending_end++] = (uint8_t)byte;
+   return false;
+#endif
+}
+
+/********************************************************************************
+* receive_packet: Receives the next packet from GDB into the packet buffer,
+*                 acknowledging packets with correct checksum and requesting
+*                 retransmission of others. The length of the packet is
+*                 returned, or -1 if the connection was closed.
+********************************************************************************/
+static int receive_packet(void)
+{
+   while (1)
+   {
+      size_t length = 0;
+      uint8_t checksum = 0;
+      int byte;
+
+      do
+      {
+         byte = read_byte();
+         if (byte < 0) return -1;
+      } while (byte != '$');
+
+      while ((byte = read_byte()) != '#')
+      {
+         if (byte < 0) return -1;
+
+         if (byte == '$') /* Restarts at the start of a new packet. */
+         {
+            length = 0;
+            checksum = 0;
+            continue;
+         }
+
+         if (length < GDB_STUB_PACKET_SIZE - 1) packet[length++] = (char)byte;
+         checksum += (uint8_t)byte;
+      }
+
+      const int high_digit = read_byte();
+      const int low_digit = read_byte();
+      if (low_digit < 0) return -1;
+
+      if (((hex_value(high_digit) << 4) | hex_value(low_digit)) == checksum)
+      {
+         write_bytes("+", 1);
+         packet[length] = '\0';
+         return (int)length;
+      }
+      write_bytes("-", 1);
+   }
+}
+
+/********************************************************************************
+* send_packet: Sends specified data as a packet to GDB and retransmits it
+*              until it's acknowledged.
+*
+*              - data: The packet data.
+********************************************************************************/
+static void send_packet(const char* data)
+{
+   const size_t length = strlen(data);
+   uint8_t checksum = 0;
+   char trailer[3] = { '#', 0, 0 };
+   int acknowledgement;
+
+   for (size_t i = 0; i < length; ++i)
+   {
+      checksum += (uint8_t)data[i];
+   }
+
+   write_hex(trailer + 1, checksum);
+
+   do
+   {
+      write_bytes("$", 1);
+      write_bytes(data, length);
+      write_bytes(trailer, sizeof(trailer));
+      acknowledgement = read_byte();
+   } while (acknowledgement == '-');
+   return;
+}
+
+/********************************************************************************
+* handle_packet: Executes the received packet and sends the reply. If GDB
+*                detached or killed the target, 1 is returned, otherwise 0.
+********************************************************************************/
+static int handle_packet(void)
+{
+   const char* arguments = packet + 1;
+   reply[0] = '\0';
+
+   switch (packet[0])
+   {
+   case '?':
+      write_stop_reply(false);
+      break;
+   case 'g':
+      reply[read_registers(reply)] = '\0';
+      break;
+   case 'G':
+   {
+      for (uint8_t i = 0; i < GDB_STUB_NUM_REGISTERS && *arguments; ++i)
+      {
+         write_register(i, parse_hex_bytes(&arguments, register_size(i)));
+      }
+      strcpy(reply, "OK");
+      break;
+   }
+   case 'p':
+   {
+      const uint32_t number = parse_hex(&arguments);
+
+      if (number < GDB_STUB_NUM_REGISTERS)
+      {
+         const uint32_t value = register_value((uint8_t)number);
+         for (uint8_t i = 0; i < register_size((uint8_t)number); ++i)
+         {
+            write_hex(reply + 2 * i, (uint8_t)(value >> (8 * i)));
+         }
+         reply[2 * register_size((uint8_t)number)] = '\0';
+      }
+      else
+      {
+         strcpy(reply, "E01");
+      }
+      break;
+   }
+   case 'P':
+   {
+      const uint32_t number = parse_hex(&arguments);
+
+      if (number < GDB_STUB_NUM_REGISTERS && *arguments++ == '=')
+      {
+         write_register((uint8_t)number, parse_hex_bytes(&arguments, register_size((uint8_t)number)));
+         strcpy(reply, "OK");
+      }
+      else
+      {
+         strcpy(reply, "E01");
+      }
+      break;
+   }
+   case 'm':
+   {
+      const uint32_t address = parse_hex(&arguments);
+      uint32_t length = *arguments++ == ',' ? parse_hex(&arguments) : 0;
+      uint8_t value;
+      size_t size = 0;
+
+      if (length > (GDB_STUB_PACKET_SIZE - 1) / 2) length = (GDB_STUB_PACKET_SIZE - 1) / 2;
+
+      for (uint32_t i = 0; i < length && !read_memory(address + i, &value); ++i)
+      {
+         write_hex(reply + size, value);
+         size += 2;
+      }
+
+      reply[size] = '\0';
+      if (!size && length) strcpy(reply, "E01");
+      break;
+   }
+   case 'M':
+   {
+      const uint32_t address = parse_hex(&arguments);
+      const uint32_t length = *arguments++ == ',' ? parse_hex(&arguments) : 0;
+      int result = *arguments++ != ':';
+
+      for (uint32_t i = 0; i < length && !result; ++i)
+      {
+         result = write_memory(address + i, (uint8_t)parse_hex_bytes(&arguments, 1));
+      }
+
+      strcpy(reply, result ? "E01" : "OK");
+      break;
+   }
+   case 'c': case 's':
+   {
+      if (*arguments) control_unit_set_program_counter((uint16_t)(parse_hex(&arguments) / 4));
+      run(packet[0] == 's');
+      break;
+   }
+   case 'Z': case 'z':
+      strcpy(reply, set_point(arguments, packet[0] == 'Z') ? "E01" : "OK");
+      break;
+   case 'H': case 'T':
+      strcpy(reply, "OK");
+      break;
+   case 'k':
+      return 1;
+   case 'D':
+      send_packet("OK");
+      return 1;
+   case 'q':
+   {
+      if (!strncmp(packet, "qSupported", 10))
+      {
+         sprintf(reply, "PacketSize=%x", GDB_STUB_PACKET_SIZE - 1);
+      }
+      else if (!strcmp(packet, "qAttached"))
+      {
+         strcpy(reply, "1");
+      }
+      break;
+   }
+   default: /* Unsupported packets are answered by an empty reply. */
+      break;
+   }
+
+   send_packet(reply);
+   return 0;
+}
+
+/********************************************************************************
+* run: Runs the CPU until it stops, a single instruction has been executed or
+*      GDB requests an interrupt, and writes the stop reply. A stop at a
+*      breakpoint or watchpoint is resumed by control_unit_run.
+*
+*      - single_step: Indicates if only one instruction is executed.
+********************************************************************************/
+static void run(const bool single_step)
+{
+   bool interrupted = false;
+
+   if (single_step)
+   {
+      control_unit_run(1);
+   }
+   else
+   {
+      do
+      {
+         control_unit_run(GDB_STUB_RUN_CYCLES);
+      } while (!control_unit_stop_reason() && !(interrupted = interrupt_requested()));
+   }
+
+   write_stop_reply(interrupted);
+   return;
+}
+
+/********************************************************************************
+* write_stop_reply: Writes the stop reply for the current stop reason to the
+*                   reply buffer. A running CPU is reported as stopped by a
+*                   step, or by GDB if an interrupt was requested.
+*
+*                   - interrupted: Indicates if GDB requested the stop.
+********************************************************************************/
+static void write_stop_reply(const bool interrupted)
+{
+   const enum cpu_stop_reason reason = control_unit_stop_reason();
+
+   if (reason == CPU_STOP_WATCHPOINT)
+   {
+      const struct control_unit_watch_hit* hit = control_unit_watch_hit();
+      const uint8_t watch = data_memory_watch(hit->address);
+      const char* kind = watch == (DATA_MEMORY_WATCH_READ | DATA_MEMORY_WATCH_WRITE) ? "awatch" :
+         hit->access == DATA_MEMORY_WATCH_WRITE ? "watch" : "rwatch";
+      sprintf(reply, "T%02X%s:%x;", GDB_STUB_SIGTRAP, kind, GDB_STUB_DATA_OFFSET + hit->address);
+   }
+   else if (reason == CPU_STOP_HALT)
+   {
+      sprintf(reply, "S%02X", GDB_STUB_SIGABRT);
+   }
+   else if (reason == CPU_STOP_EXCEPTION)
+   {
+      sprintf(reply, "S%02X", GDB_STUB_SIGSEGV);
+   }
+   else
+   {
+      sprintf(reply, "S%02X", interrupted ? GDB_STUB_SIGINT : GDB_STUB_SIGTRAP);
+   }
+   return;
+}
+
+/********************************************************************************
+* read_registers: Writes all registers as hexadecimal digits to specified
+*                 buffer and returns the number of digits written.
+*
+*                 - buffer: Reference to the buffer.
+********************************************************************************/
+static size_t read_registers(char* buffer)
+{
+   size_t size = 0;
+
+   for (uint8_t i = 0; i < GDB_STUB_NUM_REGISTERS; ++i)
+   {
+      const uint32_t value = register_value(i);
+
+      for (uint8_t j = 0; j < register_size(i); ++j)
+      {
+         write_hex(buffer + size, (uint8_t)(value >> (8 * j)));
+         size += 2;
+      }
+   }
+   return size;
+}
+
+/********************************************************************************
+* write_register: Writes specified value to specified register.
+*
+*                 - number: The register number, see gdb_stub.h.
+*                 - value : The new value.
+********************************************************************************/
+static void write_register(const uint8_t number,
+                           const uint32_t value)
+{
+   if (number < CPU_REGISTER_ADDRESS_WIDTH)       control_unit_set_register(number, (uint8_t)value);
+   else if (number == GDB_STUB_REGISTER_SR)       control_unit_set_status_register((uint8_t)value);
+   else if (number == GDB_STUB_REGISTER_SP)       stack_set_pointer((uint16_t)value);
+   else if (number == GDB_STUB_REGISTER_PC)       control_unit_set_program_counter((uint16_t)(value / 4));
+   return;
+}
+
+/********************************************************************************
+* register_value: Returns the value of specified register.
+*
+*                 - number: The register number, see gdb_stub.h.
+********************************************************************************/
+static uint32_t register_value(const uint8_t number)
+{
+   if (number < CPU_REGISTER_ADDRESS_WIDTH)  return control_unit_register(number);
+   else if (number == GDB_STUB_REGISTER_SR)  return control_unit_status_register();
+   else if (number == GDB_STUB_REGISTER_SP)  return stack_pointer();
+   else                                      return (uint32_t)control_unit_program_counter() * 4;
+}
+
+/********************************************************************************
+* register_size: Returns the size of specified register in bytes.
+*
+*                - number: The register number, see gdb_stub.h.
+********************************************************************************/
+static uint8_t register_size(const uint8_t number)
+{
+   if (number == GDB_STUB_REGISTER_SP)      return 2;
+   else if (number == GDB_STUB_REGISTER_PC) return 4;
+   else                                     return 1;
+}
+
+/********************************************************************************
+* read_memory: Reads the byte at specified address in the GDB address space
+*              without calling I/O hooks or watchpoints. After success, 0 is
+*              returned. If the address is not mapped, error code 1 is
+*              returned.
+*
+*              - address: The address in the GDB address space.
+*              - value  : Reference to storage for the byte.
+********************************************************************************/
+static int read_memory(const uint32_t address,
+                       uint8_t* value)
+{
+   if (address >= GDB_STUB_DATA_OFFSET)
+   {
+      if (address - GDB_STUB_DATA_OFFSET >= DATA_MEMORY_ADDRESS_WIDTH) return 1;
+      *value = data_memory_content[address - GDB_STUB_DATA_OFFSET];
+      return 0;
+   }
+   else if (address / 4 < PROGRAM_MEMORY_ADDRESS_WIDTH)
+   {
+      *value = (uint8_t)(breakpoint_original_instruction((uint16_t)(address / 4)) >> (8 * (address % 4)));
+      return 0;
+   }
+   return 1;
+}
+
+/********************************************************************************
+* write_memory: Writes the byte at specified address in data memory without
+*               calling I/O hooks or watchpoints. After success, 0 is
+*               returned. If the address is not in data memory, error code 1
+*               is returned.
+*
+*               - address: The address in the GDB address space.
+*               - value  : The byte to write.
+********************************************************************************/
+static int write_memory(const uint32_t address,
+                        const uint8_t value)
+{
+   if (address < GDB_STUB_DATA_OFFSET || address - GDB_STUB_DATA_OFFSET >= DATA_MEMORY_ADDRESS_WIDTH)
+   {
+      return 1;
+   }
+
+   data_memory_content[address - GDB_STUB_DATA_OFFSET] = value;
+   return 0;
+}
+
+/********************************************************************************
+* set_point: Inserts or removes a breakpoint (types 0 and 1) or watchpoint
+*            (types 2 - 4 for write, read and access) from the arguments of
+*            a Z or z packet ("type,address,kind"). After success, 0 is
+*            returned, otherwise error code 1.
+*
+*            - arguments: The packet arguments.
+*            - insert   : Indicates if the point is inserted.
+********************************************************************************/
+static int set_point(const char* arguments,
+                     const bool insert)
+{
+   const uint32_t type = parse_hex(&arguments);
+   const uint32_t address = *arguments++ == ',' ? parse_hex(&arguments) : 0;
+   const uint32_t kind = *arguments++ == ',' ? parse_hex(&arguments) : 0;
+
+   if (type <= 1)
+   {
+      if (address % 4 || address / 4 >= PROGRAM_MEMORY_ADDRESS_WIDTH) return 1;
+      if (insert) return breakpoint_set((uint16_t)(address / 4), 0, false);
+      breakpoint_remove((uint16_t)(address / 4));
+      return 0;
+   }
+   else if (type <= 4 && address >= GDB_STUB_DATA_OFFSET && kind &&
+            address - GDB_STUB_DATA_OFFSET + kind <= DATA_MEMORY_ADDRESS_WIDTH)
+   {
+      const uint8_t access = type == 2 ? DATA_MEMORY_WATCH_WRITE : type == 3 ? DATA_MEMORY_WATCH_READ :
+         DATA_MEMORY_WATCH_READ | DATA_MEMORY_WATCH_WRITE;
+
+      for (uint16_t i = (uint16_t)(address - GDB_STUB_DATA_OFFSET); i < address - GDB_STUB_DATA_OFFSET + kind; ++i)
+      {
+         const uint8_t watch = data_memory_watch(i);
+         data_memory_set_watch(i, i, insert ? watch | access : watch & ~access);
+      }
+      return 0;
+   }
+   return 1;
+}
+
+/********************************************************************************
+* parse_hex: Parses a hexadecimal number, most significant digit first, and
+*            advances the text past it.
+*
+*            - text: Reference to the text position.
+********************************************************************************/
+static uint32_t parse_hex(const char** text)
+{
+   uint32_t value = 0;
+
+   while (hex_value(**text) >= 0)
+   {
+      value = (value << 4) | (uint32_t)hex_value(**text);
+      (*text)++;
+   }
+   return value;
+}
+
+/********************************************************************************
+* parse_hex_bytes: Parses specified number of bytes as hexadecimal digits in
+*                  little endian order, as used for registers, and advances
+*                  the text past them.
+*
+*                  - text: Reference to the text position.
+*                  - size: The number of bytes.
+********************************************************************************/
+static uint32_t parse_hex_bytes(const char** text,
+                                const uint8_t size)
+{
+   uint32_t value = 0;
+
+   for (uint8_t i = 0; i < size && hex_value((*text)[0]) >= 0 && hex_value((*text)[1]) >= 0; ++i)
+   {
+      value |= (uint32_t)((hex_value((*text)[0]) << 4) | hex_value((*text)[1])) << (8 * i);
+      *text += 2;
+   }
+   return value;
+}
+
+/********************************************************************************
+* hex_value: Returns the value of specified hexadecimal digit, or -1 if the
+*            character isn't a hexadecimal digit.
+*
+*            - digit: The character.
+********************************************************************************/
+static inline int hex_value(const int digit)
+{
+   if (digit >= '0' && digit <= '9')      return digit - '0';
+   else if (digit >= 'a' && digit <= 'f') return digit - 'a' + 10;
+   else if (digit >= 'A' && digit <= 'F') return digit - 'A' + 10;
+   else return -1;
+}
+
+/********************************************************************************
+* write_hex: Writes specified byte as two hexadecimal digits.
+*
+*            - buffer: Reference to storage for the digits.
+*            - value : The byte.
+********************************************************************************/
+static inline void write_hex(char* buffer,
+                             const uint8_t value)
+{
+   static const char digits[] = "0123456789abcdef";
+   buffer[0] = digits[value >> 4];
+   buffer[1] = digits[value & 0x0F];
+   return;
+}
@@ -0,0 +1,49 @@
+/********************************************************************************
+* gdb_stub.h: Contains definitions and function declarations for a stub
+*             speaking the GDB remote serial protocol, so that firmware can
+*             be debugged with GDB instead of the menu of the controller.
+*             The CPU runs at full speed between stops via control_unit_run.
+*
+*             The stub listens on a local Unix domain socket, connected from
+*             GDB by "target remote unix::<path>", or communicates via stdin
+*             and stdout if the path is "-", connected by
+*             "target remote | <simulator> --gdb -". Unix domain sockets are
+*             not used on Windows, where the stub always uses stdio.
+*
+*             The registers are numbered R0 - R31 (0 - 31, 8 bits), SR (32,
+*             8 bits), SP (33, 16 bits) and PC (34, 32 bits). Program memory
+*             is mapped at 0 with 4 bytes per instruction (little endian),
+*             hence the PC holds 4 times the address of the next
+*             instruction, much like GDB for AVR uses byte addresses for its
+*             16-bit instructions. Data memory is mapped at
+*             GDB_STUB_DATA_OFFSET as on AVR. Breakpoints show the original
+*             instructions in program memory, which is read-only.
+*
+*             Supported packets: ?, g, G, p, P, m, M, c, s, k, D, Z0 - Z4,
+*             z0 - z4, qSupported and qAttached. A received 0x03 byte stops
+*             a running CPU.
+********************************************************************************/
+#ifndef GDB_STUB_H_
+#define GDB_STUB_H_
+
+/* Include directives: */
+#include "control_unit.h"
+
+/* Macro definitions: */
+#define GDB_STUB_PACKET_SIZE 4096     /* Max size of a packet in bytes. */
+#define GDB_STUB_DATA_OFFSET 0x800000 /* Address of data memory in the GDB address space. */
+#define GDB_STUB_RUN_CYCLES  100000   /* Clock cycles run between checks for an interrupt request. */
+
+/********************************************************************************
+* gdb_stub_run: Waits for GDB to connect and serves its requests until GDB
+*               detaches, kills the target or disconnects. After success, 0
+*               is returned. If the connection couldn't be set up, error code
+*               1 is returned. In stdio mode, stdout carries the protocol
+*               only, everything else printed to stdout, e.g. UART output
+*               and reports, goes to stderr instead.
+*
+*               - path: Path to the Unix domain socket, or "-" for stdio.
+********************************************************************************/
+int gdb_stub_run(const char* path);
+
+#endif /* GDB_STUB_H_ */
@@ -0,0 +1,202 @@
+/********************************************************************************
+* host.c: Contains function definitions for access to services of the host
+*         system running the simulator, such as time measurement and threads.
+********************************************************************************/
+#ifndef _WIN32
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* Declares clock_gettime, nanosleep, fseeko and ftello with -std=c11. */
+#endif
+#define _FILE_OFFSET_BITS 64    /* 64-bit off_t on 32-bit hosts, so that traces can exceed 2 GB. */
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#undef IN  /* Defined as empty by windows.h, clashes with the OP codes. */
+#undef OUT
+#define dup _dup
+#define dup2 _dup2
+#define close _close
+#define fdopen _fdopen
+#define fileno _fileno
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "host.h"
+
+/* Static functions: */
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID arg);
+#else
+static void* thread_entry(void* arg);
+#endif
+
+/********************************************************************************
+* host_time_ns: Returns the current value of a monotonic host clock measured
+*               in nanoseconds. The value is only meaningful as a difference
+*               between two calls.
+********************************************************************************/
+uint64_t host_time_ns(void)
+{
+#ifdef _WIN32
+   static LARGE_INTEGER frequency = { 0 };
+   LARGE_INTEGER counter;
+   if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+   return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+      (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+#else
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+/********************************************************************************
+* host_thread_start: Starts a new thread running specified function. After
+*                    successful start, 0 is returned. If the thread couldn't
+*                    be created, error code 1 is returned.
+*
+*                    - self    : Reference to the thread.
+*                    - function: Function to run in the thread.
+*                    - arg     : Argument to pass to the function.
+********************************************************************************/
+int host_thread_start(struct host_thread* self,
+                      host_thread_function function,
+                      void* arg)
+{
+   self->function = function;
+   self->arg = arg;
+#ifdef _WIN32
+   self->handle = CreateThread(0, 0, thread_entry, self, 0, 0);
+   self->running = self->handle != 0;
+#else
+   self->running = pthread_create(&self->handle, 0, thread_entry, self) == 0;
+#endif
+   return self->running ? 0 : 1;
+}
+
+/********************************************************************************
+* host_thread_join: Waits until specified thread has finished. Nothing is done
+*                   if the thread isn't running.
+*
+*                   - self: Reference to the thread.
+********************************************************************************/
+void host_thread_join(struct host_thread* self)
+{
+   if (!self->running) return;
+#ifdef _WIN32
+   WaitForSingleObject(self->handle, INFINITE);
+   CloseHandle(self->handle);
+#else
+   pthread_join(self->handle, 0);
+#endif
+   self->running = false;
+   return;
+}
+
+/********************************************************************************
+* host_sleep_ms: Suspends the calling thread for specified number of
+*                milliseconds.
+*
+*                - ms: The number of milliseconds to sleep.
+********************************************************************************/
+void host_sleep_ms(const uint32_t ms)
+{
+#ifdef _WIN32
+   Sleep(ms);
+#else
+   struct timespec duration;
+   duration.tv_sec = ms / 1000;
+   duration.tv_nsec = (long)(ms % 1000) * 1000000L;
+   nanosleep(&duration, 0);
+#endif
+   return;
+}
+
+/********************************************************************************
+* host_file_seek: Moves the position of specified file to specified offset
+*                 from the start, or from the end if from_end is true. After
+*                 success, 0 is returned, otherwise error code 1.
+*
+*                 - file    : Reference to the file.
+*                 - offset  : The new position in bytes.
+*                 - from_end: Indicates if the offset is counted from the end.
+********************************************************************************/
+int host_file_seek(FILE* file,
+                   const int64_t offset,
+                   const bool from_end)
+{
+#ifdef _WIN32
+   return _fseeki64(file, offset, from_end ? SEEK_END : SEEK_SET) != 0;
+#else
+   return fseeko(file, (off_t)offset, from_end ? SEEK_END : SEEK_SET) != 0;
+#endif
+}
+
+/********************************************************************************
+* host_file_tell: Returns the position of specified file in bytes.
+*
+*                 - file: Reference to the file.
+********************************************************************************/
+uint64_t host_file_tell(FILE* file)
+{
+#ifdef _WIN32
+   return (uint64_t)_ftelli64(file);
+#else
+   return (uint64_t)ftello(file);
+#endif
+}
+
+/********************************************************************************
+* host_take_stdout: Returns a new stream writing to the original stdout and
+*                   redirects stdout itself to stderr, so that the caller is
+*                   the only one writing to the original stdout. The stream
+*                   is closed by the caller. If stdout couldn't be
+*                   redirected, a null pointer is returned.
+********************************************************************************/
+FILE* host_take_stdout(void)
+{
+   static int original = -1; /* Duplicate of the original stdout, kept for later calls. */
+   FILE* stream;
+   int descriptor;
+
+   if (original < 0)
+   {
+      fflush(stdout);
+      original = dup(fileno(stdout));
+      if (original < 0) return 0;
+
+      if (dup2(fileno(stderr), fileno(stdout)) < 0)
+      {
+         close(original);
+         original = -1;
+         return 0;
+      }
+   }
+
+   descriptor = dup(original);
+   if (descriptor < 0) return 0;
+   stream = fdopen(descriptor, "w");
+   if (!stream) close(descriptor);
+   return stream;
+}
+
+/********************************************************************************
+* thread_entry: Entry point of started threads, which runs the function
+*               stored in the thread structure.
+*
+*               - arg: Reference to the thread structure.
+********************************************************************************/
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID arg)
+#else
+static void* thread_entry(void* arg)
+#endif
+{
+   struct host_thread* self = (struct host_thread*)arg;
+   self->function(self->arg);
+   return 0;
+}
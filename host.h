@@ -0,0 +1,144 @@
+/********************************************************************************
+* host.h: Contains function declarations for access to services of the host
+*         system running the simulator, such as time measurement, threads,
+*         atomic access of variables shared between threads and positioning
+*         in files larger than 2 GB.
+********************************************************************************/
+#ifndef HOST_H_
+#define HOST_H_
+
+/* Include directives: */
+#include "cpu.h"
+
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <pthread.h>
+#endif
+
+/********************************************************************************
+* host_thread_function: Function run by a host thread.
+*
+*                       - arg: Argument passed when the thread was started.
+********************************************************************************/
+typedef void (*host_thread_function)(void* arg);
+
+/********************************************************************************
+* host_thread: Structure for a host thread.
+********************************************************************************/
+struct host_thread
+{
+#ifdef _WIN32
+   void* handle;                  /* Handle of the thread. */
+#else
+   pthread_t handle;              /* Handle of the thread. */
+#endif
+   host_thread_function function; /* Function run by the thread. */
+   void* arg;                     /* Argument passed to the function. */
+   bool running;                  /* Indicates if the thread is started and not yet joined. */
+};
+
+/********************************************************************************
+* host_time_ns: Returns the current value of a monotonic host clock measured
+*               in nanoseconds. The value is only meaningful as a difference
+*               between two calls.
+********************************************************************************/
+uint64_t host_time_ns(void);
+
+/********************************************************************************
+* host_thread_start: Starts a new thread running specified function. After
+*                    successful start, 0 is returned. If the thread couldn't
+*                    be created, error code 1 is returned.
+*
+*                    - self    : Reference to the thread.
+*                    - function: Function to run in the thread.
+*                    - arg     : Argument to pass to the function.
+********************************************************************************/
+int host_thread_start(struct host_thread* self,
+                      host_thread_function function,
+                      void* arg);
+
+/********************************************************************************
+* host_thread_join: Waits until specified thread has finished. Nothing is done
+*                   if the thread isn't running.
+*
+*                   - self: Reference to the thread.
+********************************************************************************/
+void host_thread_join(struct host_thread* self);
+
+/********************************************************************************
+* host_sleep_ms: Suspends the calling thread for specified number of
+*                milliseconds.
+*
+*                - ms: The number of milliseconds to sleep.
+********************************************************************************/
+void host_sleep_ms(const uint32_t ms);
+
+/********************************************************************************
+* host_file_seek: Moves the position of specified file to specified offset
+*                 from the start, or from the end if from_end is true. After
+*                 success, 0 is returned, otherwise error code 1.
+*
+*                 - file    : Reference to the file.
+*                 - offset  : The new position in bytes.
+*                 - from_end: Indicates if the offset is counted from the end.
+********************************************************************************/
+int host_file_seek(FILE* file,
+                   const int64_t offset,
+                   const bool from_end);
+
+/********************************************************************************
+* host_file_tell: Returns the position of specified file in bytes.
+*
+*                 - file: Reference to the file.
+********************************************************************************/
+uint64_t host_file_tell(FILE* file);
+
+/********************************************************************************
+* host_take_stdout: Returns a new stream writing to the original stdout and
+*                   redirects stdout itself to stderr, so that the caller is
+*                   the only one writing to the original stdout. The stream
+*                   is closed by the caller. If stdout couldn't be
+*                   redirected, a null pointer is returned.
+********************************************************************************/
+FILE* host_take_stdout(void);
+
+/********************************************************************************
+* host_atomic_load: Returns the value of a variable shared between threads.
+*                   Reads and writes after the load in program order are not
+*                   moved before it (acquire semantics).
+*
+*                   - value: Reference to the shared variable.
+********************************************************************************/
+static inline size_t host_atomic_load(const volatile size_t* value)
+{
+#if defined(_WIN64)
+   return (size_t)_InterlockedCompareExchange64((volatile __int64*)value, 0, 0);
+#elif defined(_WIN32)
+   return (size_t)_InterlockedCompareExchange((volatile long*)value, 0, 0);
+#else
+   return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+/********************************************************************************
+* host_atomic_store: Assigns a variable shared between threads. Reads and
+*                    writes before the store in program order are completed
+*                    before it (release semantics).
+*
+*                    - value    : Reference to the shared variable.
+*                    - new_value: The value to assign.
+********************************************************************************/
+static inline void host_atomic_store(volatile size_t* value,
+                                     const size_t new_value)
+{
+#if defined(_WIN64)
+   _InterlockedExchange64((volatile __int64*)value, (__int64)new_value);
+#elif defined(_WIN32)
+   _InterlockedExchange((volatile long*)value, (long)new_value);
+#else
+   __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#endif
+}
+
+#endif /* HOST_H_ */
@@ -1,13 +1,506 @@
-/********************************************************************************
-* main.c: Demonstration of an 8-bit CPU in progress, based on AVR architecture.
-********************************************************************************/
-#include "cpu_controller.h"
-
-/********************************************************************************
-* main: Controls the program flow of an 8-bit processor by keyboard input.
-********************************************************************************/
-int main(void)
-{
-   cpu_controller_run_by_input();
-   return 0;
-}
\ No newline at end of file
+/********************************************************************************
+* main.c: Demonstration of an 8-bit CPU in progress, based on AVR architecture.
+********************************************************************************/
+#include "cpu_controller.h"
+#include "trace_reader.h"
+#include "gdb_stub.h"
+#include "state_export.h"
+#include "benchmark.h"
+#include "engine_diff.h"
+#include <string.h>
+
+/* Static functions: */
+static void print_usage(const char* program);
+static int run_benchmark(const struct benchmark_config* config,
+                         const char* baseline_path,
+                         const double tolerance,
+                         const bool update_baseline);
+static int read_trace(const char* path,
+                      const struct trace_filter* filter,
+                      const uint64_t state_cycle);
+
+/********************************************************************************
+* main: Controls the program flow of an 8-bit processor by keyboard input.
+*       The following command line options are available:
+*
+*       --uart-in <file> : Feeds the UART receiver from file ("-" for stdin).
+*       --uart-out <file>: Writes UART output to file ("-" for stdout).
+*       --vcd <file>     : Records PORTB-PORTD to a VCD file (gzipped if
+*                          the file name ends with ".gz").
+*       --stack-trap <policy>: Action on stack overflow/underflow, either
+*                              ignore (default), halt, exception or reset.
+*       --profile        : Profiles calls, clock cycles and stack usage per
+*                          subroutine and prints a report at exit.
+*       --profile-folded <file>: Profiles as above and also writes the cycles
+*                                per call path as folded stacks to file.
+*       --trace <file>   : Writes a binary trace of all executed instructions
+*                          to file, see trace.h.
+*       --gdb <path>     : Runs the CPU under control of GDB instead of the
+*                          menu, connected via a Unix domain socket at the
+*                          path or via stdio if the path is "-". In stdio
+*                          mode, all other output to stdout goes to stderr.
+*       --script <file>  : Runs the commands of a script instead of the menu
+*                          ("-" for stdin), see cpu_controller.h. The exit
+*                          code is 1 if any command or expectation failed.
+*       --export <file>  : Exports the processor state and run statistics at
+*                          exit and on the export command of scripts ("-"
+*                          for stdout, then all other output to stdout goes
+*                          to stderr), see state_export.h.
+*       --export-format <format>: Export format, either json (default) or csv.
+*       --export-range <first>:<last>: Adds a data memory range to the export.
+*       --engine <engine>: Execution engine of continuous runs, either run
+*                          (default) or step, see control_unit.h.
+*       --perf           : Counts host hardware events during continuous
+*                          runs and prints them per simulated instruction
+*                          and engine at exit, see perf_counters.h. Not
+*                          used with --bench, which counts host events per
+*                          kernel itself.
+*
+*       Instead of running the simulator, the benchmarks are run with:
+*
+*       --bench              : Runs the benchmark kernels on all execution
+*                              engines and prints a summary, see benchmark.h.
+*       --bench-cycles <n>   : Clock cycles per measured repetition.
+*       --bench-repeat <n>   : Number of measured repetitions.
+*       --bench-warmup <n>   : Clock cycles run before measuring.
+*       --bench-baseline <file>: Checks the results against a baseline file,
+*                                which is written if it doesn't exist. The
+*                                exit code is 1 on a regression.
+*       --bench-tolerance <percent>: Allowed slowdown against the baseline
+*                                    before a regression (default 10).
+*       --bench-update       : Overwrites the baseline with the results.
+*
+*       Instead of running the simulator, the engines are tested against the
+*       reference engine with:
+*
+*       --diff-engines       : Runs the program and the benchmark kernels on
+*                              all engines in lockstep and reports the first
+*                              divergence, see engine_diff.h. The exit code
+*                              is 1 if any engine diverged.
+*       --diff-cycles <n>    : Clock cycles run per program.
+*       --diff-interval <n>  : Clock cycles between state comparisons, max
+*                              ENGINE_DIFF_MAX_INTERVAL.
+*
+*       Instead of running the simulator, a trace is read with the options:
+*
+*       --trace-read <file>  : Prints the records of specified trace file.
+*       --from <cycle>       : Starts printing at specified clock cycle.
+*       --to <cycle>         : Stops printing after specified clock cycle.
+*       --pc <first>:<last>  : Only prints instructions in the address range.
+*       --address <address>  : Only prints writes of the data memory address.
+*       --state <cycle>      : Prints the reconstructed machine state at
+*                              specified clock cycle instead of records.
+********************************************************************************/
+int main(int argc, char** argv)
+{
+   const char* folded_path = 0;
+   const char* trace_path = 0;
+   const char* gdb_path = 0;
+   const char* script_path = 0;
+   const char* export_path = 0;
+   enum state_export_format export_format = STATE_EXPORT_JSON;
+   bool perf = false;
+   bool benchmark = false;
+   struct benchmark_config benchmark_config = { 1000000, 5000000, 5 };
+   const char* baseline_path = 0;
+   double baseline_tolerance = 10.0;
+   bool update_baseline = false;
+   bool diff_engines = false;
+   struct engine_diff_config diff_config = { 1000000, 10000 };
+   int result = 0;
+   uint64_t state_cycle = TRACE_READER_NONE;
+   struct trace_filter filter = { TRACE_READER_NONE, TRACE_READER_NONE, TRACE_READER_NONE,
+                                  TRACE_READER_NONE, TRACE_READER_NONE };
+
+   for (int i = 1; i < argc; ++i)
+   {
+      if (!strcmp(argv[i], "--uart-in") && i + 1 < argc)
+      {
+         if (uart_open_input(argv[++i]))
+         {
+            fprintf(stderr, "Could not open UART input file %s!\n", argv[i]);
+            return 1;
+         }
+      }
+      else if (!strcmp(argv[i], "--uart-out") && i + 1 < argc)
+      {
+         if (uart_open_output(argv[++i]))
+         {
+            fprintf(stderr, "Could not open UART output file %s!\n", argv[i]);
+            return 1;
+         }
+      }
+      else if (!strcmp(argv[i], "--vcd") && i + 1 < argc)
+      {
+         if (vcd_open(argv[++i]))
+         {
+            fprintf(stderr, "Could not open VCD file %s!\n", argv[i]);
+            return 1;
+         }
+      }
+      else if (!strcmp(argv[i], "--stack-trap") && i + 1 < argc)
+      {
+         const char* policy = argv[++i];
+         if (!strcmp(policy, "ignore"))         control_unit_set_stack_trap_policy(STACK_TRAP_IGNORE);
+         else if (!strcmp(policy, "halt"))      control_unit_set_stack_trap_policy(STACK_TRAP_HALT);
+         else if (!strcmp(policy, "exception")) control_unit_set_stack_trap_policy(STACK_TRAP_EXCEPTION);
+         else if (!strcmp(policy, "reset"))     control_unit_set_stack_trap_policy(STACK_TRAP_RESET);
+         else
+         {
+            print_usage(argv[0]);
+            return 1;
+         }
+      }
+      else if (!strcmp(argv[i], "--profile") ||
+               (!strcmp(argv[i], "--profile-folded") && i + 1 < argc))
+      {
+         if (!strcmp(argv[i], "--profile-folded")) folded_path = argv[++i];
+         if (profiler_start())
+         {
+            fprintf(stderr, "Could not start the profiler!\n");
+            return 1;
+         }
+      }
+      else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+      {
+         if (control_unit_open_trace(argv[++i]))
+         {
+            fprintf(stderr, "Could not open trace file %s!\n", argv[i]);
+            return 1;
+         }
+      }
+      else if (!strcmp(argv[i], "--gdb") && i + 1 < argc)
+      {
+         gdb_path = argv[++i];
+      }
+      else if (!strcmp(argv[i], "--script") && i + 1 < argc)
+      {
+         script_path = argv[++i];
+      }
+      else if (!strcmp(argv[i], "--export") && i + 1 < argc)
+      {
+         export_path = argv[++i];
+      }
+      else if (!strcmp(argv[i], "--export-format") && i + 1 < argc)
+      {
+         const char* format = argv[++i];
+         if (!strcmp(format, "json"))     export_format = STATE_EXPORT_JSON;
+         else if (!strcmp(format, "csv")) export_format = STATE_EXPORT_CSV;
+         else
+         {
+            print_usage(argv[0]);
+            return 1;
+         }
+      }
+      else if (!strcmp(argv[i], "--export-range") && i + 1 < argc)
+      {
+         const char* range = argv[++i];
+         char* end;
+         const unsigned long first = strtoul(range, &end, 0);
+         unsigned long last = first;
+         bool valid = end != range && (*end == '\0' || *end == ':');
+
+         if (valid && *end == ':')
+         {
+            const char* second = end + 1;
+            last = strtoul(second, &end, 0);
+            valid = end != second && *end == '\0';
+         }
+
+         if (!valid || first > UINT16_MAX || last > UINT16_MAX ||
+             state_export_add_range((uint16_t)first, (uint16_t)last))
+         {
+            fprintf(stderr, "Invalid export range %s!\n", argv[i]);
+            return 1;
+         }
+      }
+      else if (!strcmp(argv[i], "--engine") && i + 1 < argc)
+      {
+         const char* engine = argv[++i];
+         if (!strcmp(engine, "run"))       control_unit_set_engine(CONTROL_UNIT_ENGINE_RUN);
+         else if (!strcmp(engine, "step")) control_unit_set_engine(CONTROL_UNIT_ENGINE_STEP);
+         else
+         {
+            print_usage(argv[0]);
+            return 1;
+         }
+      }
+      else if (!strcmp(argv[i], "--perf"))
+      {
+         perf = true;
+      }
+      else if (!strcmp(argv[i], "--bench"))
+      {
+         benchmark = true;
+      }
+      else if (!strcmp(argv[i], "--bench-cycles") && i + 1 < argc)
+      {
+         benchmark_config.cycles = strtoull(argv[++i], 0, 0);
+      }
+      else if (!strcmp(argv[i], "--bench-repeat") && i + 1 < argc)
+      {
+         benchmark_config.repetitions = (size_t)strtoull(argv[++i], 0, 0);
+      }
+      else if (!strcmp(argv[i], "--bench-warmup") && i + 1 < argc)
+      {
+         benchmark_config.warmup_cycles = strtoull(argv[++i], 0, 0);
+      }
+      else if (!strcmp(argv[i], "--bench-baseline") && i + 1 < argc)
+      {
+         baseline_path = argv[++i];
+      }
+      else if (!strcmp(argv[i], "--bench-tolerance") && i + 1 < argc)
+      {
+         baseline_tolerance = strtod(argv[++i], 0);
+      }
+      else if (!strcmp(argv[i], "--bench-update"))
+      {
+         update_baseline = true;
+      }
+      else if (!strcmp(argv[i], "--diff-engines"))
+      {
+         diff_engines = true;
+      }
+      else if (!strcmp(argv[i], "--diff-cycles") && i + 1 < argc)
+      {
+         diff_config.cycles = strtoull(argv[++i], 0, 0);
+      }
+      else if (!strcmp(argv[i], "--diff-interval") && i + 1 < argc)
+      {
+         diff_config.interval = strtoull(argv[++i], 0, 0);
+      }
+      else if (!strcmp(argv[i], "--trace-read") && i + 1 < argc)
+      {
+         trace_path = argv[++i];
+      }
+      else if (!strcmp(argv[i], "--from") && i + 1 < argc)
+      {
+         filter.first_cycle = strtoull(argv[++i], 0, 0);
+      }
+      else if (!strcmp(argv[i], "--to") && i + 1 < argc)
+      {
+         filter.last_cycle = strtoull(argv[++i], 0, 0);
+      }
+      else if (!strcmp(argv[i], "--pc") && i + 1 < argc)
+      {
+         char* end;
+         filter.first_pc = strtoull(argv[++i], &end, 0);
+         filter.last_pc = *end == ':' ? strtoull(end + 1, 0, 0) : filter.first_pc;
+      }
+      else if (!strcmp(argv[i], "--address") && i + 1 < argc)
+      {
+         filter.address = strtoull(argv[++i], 0, 0);
+      }
+      else if (!strcmp(argv[i], "--state") && i + 1 < argc)
+      {
+         state_cycle = strtoull(argv[++i], 0, 0);
+      }
+      else
+      {
+         print_usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (trace_path)
+   {
+      return read_trace(trace_path, &filter, state_cycle);
+   }
+
+   if (benchmark)
+   {
+      return run_benchmark(&benchmark_config, baseline_path, baseline_tolerance / 100.0, update_baseline);
+   }
+
+   if (diff_engines)
+   {
+      return engine_diff_run(&diff_config);
+   }
+
+   if (perf && control_unit_start_perf())
+   {
+      fprintf(stderr, "Could not open any host performance counter!\n");
+      return 1;
+   }
+
+   if (export_path && gdb_path && !strcmp(export_path, "-") && !strcmp(gdb_path, "-"))
+   {
+      fprintf(stderr, "Can't export to stdout while GDB is connected via stdio!\n");
+      return 1;
+   }
+
+   if (export_path && state_export_open(export_path, export_format))
+   {
+      fprintf(stderr, "Could not open export file %s!\n", export_path);
+      return 1;
+   }
+
+   if (gdb_path)
+   {
+      control_unit_reset();
+      if (gdb_stub_run(gdb_path))
+      {
+         fprintf(stderr, "Could not connect to GDB via %s!\n", gdb_path);
+      }
+   }
+   else if (script_path)
+   {
+      result = cpu_controller_run_script(script_path);
+   }
+   else
+   {
+      cpu_controller_run_by_input();
+   }
+
+   profiler_stop();
+   profiler_print();
+   control_unit_stop_perf();
+   control_unit_print_perf();
+
+   if (folded_path && profiler_write_folded(folded_path))
+   {
+      fprintf(stderr, "Could not write folded stacks to %s!\n", folded_path);
+   }
+   state_export_write();
+   state_export_close();
+   control_unit_close_trace();
+   uart_close();
+   vcd_close();
+   return result;
+}
+
+/********************************************************************************
+* print_usage: Prints the available command line options.
+*
+*              - program: The name of the program.
+********************************************************************************/
+static void print_usage(const char* program)
+{
+   fprintf(stderr, "Usage: %s [options]\n", program);
+   fprintf(stderr, "  --uart-in <file>         Feeds the UART receiver from file (\"-\" for stdin).\n");
+   fprintf(stderr, "  --uart-out <file>        Writes UART output to file (\"-\" for stdout).\n");
+   fprintf(stderr, "  --vcd <file>             Records PORTB-PORTD to a VCD file (gzipped if *.gz).\n");
+   fprintf(stderr, "  --stack-trap <policy>    Action on stack overflow/underflow, either\n");
+   fprintf(stderr, "                           ignore (default), halt, exception or reset.\n");
+   fprintf(stderr, "  --profile                Prints calls, cycles and stack usage per subroutine at exit.\n");
+   fprintf(stderr, "  --profile-folded <file>  Profiles as above and writes folded stacks to file.\n");
+   fprintf(stderr, "  --trace <file>           Writes a binary trace of all executed instructions to file.\n");
+   fprintf(stderr, "  --gdb <path>             Runs under GDB via a Unix socket at path (\"-\" for stdio).\n");
+   fprintf(stderr, "  --script <file>          Runs the commands of a script (\"-\" for stdin) instead of the menu.\n");
+   fprintf(stderr, "  --export <file>          Exports state and statistics at exit (\"-\" for stdout).\n");
+   fprintf(stderr, "  --export-format <format> Export format, either json (default) or csv.\n");
+   fprintf(stderr, "  --export-range <f>:<l>   Adds a data memory range to the export.\n");
+   fprintf(stderr, "  --engine <engine>        Engine of continuous runs, either run (default) or step.\n");
+   fprintf(stderr, "  --perf                   Prints host hardware events per simulated instruction at exit.\n");
+   fprintf(stderr, "\nRunning the benchmarks instead of the simulator:\n");
+   fprintf(stderr, "  --bench                  Runs the benchmark kernels on all execution engines.\n");
+   fprintf(stderr, "  --bench-cycles <n>       Clock cycles per measured repetition (default 5000000).\n");
+   fprintf(stderr, "  --bench-repeat <n>       Number of measured repetitions (default 5).\n");
+   fprintf(stderr, "  --bench-warmup <n>       Clock cycles run before measuring (default 1000000).\n");
+   fprintf(stderr, "  --bench-baseline <file>  Checks against a baseline file, written if missing.\n");
+   fprintf(stderr, "  --bench-tolerance <pct>  Allowed slowdown against the baseline (default 10).\n");
+   fprintf(stderr, "  --bench-update           Overwrites the baseline with the results.\n");
+   fprintf(stderr, "\nTesting the engines against the reference engine instead of running the simulator:\n");
+   fprintf(stderr, "  --diff-engines           Runs the program and kernels on all engines in lockstep.\n");
+   fprintf(stderr, "  --diff-cycles <n>        Clock cycles run per program (default 1000000).\n");
+   fprintf(stderr, "  --diff-interval <n>      Clock cycles between state comparisons (default 10000, max 1000000).\n");
+   fprintf(stderr, "\nReading a trace instead of running the simulator:\n");
+   fprintf(stderr, "  --trace-read <file>      Prints the records of specified trace file.\n");
+   fprintf(stderr, "  --from <cycle>           Starts printing at specified clock cycle.\n");
+   fprintf(stderr, "  --to <cycle>             Stops printing after specified clock cycle.\n");
+   fprintf(stderr, "  --pc <first>:<last>      Only prints instructions in the address range.\n");
+   fprintf(stderr, "  --address <address>      Only prints writes of the data memory address.\n");
+   fprintf(stderr, "  --state <cycle>          Prints the reconstructed machine state at the clock cycle.\n");
+   return;
+}
+
+/********************************************************************************
+* run_benchmark: Runs the benchmark kernels on all execution engines and
+*                prints the results. If a baseline file is specified, the
+*                results are checked against it, or saved to it if it
+*                doesn't exist or shall be updated. Error code 1 is returned
+*                on a regression or if the baseline couldn't be written,
+*                otherwise 0.
+*
+*                - config         : The benchmark parameters.
+*                - baseline_path  : Path to the baseline file, or a null pointer.
+*                - tolerance      : Allowed slowdown as a fraction.
+*                - update_baseline: Indicates if the baseline shall be overwritten.
+********************************************************************************/
+static int run_benchmark(const struct benchmark_config* config,
+                         const char* baseline_path,
+                         const double tolerance,
+                         const bool update_baseline)
+{
+   struct benchmark_result results[BENCHMARK_MAX_RESULTS];
+   size_t num_regressions = 0;
+
+   printf("Running %llu kernels on %d engines, %llu repetitions of %llu clock cycles...\n\n",
+          (unsigned long long)benchmark_kernel_count(), CONTROL_UNIT_NUM_ENGINES,
+          (unsigned long long)config->repetitions, (unsigned long long)config->cycles);
+   const size_t num_results = benchmark_run(config, results, BENCHMARK_MAX_RESULTS);
+   benchmark_print(results, num_results);
+
+   if (!baseline_path) return 0;
+
+   if (update_baseline ||
+       benchmark_check_baseline(baseline_path, config, results, num_results, tolerance, &num_regressions))
+   {
+      if (benchmark_save_baseline(baseline_path, config, results, num_results))
+      {
+         fprintf(stderr, "Could not write baseline file %s!\n", baseline_path);
+         return 1;
+      }
+
+      printf("Baseline saved to %s.\n", baseline_path);
+      return 0;
+   }
+   return num_regressions ? 1 : 0;
+}
+
+/********************************************************************************
+* read_trace: Prints the records of specified trace file selected by the
+*             filter, or the machine state at specified clock cycle. After
+*             success, 0 is returned, otherwise error code 1.
+*
+*             - path       : Path to the trace file.
+*             - filter     : Reference to the filter for printed records.
+*             - state_cycle: Clock cycle of the printed state, or
+*                            TRACE_READER_NONE to print records.
+********************************************************************************/
+static int read_trace(const char* path,
+                      const struct trace_filter* filter,
+                      const uint64_t state_cycle)
+{
+   struct trace_reader reader;
+
+   if (trace_reader_open(&reader, path))
+   {
+      fprintf(stderr, "Could not read trace file %s!\n", path);
+      return 1;
+   }
+
+   printf("Trace %s: %llu records in %llu blocks\n\n", path, (unsigned long long)reader.num_records,
+          (unsigned long long)reader.num_blocks);
+
+   if (state_cycle != TRACE_READER_NONE)
+   {
+      struct trace_checkpoint state;
+
+      if (trace_reader_state(&reader, state_cycle, &state))
+      {
+         fprintf(stderr, "The trace doesn't reach clock cycle %llu!\n", (unsigned long long)state_cycle);
+         trace_reader_close(&reader);
+         return 1;
+      }
+
+      trace_reader_print_state(&state);
+   }
+   else
+   {
+      printf("\n%llu records printed\n", (unsigned long long)trace_reader_print(&reader, filter));
+   }
+
+   trace_reader_close(&reader);
+   return 0;
+}
@@ -0,0 +1,232 @@
+/********************************************************************************
+* perf_counters.c: Contains function definitions for hardware performance
+*                  counters of the host via perf_event_open on Linux. The
+*                  counters are opened one by one rather than as a group, so
+*                  that counters unsupported by the host CPU don't disable
+*                  the others.
+********************************************************************************/
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* Declares syscall with -std=c11. */
+#endif
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+#include "perf_counters.h"
+
+/* Static functions: */
+#ifdef __linux__
+static int open_counter(const enum perf_counter counter);
+#endif
+
+/********************************************************************************
+* perf_counters_open: Opens all counters which are available on the host.
+*                     After success, 0 is returned. If no counter could be
+*                     opened, error code 1 is returned.
+*
+*                     - self: Reference to the counters.
+********************************************************************************/
+int perf_counters_open(struct perf_counters* self)
+{
+   int result = 1;
+
+   for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+   {
+#ifdef __linux__
+      self->descriptors[i] = open_counter((enum perf_counter)i);
+#else
+      self->descriptors[i] = -1;
+#endif
+      self->values[i] = PERF_COUNTERS_UNAVAILABLE;
+      if (self->descriptors[i] >= 0) result = 0;
+   }
+   return result;
+}
+
+/********************************************************************************
+* perf_counters_close: Closes all counters.
+*
+*                      - self: Reference to the counters.
+********************************************************************************/
+void perf_counters_close(struct perf_counters* self)
+{
+   for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+   {
+#ifdef __linux__
+      if (self->descriptors[i] >= 0) close(self->descriptors[i]);
+#endif
+      self->descriptors[i] = -1;
+   }
+   return;
+}
+
+/********************************************************************************
+* perf_counters_start: Resets and starts all available counters.
+*
+*                      - self: Reference to the counters.
+********************************************************************************/
+void perf_counters_start(struct perf_counters* self)
+{
+#ifdef __linux__
+   for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+   {
+      if (self->descriptors[i] < 0) continue;
+      ioctl(self->descriptors[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(self->descriptors[i], PERF_EVENT_IOC_ENABLE, 0);
+   }
+#else
+   (void)self;
+#endif
+   return;
+}
+
+/********************************************************************************
+* perf_counters_stop: Stops all available counters and reads their values.
+*
+*                     - self: Reference to the counters.
+********************************************************************************/
+void perf_counters_stop(struct perf_counters* self)
+{
+   for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+   {
+#ifdef __linux__
+      uint64_t value;
+
+      if (self->descriptors[i] >= 0)
+      {
+         ioctl(self->descriptors[i], PERF_EVENT_IOC_DISABLE, 0);
+
+         /* Parenthesized, since read is a macro in cpu.h. */
+         if ((read)(self->descriptors[i], &value, sizeof(value)) == sizeof(value))
+         {
+            self->values[i] = value;
+            continue;
+         }
+      }
+#endif
+      self->values[i] = PERF_COUNTERS_UNAVAILABLE;
+   }
+   return;
+}
+
+/********************************************************************************
+* perf_counters_available: Indicates if specified counter is available.
+*
+*                          - self   : Reference to the counters.
+*                          - counter: The counter.
+********************************************************************************/
+bool perf_counters_available(const struct perf_counters* self,
+                             const enum perf_counter counter)
+{
+   return self->descriptors[counter] >= 0;
+}
+
+/********************************************************************************
+* perf_counter_name: Returns the name of specified counter.
+*
+*                    - counter: The counter.
+********************************************************************************/
+const char* perf_counter_name(const enum perf_counter counter)
+{
+   if (counter == PERF_COUNTER_CYCLES)             return "cycles";
+   else if (counter == PERF_COUNTER_INSTRUCTIONS)  return "instructions";
+   else if (counter == PERF_COUNTER_BRANCH_MISSES) return "branch-misses";
+   else if (counter == PERF_COUNTER_CACHE_MISSES)  return "cache-misses";
+   else if (counter == PERF_COUNTER_L1D_MISSES)    return "L1d-misses";
+   else return "Unknown";
+}
+
+/********************************************************************************
+* perf_counters_accumulate: Adds the values read by the last stop to
+*                           specified totals, one per counter. A total stays
+*                           PERF_COUNTERS_UNAVAILABLE once a value couldn't
+*                           be read, so that partial counts aren't reported.
+*
+*                           - self  : Reference to the counters.
+*                           - totals: Reference to the totals.
+********************************************************************************/
+void perf_counters_accumulate(const struct perf_counters* self,
+                              uint64_t* totals)
+{
+   for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+   {
+      if (totals[i] == PERF_COUNTERS_UNAVAILABLE) continue;
+      if (self->values[i] == PERF_COUNTERS_UNAVAILABLE) totals[i] = PERF_COUNTERS_UNAVAILABLE;
+      else totals[i] += self->values[i];
+   }
+   return;
+}
+
+/********************************************************************************
+* perf_counters_print_names: Prints the names of all counters as column
+*                            headings, ending the line.
+********************************************************************************/
+void perf_counters_print_names(void)
+{
+   for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+   {
+      printf(" %13s", perf_counter_name((enum perf_counter)i));
+   }
+   printf("\n");
+   return;
+}
+
+/********************************************************************************
+* perf_counters_print_row: Prints specified totals per simulated instruction
+*                          in the columns of perf_counters_print_names,
+*                          ending the line. Unavailable totals are printed
+*                          as "-".
+*
+*                          - totals          : Reference to the totals.
+*                          - num_instructions: Simulated instructions counted.
+********************************************************************************/
+void perf_counters_print_row(const uint64_t* totals,
+                             const uint64_t num_instructions)
+{
+   for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+   {
+      if (totals[i] == PERF_COUNTERS_UNAVAILABLE || !num_instructions) printf(" %13s", "-");
+      else printf(" %13.3f", (double)totals[i] / num_instructions);
+   }
+   printf("\n");
+   return;
+}
+
+#ifdef __linux__
+/********************************************************************************
+* open_counter: Opens specified counter for the calling thread, disabled and
+*               counting user space only. The descriptor is returned, or -1
+*               if the counter isn't available.
+*
+*               - counter: The counter.
+********************************************************************************/
+static int open_counter(const enum perf_counter counter)
+{
+   struct perf_event_attr attr;
+   memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.disabled = 1;
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+
+   if (counter == PERF_COUNTER_L1D_MISSES)
+   {
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+   }
+   else
+   {
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = counter == PERF_COUNTER_CYCLES ? PERF_COUNT_HW_CPU_CYCLES :
+         counter == PERF_COUNTER_INSTRUCTIONS ? PERF_COUNT_HW_INSTRUCTIONS :
+         counter == PERF_COUNTER_BRANCH_MISSES ? PERF_COUNT_HW_BRANCH_MISSES : PERF_COUNT_HW_CACHE_MISSES;
+   }
+
+   return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
@@ -0,0 +1,119 @@
+/********************************************************************************
+* perf_counters.h: Contains definitions and function declarations for
+*                  hardware performance counters of the host, which measure
+*                  how the simulator itself runs on the host CPU, for
+*                  instance the branch misses caused by instruction dispatch.
+*                  The counters are read via perf_event_open on Linux and
+*                  only count user space. On other hosts, or if the kernel
+*                  doesn't permit access, no counter is available and all
+*                  values read as PERF_COUNTERS_UNAVAILABLE.
+********************************************************************************/
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+/* Include directives: */
+#include "cpu.h"
+
+/* Macro definitions: */
+#define PERF_COUNTERS_UNAVAILABLE UINT64_MAX /* Value of a counter that couldn't be opened. */
+
+/********************************************************************************
+* perf_counter: Enumeration for the hardware events counted.
+********************************************************************************/
+enum perf_counter
+{
+   PERF_COUNTER_CYCLES,        /* Host CPU cycles. */
+   PERF_COUNTER_INSTRUCTIONS,  /* Host instructions retired. */
+   PERF_COUNTER_BRANCH_MISSES, /* Mispredicted host branches. */
+   PERF_COUNTER_CACHE_MISSES,  /* Host last level cache misses. */
+   PERF_COUNTER_L1D_MISSES,    /* Host level 1 data cache read misses. */
+   PERF_NUM_COUNTERS           /* Number of counters. */
+};
+
+/********************************************************************************
+* perf_counters: Structure for a set of hardware performance counters of the
+*                calling thread.
+********************************************************************************/
+struct perf_counters
+{
+   int descriptors[PERF_NUM_COUNTERS]; /* Descriptors of the counters, -1 if unavailable. */
+   uint64_t values[PERF_NUM_COUNTERS]; /* Counts between the last start and stop. */
+};
+
+/********************************************************************************
+* perf_counters_open: Opens all counters which are available on the host.
+*                     After success, 0 is returned. If no counter could be
+*                     opened, error code 1 is returned.
+*
+*                     - self: Reference to the counters.
+********************************************************************************/
+int perf_counters_open(struct perf_counters* self);
+
+/********************************************************************************
+* perf_counters_close: Closes all counters.
+*
+*                      - self: Reference to the counters.
+********************************************************************************/
+void perf_counters_close(struct perf_counters* self);
+
+/********************************************************************************
+* perf_counters_start: Resets and starts all available counters.
+*
+*                      - self: Reference to the counters.
+********************************************************************************/
+void perf_counters_start(struct perf_counters* self);
+
+/********************************************************************************
+* perf_counters_stop: Stops all available counters and reads their values.
+*
+*                     - self: Reference to the counters.
+********************************************************************************/
+void perf_counters_stop(struct perf_counters* self);
+
+/********************************************************************************
+* perf_counters_available: Indicates if specified counter is available.
+*
+*                          - self   : Reference to the counters.
+*                          - counter: The counter.
+********************************************************************************/
+bool perf_counters_available(const struct perf_counters* self,
+                             const enum perf_counter counter);
+
+/********************************************************************************
+* perf_counter_name: Returns the name of specified counter.
+*
+*                    - counter: The counter.
+********************************************************************************/
+const char* perf_counter_name(const enum perf_counter counter);
+
+/********************************************************************************
+* perf_counters_accumulate: Adds the values read by the last stop to
+*                           specified totals, one per counter. A total stays
+*                           PERF_COUNTERS_UNAVAILABLE once a value couldn't
+*                           be read, so that partial counts aren't reported.
+*
+*                           - self  : Reference to the counters.
+*                           - totals: Reference to the totals.
+********************************************************************************/
+void perf_counters_accumulate(const struct perf_counters* self,
+                              uint64_t* totals);
+
+/********************************************************************************
+* perf_counters_print_names: Prints the names of all counters as column
+*                            headings, ending the line.
+********************************************************************************/
+void perf_counters_print_names(void);
+
+/********************************************************************************
+* perf_counters_print_row: Prints specified totals per simulated instruction
+*                          in the columns of perf_counters_print_names,
+*                          ending the line. Unavailable totals are printed
+*                          as "-".
+*
+*                          - totals          : Reference to the totals.
+*                          - num_instructions: Simulated instructions counted.
+********************************************************************************/
+void perf_counters_print_row(const uint64_t* totals,
+                             const uint64_t num_instructions);
+
+#endif /* PERF_COUNTERS_H_ */
@@ -0,0 +1,498 @@
+/********************************************************************************
+* profiler.c: Contains static variables and function definitions for the
+*             firmware profiler. The stack usage of a frame is measured via
+*             the low mark of the stack, which is maintained by the inline
+*             push at the cost of one compare, so the profiler itself only
+*             runs on calls and returns. Clock cycles are measured from the
+*             cycle counter of the control unit at entry and exit of frames.
+*             Addresses within the interrupt vector table are profiled as
+*             entries of their own after the symbol table, named after the
+*             vector, so that interrupts aren't charged to RESET_vect.
+********************************************************************************/
+#include "profiler.h"
+#include "control_unit.h"
+
+/* Macro definitions: */
+#define PROFILER_NO_NODE   SIZE_MAX /* Marks the absence of a node in the call path tree. */
+#define PROFILER_NAME_SIZE 16       /* Size of a buffer for the name of an entry. */
+
+/********************************************************************************
+* frame: Structure for a frame on the shadow call stack.
+********************************************************************************/
+struct frame
+{
+   size_t symbol;           /* Entry of the called subroutine or interrupt vector. */
+   size_t caller;           /* Entry of the calling subroutine. */
+   size_t node;             /* Index of the call path of the frame in the call path tree. */
+   uint16_t entry_sp;       /* Stack pointer before the return address was pushed. */
+   uint16_t saved_low_mark; /* Low mark of the stack in the enclosing frame. */
+   uint64_t entry_cycle;    /* Clock cycle at which the frame was entered. */
+   uint64_t callee_cycles;  /* Clock cycles spent in callees of the frame. */
+};
+
+/********************************************************************************
+* symbol_stats: Structure for the statistics of a subroutine.
+********************************************************************************/
+struct symbol_stats
+{
+   uint64_t calls;            /* Number of calls of the subroutine. */
+   uint64_t inclusive_cycles; /* Clock cycles spent in the subroutine including callees. */
+   uint64_t exclusive_cycles; /* Clock cycles spent in the subroutine itself. */
+   uint16_t max_usage;        /* Max number of stack bytes used by the subroutine and its callees. */
+};
+
+/********************************************************************************
+* edge_stats: Structure for the statistics of calls from one subroutine to
+*             another in the caller/callee graph.
+********************************************************************************/
+struct edge_stats
+{
+   uint64_t calls;  /* Number of calls. */
+   uint64_t cycles; /* Clock cycles spent in the callee, including its callees. */
+};
+
+/********************************************************************************
+* call_node: Structure for a node in the call path tree. The children of a
+*            node are kept in a singly linked list.
+********************************************************************************/
+struct call_node
+{
+   size_t symbol;             /* Entry of the subroutine or interrupt vector. */
+   size_t parent;             /* Index of the parent node. */
+   size_t first_child;        /* Index of the first child node. */
+   size_t next_sibling;       /* Index of the next sibling node. */
+   uint64_t exclusive_cycles; /* Clock cycles spent in the subroutine on this call path. */
+};
+
+/* Static variables: */
+static bool enabled;                            /* Indicates if profiling is in progress. */
+static struct frame frames[PROFILER_MAX_DEPTH]; /* The shadow call stack. */
+static size_t depth;                            /* Number of frames on the shadow call stack. */
+static size_t untracked;                        /* Number of nested calls beyond max depth. */
+static size_t num_entries;                      /* Number of symbols and interrupt vectors. */
+static struct symbol_stats* stats;              /* Statistics per entry. */
+static struct edge_stats* edges;                /* Statistics per caller and callee entry. */
+
+static struct call_node* nodes; /* The call path tree, node 0 is the root. */
+static size_t num_nodes;        /* Number of nodes in the call path tree. */
+static size_t nodes_capacity;   /* Number of nodes allocated for the call path tree. */
+static size_t root_node;        /* Node of the subroutine running outside any call. */
+static uint64_t root_cycle;     /* Clock cycle at which the shadow call stack was last empty. */
+
+static size_t deepest_chain[PROFILER_MAX_DEPTH]; /* Entries of the call chain that reached the high water mark. */
+static size_t deepest_depth;                     /* Number of entries in the deepest call chain. */
+static uint16_t deepest_usage;                   /* Stack usage in bytes when the deepest call chain was active. */
+
+/* Static functions: */
+static size_t entry_index(const uint16_t address);
+static const char* entry_name(const size_t entry,
+                              char* buffer);
+static size_t child_node(const size_t parent,
+                         const size_t symbol);
+static bool active_below(const size_t symbol,
+                         const size_t index);
+static void account_stack(const size_t index,
+                          const uint16_t low_mark);
+static void close_frames(void);
+
+/********************************************************************************
+* profiler_start: Clears all statistics and starts profiling. After success,
+*                 0 is returned. If the memory for the statistics couldn't be
+*                 allocated, error code 1 is returned.
+********************************************************************************/
+int profiler_start(void)
+{
+   const size_t reset_symbol = program_memory_symbol_index(RESET_vect);
+
+   free(stats);
+   free(edges);
+   free(nodes);
+
+   num_entries = program_memory_symbol_count() + program_memory_symbol_address(reset_symbol + 1) - RESET_vect;
+   stats = (struct symbol_stats*)calloc(num_entries, sizeof(struct symbol_stats));
+   edges = (struct edge_stats*)calloc(num_entries * num_entries, sizeof(struct edge_stats));
+   nodes = (struct call_node*)malloc(64 * sizeof(struct call_node));
+   nodes_capacity = nodes ? 64 : 0;
+   if (!stats || !edges || !nodes) return 1;
+
+   nodes[0].symbol = PROFILER_NO_NODE;
+   nodes[0].parent = PROFILER_NO_NODE;
+   nodes[0].first_child = PROFILER_NO_NODE;
+   nodes[0].next_sibling = PROFILER_NO_NODE;
+   nodes[0].exclusive_cycles = 0;
+   num_nodes = 1;
+
+   root_node = child_node(0, reset_symbol);
+   root_cycle = control_unit_cycle_count();
+   depth = 0;
+   untracked = 0;
+   deepest_depth = 0;
+   deepest_usage = 0;
+   enabled = true;
+   return 0;
+}
+
+/********************************************************************************
+* profiler_stop: Accounts the frames on the shadow call stack as if they were
+*                returned from at the current clock cycle and stops profiling.
+*                The statistics are kept for the reports.
+********************************************************************************/
+void profiler_stop(void)
+{
+   if (!enabled) return;
+   close_frames();
+   enabled = false;
+   return;
+}
+
+/********************************************************************************
+* profiler_reset: Accounts the frames on the shadow call stack as if they
+*                 were returned from and clears it, since the stack and the
+*                 cycle counter are cleared on reset. The statistics are kept.
+*                 Must be called before the stack and the cycle counter are
+*                 reset.
+********************************************************************************/
+void profiler_reset(void)
+{
+   if (!enabled) return;
+   close_frames();
+   root_node = child_node(0, program_memory_symbol_index(RESET_vect));
+   root_cycle = 0;
+   return;
+}
+
+/********************************************************************************
+* profiler_call: Pushes a frame for the subroutine at specified address to
+*                the shadow call stack. Must be called before the return
+*                address is pushed to the stack.
+*
+*                - address  : Start address of the called subroutine.
+*                - call_site: Address of the calling instruction, or of the
+*                             interrupted instruction for interrupts.
+********************************************************************************/
+void profiler_call(const uint16_t address,
+                   const uint16_t call_site)
+{
+   if (!enabled) return;
+
+   if (depth < PROFILER_MAX_DEPTH)
+   {
+      const uint64_t cycle = control_unit_cycle_count();
+      struct frame* frame = &frames[depth];
+      frame->symbol = entry_index(address);
+      frame->caller = entry_index(call_site);
+
+      if (!depth)
+      {
+         root_node = child_node(0, frame->caller);
+         nodes[root_node].exclusive_cycles += cycle - root_cycle;
+         frame->node = child_node(root_node, frame->symbol);
+      }
+      else
+      {
+         frame->node = child_node(frames[depth - 1].node, frame->symbol);
+      }
+
+      frame->entry_sp = stack_pointer();
+      frame->saved_low_mark = stack_enter_frame();
+      frame->entry_cycle = cycle;
+      frame->callee_cycles = 0;
+
+      stats[frame->symbol].calls++;
+      edges[frame->caller * num_entries + frame->symbol].calls++;
+      depth++;
+   }
+   else
+   {
+      untracked++;
+   }
+   return;
+}
+
+/********************************************************************************
+* profiler_return: Pops the current frame from the shadow call stack and
+*                  accounts its clock cycles and stack usage. Returns without
+*                  matching calls are ignored.
+********************************************************************************/
+void profiler_return(void)
+{
+   if (!enabled) return;
+
+   if (untracked)
+   {
+      untracked--;
+   }
+   else if (depth)
+   {
+      const uint64_t cycle = control_unit_cycle_count();
+      const struct frame* frame = &frames[depth - 1];
+      const uint64_t inclusive_cycles = cycle - frame->entry_cycle;
+      const uint64_t exclusive_cycles = inclusive_cycles - frame->callee_cycles;
+
+      if (!active_below(frame->symbol, depth - 1))
+      {
+         stats[frame->symbol].inclusive_cycles += inclusive_cycles;
+      }
+
+      stats[frame->symbol].exclusive_cycles += exclusive_cycles;
+      nodes[frame->node].exclusive_cycles += exclusive_cycles;
+      edges[frame->caller * num_entries + frame->symbol].cycles += inclusive_cycles;
+
+      if (depth > 1) frames[depth - 2].callee_cycles += inclusive_cycles;
+      else root_cycle = cycle;
+
+      account_stack(depth - 1, stack_leave_frame(frame->saved_low_mark));
+      depth--;
+   }
+   return;
+}
+
+/********************************************************************************
+* profiler_print: Prints the profiling report, i.e. the stack high water mark,
+*                 the call chain that reached it, the number of calls, clock
+*                 cycles and max stack usage per subroutine as well as the
+*                 caller/callee graph. Should be called after profiler_stop,
+*                 so that frames still on the shadow call stack are included.
+********************************************************************************/
+void profiler_print(void)
+{
+   char name[PROFILER_NAME_SIZE];
+   char callee_name[PROFILER_NAME_SIZE];
+   if (!stats) return;
+
+   printf("--------------------------------------------------------------------------------\n");
+   printf("Stack high water mark:\t\t\t\t%hu bytes\n", stack_high_water_mark());
+   printf("Deepest call chain (%hu bytes):\t\t\t", deepest_usage);
+
+   if (!deepest_depth) printf("-");
+
+   for (size_t i = 0; i < deepest_depth; ++i)
+   {
+      printf(i ? " -> %s" : "%s", entry_name(deepest_chain[i], name));
+   }
+
+   printf("\n\n%-20s %12s %16s %16s %12s\n", "Subroutine", "Calls", "Inclusive cycles",
+          "Exclusive cycles", "Max stack");
+
+   for (size_t i = 0; i < num_entries; ++i)
+   {
+      if (stats[i].calls)
+      {
+         printf("%-20s %12llu %16llu %16llu %6hu bytes\n", entry_name(i, name),
+                (unsigned long long)stats[i].calls, (unsigned long long)stats[i].inclusive_cycles,
+                (unsigned long long)stats[i].exclusive_cycles, stats[i].max_usage);
+      }
+   }
+
+   printf("\n%-41s %12s %16s\n", "Caller -> callee", "Calls", "Cycles");
+
+   for (size_t caller = 0; caller < num_entries; ++caller)
+   {
+      for (size_t callee = 0; callee < num_entries; ++callee)
+      {
+         const struct edge_stats* edge = &edges[caller * num_entries + callee];
+
+         if (edge->calls)
+         {
+            printf("%-20s %-20s %12llu %16llu\n", entry_name(caller, name),
+                   entry_name(callee, callee_name), (unsigned long long)edge->calls,
+                   (unsigned long long)edge->cycles);
+         }
+      }
+   }
+
+   printf("--------------------------------------------------------------------------------\n\n");
+   return;
+}
+
+/********************************************************************************
+* profiler_write_folded: Writes the exclusive clock cycles per call path to
+*                        specified file as folded stacks, one line per path
+*                        with the subroutines separated by semicolons followed
+*                        by the number of cycles, which is the input format of
+*                        flamegraph.pl and similar tools. Cycles outside any
+*                        call are attributed to the subroutine that made the
+*                        next call. After success, 0 is returned. If the file
+*                        couldn't be opened, error code 1 is returned.
+*
+*                        - path: Path to the output file.
+********************************************************************************/
+int profiler_write_folded(const char* path)
+{
+   FILE* file = fopen(path, "w");
+   size_t path_nodes[PROFILER_MAX_DEPTH + 1];
+   char name[PROFILER_NAME_SIZE];
+   if (!file) return 1;
+
+   for (size_t i = 1; i < num_nodes; ++i)
+   {
+      size_t length = 0;
+      if (!nodes[i].exclusive_cycles) continue;
+
+      for (size_t node = i; node != 0 && length < PROFILER_MAX_DEPTH + 1; node = nodes[node].parent)
+      {
+         path_nodes[length++] = node;
+      }
+
+      while (length--)
+      {
+         fprintf(file, "%s%c", entry_name(nodes[path_nodes[length]].symbol, name),
+                 length ? ';' : ' ');
+      }
+      fprintf(file, "%llu\n", (unsigned long long)nodes[i].exclusive_cycles);
+   }
+
+   fclose(file);
+   return 0;
+}
+
+/********************************************************************************
+* entry_index: Returns the profiled entry of specified address, which is the
+*              index of the subroutine in the symbol table. Addresses within
+*              the interrupt vector table other than the reset vector have
+*              entries of their own after the symbol table, so interrupt
+*              routines entered through a vector are told apart from the
+*              reset vector and from each other.
+*
+*              - address: Address within the subroutine or vector table.
+********************************************************************************/
+static size_t entry_index(const uint16_t address)
+{
+   const size_t symbol = program_memory_symbol_index(address);
+
+   if (address != RESET_vect && program_memory_symbol_address(symbol) == RESET_vect)
+   {
+      return program_memory_symbol_count() + address - RESET_vect;
+   }
+   return symbol;
+}
+
+/********************************************************************************
+* entry_name: Returns the name of specified entry, i.e. the name of the
+*             subroutine or "<vector N>" for interrupt vectors, where N is
+*             the vector address.
+*
+*             - entry : The profiled entry.
+*             - buffer: Storage for names of interrupt vectors, with room for
+*                       PROFILER_NAME_SIZE characters.
+********************************************************************************/
+static const char* entry_name(const size_t entry,
+                              char* buffer)
+{
+   const size_t num_symbols = program_memory_symbol_count();
+   if (entry < num_symbols) return program_memory_symbol_name(entry);
+   snprintf(buffer, PROFILER_NAME_SIZE, "<vector 0x%02X>", (unsigned)(entry - num_symbols + RESET_vect));
+   return buffer;
+}
+
+/********************************************************************************
+* child_node: Returns the index of the child node of specified parent node
+*             for specified symbol, which is added to the call path tree if
+*             it doesn't exist. If memory for a new node can't be allocated,
+*             the parent node is returned.
+*
+*             - parent: Index of the parent node.
+*             - symbol: Entry of the subroutine or interrupt vector.
+********************************************************************************/
+static size_t child_node(const size_t parent,
+                         const size_t symbol)
+{
+   size_t node = nodes[parent].first_child;
+
+   while (node != PROFILER_NO_NODE)
+   {
+      if (nodes[node].symbol == symbol) return node;
+      node = nodes[node].next_sibling;
+   }
+
+   if (num_nodes == nodes_capacity)
+   {
+      struct call_node* copy = (struct call_node*)realloc(nodes, nodes_capacity * 2 * sizeof(struct call_node));
+      if (!copy) return parent;
+      nodes = copy;
+      nodes_capacity *= 2;
+   }
+
+   node = num_nodes++;
+   nodes[node].symbol = symbol;
+   nodes[node].parent = parent;
+   nodes[node].first_child = PROFILER_NO_NODE;
+   nodes[node].next_sibling = nodes[parent].first_child;
+   nodes[node].exclusive_cycles = 0;
+   nodes[parent].first_child = node;
+   return node;
+}
+
+/********************************************************************************
+* active_below: Indicates if specified symbol has a frame below specified
+*               index on the shadow call stack, i.e. if the subroutine is
+*               called recursively. The inclusive cycles are then only
+*               accounted by the outermost frame, so they aren't counted twice.
+*
+*               - symbol: Entry of the subroutine or interrupt vector.
+*               - index : Index of the frame on the shadow call stack.
+********************************************************************************/
+static bool active_below(const size_t symbol,
+                         const size_t index)
+{
+   for (size_t i = 0; i < index; ++i)
+   {
+      if (frames[i].symbol == symbol) return true;
+   }
+   return false;
+}
+
+/********************************************************************************
+* account_stack: Updates the statistics with the stack usage of the frame at
+*                specified index on the shadow call stack. If the stack
+*                pointer reached a new low while the frame was active, the
+*                call chain down to the frame is stored as the deepest call
+*                chain.
+*
+*                - index   : Index of the frame on the shadow call stack.
+*                - low_mark: Lowest stack address written while the frame
+*                            was active.
+********************************************************************************/
+static void account_stack(const size_t index,
+                          const uint16_t low_mark)
+{
+   const struct frame* frame = &frames[index];
+   const uint16_t usage = low_mark <= frame->entry_sp ? frame->entry_sp + 1 - low_mark : 0;
+   const uint16_t total_usage = low_mark <= STACK_TOP ? STACK_TOP + 1 - low_mark : 0;
+
+   if (usage > stats[frame->symbol].max_usage)
+   {
+      stats[frame->symbol].max_usage = usage;
+   }
+
+   if (total_usage > deepest_usage)
+   {
+      deepest_usage = total_usage;
+      deepest_depth = index + 1;
+
+      for (size_t i = 0; i <= index; ++i)
+      {
+         deepest_chain[i] = frames[i].symbol;
+      }
+   }
+   return;
+}
+
+/********************************************************************************
+* close_frames: Accounts the frames on the shadow call stack, innermost
+*               first, as if they were returned from at the current clock
+*               cycle, and the cycles spent outside any call since then.
+********************************************************************************/
+static void close_frames(void)
+{
+   untracked = 0;
+
+   while (depth)
+   {
+      profiler_return();
+   }
+
+   nodes[root_node].exclusive_cycles += control_unit_cycle_count() - root_cycle;
+   root_cycle = control_unit_cycle_count();
+   return;
+}
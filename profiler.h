@@ -0,0 +1,89 @@
+/********************************************************************************
+* profiler.h: Contains function declarations for a profiler of the firmware,
+*             which keeps a host-side shadow call stack updated on every CALL,
+*             RET, interrupt entry and RETI. For each subroutine, the number
+*             of calls, the inclusive and exclusive clock cycles and the max
+*             number of stack bytes used by the subroutine and its callees
+*             are recorded, along with the call chain that reached the deepest
+*             stack pointer. The caller/callee graph and a call path tree are
+*             built as well, the latter exported as folded stacks for flame
+*             graph tools. Interrupts are reported as "<vector N>", where N is
+*             the address of the interrupt vector.
+********************************************************************************/
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "program_memory.h"
+#include "stack.h"
+
+/* Macro definitions: */
+#define PROFILER_MAX_DEPTH 256 /* Max number of nested calls tracked by the shadow call stack. */
+
+/********************************************************************************
+* profiler_start: Clears all statistics and starts profiling. After success,
+*                 0 is returned. If the memory for the statistics couldn't be
+*                 allocated, error code 1 is returned.
+********************************************************************************/
+int profiler_start(void);
+
+/********************************************************************************
+* profiler_stop: Accounts the frames on the shadow call stack as if they were
+*                returned from at the current clock cycle and stops profiling.
+*                The statistics are kept for the reports.
+********************************************************************************/
+void profiler_stop(void);
+
+/********************************************************************************
+* profiler_reset: Accounts the frames on the shadow call stack as if they
+*                 were returned from and clears it, since the stack and the
+*                 cycle counter are cleared on reset. The statistics are kept.
+*                 Must be called before the stack and the cycle counter are
+*                 reset.
+********************************************************************************/
+void profiler_reset(void);
+
+/********************************************************************************
+* profiler_call: Pushes a frame for the subroutine at specified address to
+*                the shadow call stack. Must be called before the return
+*                address is pushed to the stack.
+*
+*                - address  : Start address of the called subroutine.
+*                - call_site: Address of the calling instruction, or of the
+*                             interrupted instruction for interrupts.
+********************************************************************************/
+void profiler_call(const uint16_t address,
+                   const uint16_t call_site);
+
+/********************************************************************************
+* profiler_return: Pops the current frame from the shadow call stack and
+*                  accounts its clock cycles and stack usage. Returns without
+*                  matching calls are ignored.
+********************************************************************************/
+void profiler_return(void);
+
+/********************************************************************************
+* profiler_print: Prints the profiling report, i.e. the stack high water mark,
+*                 the call chain that reached it, the number of calls, clock
+*                 cycles and max stack usage per subroutine as well as the
+*                 caller/callee graph. Should be called after profiler_stop,
+*                 so that frames still on the shadow call stack are included.
+********************************************************************************/
+void profiler_print(void);
+
+/********************************************************************************
+* profiler_write_folded: Writes the exclusive clock cycles per call path to
+*                        specified file as folded stacks, one line per path
+*                        with the subroutines separated by semicolons followed
+*                        by the number of cycles, which is the input format of
+*                        flamegraph.pl and similar tools. Cycles outside any
+*                        call are attributed to the subroutine that made the
+*                        next call. After success, 0 is returned. If the file
+*                        couldn't be opened, error code 1 is returned.
+*
+*                        - path: Path to the output file.
+********************************************************************************/
+int profiler_write_folded(const char* path);
+
+#endif /* PROFILER_H_ */
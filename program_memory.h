@@ -1,44 +1,89 @@
-/********************************************************************************
-* program_memory.h: Contains function declarations and macro definitions for
-*                   implementation of a 0.75 kB program memory, capable of
-*                   storing 256 24-bit instructions. Since C doesn't support 
-*                   unsigned 24-bit integers (without using structs or unions), 
-*                   the program memory is set to 32 bits data width, but only
-*                   24 bits are used.
-********************************************************************************/
-#ifndef PROGRAM_MEMORY_H_
-#define PROGRAM_MEMORY_H_
-
-/* Include directives: */
-#include "cpu.h"
-
-/* Macro definitions: */
-#define PROGRAM_MEMORY_DATA_WIDTH    24  /* 24 bits per instruction. */
-#define PROGRAM_MEMORY_ADDRESS_WIDTH 256 /* Capacity for storage of 256 instructions. */
-
-/********************************************************************************
-* program_memory_write: Writes machine code to the program memory by converting
-*                       from assembly code via an assembler. This function
-*                       should only be called once when the program starts.
-********************************************************************************/
-void program_memory_write(void);
-
-/********************************************************************************
-* program_memory_read: Returns the instruction at specified address. If an
-*                      invalid address is specified (should be impossible as
-*                      long as the program memory address width isn't increased)
-*                      no operation (0x00) is returned.
-*
-*                      - address: Address to instruction in program memory.
-********************************************************************************/
-uint32_t program_memory_read(const uint8_t address);
-
-/********************************************************************************
-* program_memory_subroutine_name: Returns the name of the subroutine at
-*                                 specified address.
-*
-*                                 - address: Address within the subroutine.
-********************************************************************************/
-const char* program_memory_subroutine_name(const uint8_t address);
-
+/********************************************************************************
+* program_memory.h: Contains function declarations and macro definitions for
+*                   implementation of a 96 kB program memory, capable of
+*                   storing 32K 24-bit instructions. Since C doesn't support 
+*                   unsigned 24-bit integers (without using structs or unions), 
+*                   the program memory is set to 32 bits data width, but only
+*                   24 bits are used.
+********************************************************************************/
+#ifndef PROGRAM_MEMORY_H_
+#define PROGRAM_MEMORY_H_
+
+/* Include directives: */
+#include "cpu.h"
+
+/* Macro definitions: */
+#define PROGRAM_MEMORY_DATA_WIDTH    24    /* 24 bits per instruction. */
+#define PROGRAM_MEMORY_ADDRESS_WIDTH 32768 /* Capacity for storage of 32K instructions (power of two). */
+
+/********************************************************************************
+* program_memory_write: Writes machine code to the program memory by converting
+*                       from assembly code via an assembler. This function
+*                       should only be called once when the program starts.
+********************************************************************************/
+void program_memory_write(void);
+
+/********************************************************************************
+* program_memory_read: Returns the instruction at specified address. The
+*                      address is masked to the program memory size, so an
+*                      address beyond the end wraps around to the start, like
+*                      the program counter of ATmega328P.
+*
+*                      - address: Address to instruction in program memory.
+********************************************************************************/
+uint32_t program_memory_read(const uint16_t address);
+
+/********************************************************************************
+* program_memory_patch: Replaces the instruction at specified address, for
+*                       instance with a breakpoint marker, and returns the
+*                       replaced instruction. The address is masked like
+*                       in program_memory_read.
+*
+*                       - address    : Address to instruction in program memory.
+*                       - instruction: The new instruction.
+********************************************************************************/
+uint32_t program_memory_patch(const uint16_t address,
+                              const uint32_t instruction);
+
+/********************************************************************************
+* program_memory_subroutine_name: Returns the name of the subroutine at
+*                                 specified address.
+*
+*                                 - address: Address within the subroutine.
+********************************************************************************/
+const char* program_memory_subroutine_name(const uint16_t address);
+
+/********************************************************************************
+* program_memory_symbol_count: Returns the number of entries in the symbol
+*                              table, including the entry for addresses
+*                              beyond the end of the program.
+********************************************************************************/
+size_t program_memory_symbol_count(void);
+
+/********************************************************************************
+* program_memory_symbol_index: Returns the index in the symbol table of the
+*                              subroutine at specified address. The symbol
+*                              is found by binary search for the last symbol
+*                              that starts at or before the address.
+*
+*                              - address: Address within the subroutine.
+********************************************************************************/
+size_t program_memory_symbol_index(const uint16_t address);
+
+/********************************************************************************
+* program_memory_symbol_name: Returns the name of the symbol at specified
+*                             index in the symbol table.
+*
+*                             - index: Index in the symbol table.
+********************************************************************************/
+const char* program_memory_symbol_name(const size_t index);
+
+/********************************************************************************
+* program_memory_symbol_address: Returns the start address of the symbol at
+*                                specified index in the symbol table.
+*
+*                                - index: Index in the symbol table.
+********************************************************************************/
+uint16_t program_memory_symbol_address(const size_t index);
+
 #endif /* PROGRAM_MEMORY_H_ */
\ No newline at end of file
@@ -0,0 +1,114 @@
+/********************************************************************************
+* ring_buffer.c: Contains function definitions for implementation of a
+*                lock-free single-producer/single-consumer ring buffer.
+********************************************************************************/
+#include "ring_buffer.h"
+#include <string.h>
+
+/********************************************************************************
+* ring_buffer_init: Allocates an empty ring buffer with at least specified
+*                   capacity, which is rounded up to a power of two. After
+*                   successful allocation, 0 is returned. If the allocation
+*                   failed, error code 1 is returned.
+*
+*                   - self    : Reference to the ring buffer.
+*                   - capacity: Minimum capacity in bytes.
+********************************************************************************/
+int ring_buffer_init(struct ring_buffer* self,
+                     const size_t capacity)
+{
+   size_t size = 1;
+   while (size < capacity) size <<= 1;
+
+   self->data = (uint8_t*)malloc(size);
+   self->capacity = self->data ? size : 0;
+   self->write_index = 0;
+   self->read_index = 0;
+   return self->data ? 0 : 1;
+}
+
+/********************************************************************************
+* ring_buffer_clear: Frees the memory allocated for specified ring buffer.
+*
+*                    - self: Reference to the ring buffer.
+********************************************************************************/
+void ring_buffer_clear(struct ring_buffer* self)
+{
+   free(self->data);
+   self->data = 0;
+   self->capacity = 0;
+   self->write_index = 0;
+   self->read_index = 0;
+   return;
+}
+
+/********************************************************************************
+* ring_buffer_write: Writes specified bytes to the ring buffer, unless there
+*                    isn't room for all of them. Returns 0 after successful
+*                    write. If there isn't room for all bytes, nothing is
+*                    written and error code 1 is returned, so that fixed-size
+*                    records are never split. Must only be called by the
+*                    producer.
+*
+*                    - self: Reference to the ring buffer.
+*                    - data: Reference to the bytes to write.
+*                    - size: The number of bytes to write.
+********************************************************************************/
+int ring_buffer_write(struct ring_buffer* self,
+                      const void* data,
+                      const size_t size)
+{
+   const size_t write_index = self->write_index;
+   const size_t read_index = host_atomic_load(&self->read_index);
+
+   if (self->capacity - (write_index - read_index) < size)
+   {
+      return 1;
+   }
+   else
+   {
+      const size_t offset = write_index & (self->capacity - 1);
+      const size_t first = size < self->capacity - offset ? size : self->capacity - offset;
+
+      memcpy(self->data + offset, data, first);
+      memcpy(self->data, (const uint8_t*)data + first, size - first);
+      host_atomic_store(&self->write_index, write_index + size);
+      return 0;
+   }
+}
+
+/********************************************************************************
+* ring_buffer_read: Reads up to specified number of bytes from the ring
+*                   buffer and returns the number of bytes read. Must only
+*                   be called by the consumer.
+*
+*                   - self    : Reference to the ring buffer.
+*                   - data    : Reference to storage for the read bytes.
+*                   - max_size: Max number of bytes to read.
+********************************************************************************/
+size_t ring_buffer_read(struct ring_buffer* self,
+                        void* data,
+                        const size_t max_size)
+{
+   const size_t read_index = self->read_index;
+   const size_t available = host_atomic_load(&self->write_index) - read_index;
+   const size_t size = available < max_size ? available : max_size;
+   const size_t offset = read_index & (self->capacity - 1);
+   const size_t first = size < self->capacity - offset ? size : self->capacity - offset;
+
+   memcpy(data, self->data + offset, first);
+   memcpy((uint8_t*)data + first, self->data, size - first);
+   host_atomic_store(&self->read_index, read_index + size);
+   return size;
+}
+
+/********************************************************************************
+* ring_buffer_used: Returns the number of bytes in the ring buffer that have
+*                   not been read yet.
+*
+*                   - self: Reference to the ring buffer.
+********************************************************************************/
+size_t ring_buffer_used(const struct ring_buffer* self)
+{
+   return host_atomic_load(&self->write_index) - host_atomic_load(&self->read_index);
+}
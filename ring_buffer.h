@@ -0,0 +1,84 @@
+/********************************************************************************
+* ring_buffer.h: Contains function declarations for implementation of a
+*                lock-free ring buffer for transfer of bytes from one producer
+*                thread to one consumer thread. The producer only writes the
+*                write index and the consumer only writes the read index, so
+*                no locks are needed as long as each side is a single thread.
+********************************************************************************/
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "host.h"
+
+/********************************************************************************
+* ring_buffer: Structure for a single-producer/single-consumer ring buffer.
+*              The indexes are increased without wrapping and masked on
+*              access, hence the capacity must be a power of two.
+********************************************************************************/
+struct ring_buffer
+{
+   uint8_t* data;                /* Buffer storage. */
+   size_t capacity;              /* Capacity in bytes, always a power of two. */
+   volatile size_t write_index;  /* Total number of bytes written, updated by the producer. */
+   volatile size_t read_index;   /* Total number of bytes read, updated by the consumer. */
+};
+
+/********************************************************************************
+* ring_buffer_init: Allocates an empty ring buffer with at least specified
+*                   capacity, which is rounded up to a power of two. After
+*                   successful allocation, 0 is returned. If the allocation
+*                   failed, error code 1 is returned.
+*
+*                   - self    : Reference to the ring buffer.
+*                   - capacity: Minimum capacity in bytes.
+********************************************************************************/
+int ring_buffer_init(struct ring_buffer* self,
+                     const size_t capacity);
+
+/********************************************************************************
+* ring_buffer_clear: Frees the memory allocated for specified ring buffer.
+*
+*                    - self: Reference to the ring buffer.
+********************************************************************************/
+void ring_buffer_clear(struct ring_buffer* self);
+
+/********************************************************************************
+* ring_buffer_write: Writes specified bytes to the ring buffer, unless there
+*                    isn't room for all of them. Returns 0 after successful
+*                    write. If there isn't room for all bytes, nothing is
+*                    written and error code 1 is returned, so that fixed-size
+*                    records are never split. Must only be called by the
+*                    producer.
+*
+*                    - self: Reference to the ring buffer.
+*                    - data: Reference to the bytes to write.
+*                    - size: The number of bytes to write.
+********************************************************************************/
+int ring_buffer_write(struct ring_buffer* self,
+                      const void* data,
+                      const size_t size);
+
+/********************************************************************************
+* ring_buffer_read: Reads up to specified number of bytes from the ring
+*                   buffer and returns the number of bytes read. Must only
+*                   be called by the consumer.
+*
+*                   - self    : Reference to the ring buffer.
+*                   - data    : Reference to storage for the read bytes.
+*                   - max_size: Max number of bytes to read.
+********************************************************************************/
+size_t ring_buffer_read(struct ring_buffer* self,
+                        void* data,
+                        const size_t max_size);
+
+/********************************************************************************
+* ring_buffer_used: Returns the number of bytes in the ring buffer that have
+*                   not been read yet.
+*
+*                   - self: Reference to the ring buffer.
+********************************************************************************/
+size_t ring_buffer_used(const struct ring_buffer* self);
+
+#endif /* RING_BUFFER_H_ */
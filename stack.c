@@ -1,105 +1,158 @@
-/********************************************************************************
-* stack.c: Contains functions definition for implementation of a 1 kB stack.
-********************************************************************************/
-#include "stack.h"
-
-/* Static variables: */
-static uint8_t stack[STACK_ADDRESS_WIDTH]; /* 1 kB stack (1024 addresses 0 - 1023). */
-static uint16_t sp;                        /* Stack pointer, points to last added element. */
-static bool stack_empty;                   /* Indicates if the stack is empty. */
-
-/********************************************************************************
-* stack_reset: Clears content of the entire stack och sets the stack pointer
-*              to the top of the stack.
-********************************************************************************/
-void stack_reset(void)
-{
-   for (uint16_t i = 0; i < STACK_ADDRESS_WIDTH; ++i)
-   {
-      stack[i] = 0x00;
-   }
-
-   sp = STACK_ADDRESS_WIDTH - 1;
-   stack_empty = true;
-   return;
-}
-
-/********************************************************************************
-* stack_push: Pushes value to the stack, unless it's full. Success code 0 is
-*             returned after successful push and the stack pointer is
-*             decremented unless the stack was empty before the push.
-*             If the stack is full, no push is performed and error code 1
-*             is returned.
-*
-*             - value: 8 bit value to push to the stack.
-********************************************************************************/
-int stack_push(const uint8_t value)
-{
-   if (sp == 0)
-   {
-      return 1;
-   }
-   else
-   {
-      if (stack_empty)
-      {
-         stack[sp] = value;
-         stack_empty = false;
-      }
-      else
-      {
-         stack[--sp] = value;
-      }
-      return 0;
-   }
-}
-
-/********************************************************************************
-* stack_pop: Returns value popped from the stack. If the stack is empty,
-*            the value 0x00 is returned. The stack pointer is incremeneted
-*            after successful pop, unless the stack pointer is already
-*            pointing to the top of the stack.
-********************************************************************************/
-uint8_t stack_pop(void)
-{
-   if (stack_empty)
-   {
-      return 0x00;
-   }
-   else
-   {
-      if (sp < STACK_ADDRESS_WIDTH - 1)
-      {
-         return stack[sp++];
-      }
-      else
-      {
-         stack_empty = true;
-         return stack[sp];
-      }
-   }
-}
-
-/********************************************************************************
-* stack_pointer: Returns the address of the stack pointer.
-********************************************************************************/
-uint16_t stack_pointer(void)
-{
-   return sp;
-}
-
-/********************************************************************************
-* stack_last_added_value: Returns the last added value of the stack. If the
-*                         stack is empty, the value 0x00 is returned.
-********************************************************************************/
-uint8_t stack_last_added_value(void)
-{
-   if (stack_empty)
-   {
-      return 0x00;
-   }
-   else
-   {
-      return stack[sp];
-   }
-}
\ No newline at end of file
+/********************************************************************************
+* stack.c: Contains functions definition for implementation of a stack
+*          located at the top of data memory. The push and pop operations
+*          are defined inline in stack.h.
+********************************************************************************/
+#include "stack.h"
+
+/* Global variables: */
+uint16_t stack_low_mark; /* Lowest address written in the current frame. */
+
+/* Static variables: */
+static stack_trap_handler trap_handler; /* Function called on stack faults, or null. */
+static uint16_t lowest_address;         /* Lowest address written in frames that have been left. */
+
+/* Static functions: */
+static void stack_trap(const enum stack_fault fault,
+                       const uint16_t sp);
+
+/********************************************************************************
+* stack_reset: Sets the stack pointer to the top of the stack. The stack
+*              content is cleared along with the rest of data memory, hence
+*              data memory must be reset before the stack.
+********************************************************************************/
+void stack_reset(void)
+{
+   stack_set_pointer(STACK_TOP);
+   stack_low_mark = STACK_TOP + 1;
+   lowest_address = STACK_TOP + 1;
+   return;
+}
+
+/********************************************************************************
+* stack_last_added_value: Returns the last added value of the stack. If the
+*                         stack is empty, the value 0x00 is returned.
+********************************************************************************/
+uint8_t stack_last_added_value(void)
+{
+   const uint16_t sp = stack_pointer() + 1;
+
+   if ((uint16_t)(sp - STACK_BOTTOM) > STACK_TOP - STACK_BOTTOM)
+   {
+      return 0x00;
+   }
+   else
+   {
+      return data_memory_content[sp];
+   }
+}
+
+/********************************************************************************
+* stack_high_water_mark: Returns the max number of bytes used on the stack
+*                        since reset, measured from the top of the stack.
+********************************************************************************/
+uint16_t stack_high_water_mark(void)
+{
+   const uint16_t lowest = stack_low_mark < lowest_address ? stack_low_mark : lowest_address;
+   return STACK_TOP + 1 - lowest;
+}
+
+/********************************************************************************
+* stack_enter_frame: Starts tracking of the stack usage of a new frame, for
+*                    instance a called subroutine, and returns the low mark
+*                    of the enclosing frame, which must be passed to
+*                    stack_leave_frame when the frame is left.
+********************************************************************************/
+uint16_t stack_enter_frame(void)
+{
+   const uint16_t saved_low_mark = stack_low_mark;
+   if (saved_low_mark < lowest_address) lowest_address = saved_low_mark;
+   stack_low_mark = stack_pointer() + 1;
+   return saved_low_mark;
+}
+
+/********************************************************************************
+* stack_leave_frame: Ends tracking of the current frame and returns the lowest
+*                    address written while the frame was active. The low mark
+*                    of the enclosing frame is restored, including the usage
+*                    of the frame that was left.
+*
+*                    - saved_low_mark: Value returned by stack_enter_frame.
+********************************************************************************/
+uint16_t stack_leave_frame(const uint16_t saved_low_mark)
+{
+   const uint16_t frame_low_mark = stack_low_mark;
+   if (frame_low_mark < lowest_address) lowest_address = frame_low_mark;
+   stack_low_mark = frame_low_mark < saved_low_mark ? frame_low_mark : saved_low_mark;
+   return frame_low_mark;
+}
+
+/********************************************************************************
+* stack_set_trap_handler: Sets the function to call on stack faults. A null
+*                         pointer disables the callback.
+*
+*                         - handler: The function to call on stack faults.
+********************************************************************************/
+void stack_set_trap_handler(stack_trap_handler handler)
+{
+   trap_handler = handler;
+   return;
+}
+
+/********************************************************************************
+* stack_push_slow: Pushes value to the stack via data_memory_write, so that
+*                  watchpoints on the stack area are hit, or reports an
+*                  overflow if the stack pointer is outside the stack area.
+*                  Only called from the cold path of stack_push, with the
+*                  same return values.
+*
+*                  - value: 8 bit value to push to the stack.
+********************************************************************************/
+int stack_push_slow(const uint8_t value)
+{
+   const uint16_t sp = stack_pointer();
+   if ((uint16_t)(sp - STACK_BOTTOM) > STACK_TOP - STACK_BOTTOM)
+   {
+      stack_trap(STACK_FAULT_OVERFLOW, sp);
+      return 1;
+   }
+
+   if (sp < stack_low_mark) stack_low_mark = sp;
+   data_memory_write(sp, value);
+   stack_set_pointer(sp - 1);
+   return 0;
+}
+
+/********************************************************************************
+* stack_pop_slow: Pops a value from the stack via data_memory_read, so that
+*                 watchpoints on the stack area are hit, or reports an
+*                 underflow if the stack is empty or the stack pointer is
+*                 outside the stack area. Only called from the cold path of
+*                 stack_pop, with the same return values.
+********************************************************************************/
+uint8_t stack_pop_slow(void)
+{
+   const uint16_t sp = stack_pointer() + 1;
+   if ((uint16_t)(sp - STACK_BOTTOM) > STACK_TOP - STACK_BOTTOM)
+   {
+      stack_trap(STACK_FAULT_UNDERFLOW, sp - 1);
+      return 0x00;
+   }
+
+   stack_set_pointer(sp);
+   return data_memory_read(sp);
+}
+
+/********************************************************************************
+* stack_trap: Reports specified fault to the trap handler. Only called from
+*             the failure path of the stack operations.
+*
+*             - fault: The detected fault.
+*             - sp   : The stack pointer at the time of the fault.
+********************************************************************************/
+static void stack_trap(const enum stack_fault fault,
+                       const uint16_t sp)
+{
+   if (trap_handler) trap_handler(fault, sp);
+   return;
+}
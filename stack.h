@@ -1,51 +1,192 @@
-/********************************************************************************
-* stack.h: Contains function declarations and macro definitions for 
-*          implementation of 1 kB stack.
-********************************************************************************/
-#ifndef STACK_H_
-#define STACK_H_
-
-/* Include directives: */
-#include "cpu.h"
-
-/* Macro definitions: */
-#define STACK_ADDRESS_WIDTH 1024 /* 1024 unique addresses on the stack. */
-#define STACK_DATA_WIDTH    8    /* 8 bit storage capacity per address. */
-
-/********************************************************************************
-* stack_reset: Clears content of the entire stack och sets the stack pointer
-*              to the top of the stack.
-********************************************************************************/
-void stack_reset(void);
-
-/********************************************************************************
-* stack_push: Pushes value to the stack, unless it's full. Success code 0 is
-*             returned after successful push and the stack pointer is 
-*             decremented unless the stack was empty before the push. 
-*             If the stack is full, no push is performed and error code 1 
-*             is returned.
-* 
-*             - value: 8 bit value to push to the stack.
-********************************************************************************/
-int stack_push(const uint8_t value);
-
-/********************************************************************************
-* stack_pop: Returns value popped from the stack. If the stack is empty,
-*            the value 0x00 is returned. The stack pointer is incremeneted
-*            after successful pop, unless the stack pointer is already 
-*            pointing to the top of the stack.
-********************************************************************************/
-uint8_t stack_pop(void);
-
-/********************************************************************************
-* stack_pointer: Returns the address of the stack pointer.
-********************************************************************************/
-uint16_t stack_pointer(void);
-
-/********************************************************************************
-* stack_last_added_value: Returns the last added value of the stack. If the
-*                         stack is empty, the value 0x00 is returned.
-********************************************************************************/
-uint8_t stack_last_added_value(void);
-
-#endif /* STACK_H_ */
\ No newline at end of file
+/********************************************************************************
+* stack.h: Contains function declarations and macro definitions for
+*          implementation of a stack located at the top of data memory.
+*          As on ATmega328P, the stack pointer is stored in the I/O registers
+*          SPL and SPH, so firmware can read and relocate it. The stack
+*          pointer points to the next free location, hence a push stores the
+*          value and then decrements the stack pointer, while a pop first
+*          increments the stack pointer and then loads the value. The stack
+*          operations are defined inline, since they are executed on every
+*          PUSH, POP, CALL and RET.
+********************************************************************************/
+#ifndef STACK_H_
+#define STACK_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "data_memory.h"
+
+/* Macro definitions: */
+#define STACK_TOP        (DATA_MEMORY_ADDRESS_WIDTH - 1) /* Initial stack pointer (end of data memory). */
+#define STACK_BOTTOM     IO_REGISTER_ADDRESS_WIDTH       /* Lowest address usable by the stack. */
+#define STACK_DATA_WIDTH 8                               /* 8 bit storage capacity per address. */
+
+/********************************************************************************
+* stack_low_mark: Lowest address written by a push since reset or since the
+*                 current stack frame was entered (see stack_enter_frame).
+*                 Updated by the inline push, hence exposed.
+********************************************************************************/
+extern uint16_t stack_low_mark;
+
+/********************************************************************************
+* stack_fault: Enumeration for the faults detected by the stack operations.
+********************************************************************************/
+enum stack_fault
+{
+   STACK_FAULT_OVERFLOW, /* Push with the stack pointer below the stack area. */
+   STACK_FAULT_UNDERFLOW /* Pop from an empty stack or with the stack pointer above the stack area. */
+};
+
+/********************************************************************************
+* stack_trap_policy: Enumeration for the actions taken on a stack fault.
+********************************************************************************/
+enum stack_trap_policy
+{
+   STACK_TRAP_IGNORE,    /* The failed operation is ignored (pop returns 0x00). */
+   STACK_TRAP_HALT,      /* The CPU is halted after the current instruction. */
+   STACK_TRAP_EXCEPTION, /* A simulator exception with full context is raised. */
+   STACK_TRAP_RESET      /* The system is reset after the current instruction. */
+};
+
+/********************************************************************************
+* stack_trap_handler: Function called when a stack fault is detected.
+*
+*                     - fault: The detected fault.
+*                     - sp   : The stack pointer at the time of the fault.
+********************************************************************************/
+typedef void (*stack_trap_handler)(const enum stack_fault fault,
+                                   const uint16_t sp);
+
+/********************************************************************************
+* stack_reset: Sets the stack pointer to the top of the stack. The stack
+*              content is cleared along with the rest of data memory, hence
+*              data memory must be reset before the stack.
+********************************************************************************/
+void stack_reset(void);
+
+/********************************************************************************
+* stack_last_added_value: Returns the last added value of the stack. If the
+*                         stack is empty, the value 0x00 is returned.
+********************************************************************************/
+uint8_t stack_last_added_value(void);
+
+/********************************************************************************
+* stack_high_water_mark: Returns the max number of bytes used on the stack
+*                        since reset, measured from the top of the stack.
+********************************************************************************/
+uint16_t stack_high_water_mark(void);
+
+/********************************************************************************
+* stack_enter_frame: Starts tracking of the stack usage of a new frame, for
+*                    instance a called subroutine, and returns the low mark
+*                    of the enclosing frame, which must be passed to
+*                    stack_leave_frame when the frame is left.
+********************************************************************************/
+uint16_t stack_enter_frame(void);
+
+/********************************************************************************
+* stack_leave_frame: Ends tracking of the current frame and returns the lowest
+*                    address written while the frame was active. The low mark
+*                    of the enclosing frame is restored, including the usage
+*                    of the frame that was left.
+*
+*                    - saved_low_mark: Value returned by stack_enter_frame.
+********************************************************************************/
+uint16_t stack_leave_frame(const uint16_t saved_low_mark);
+
+/********************************************************************************
+* stack_set_trap_handler: Sets the function to call on stack faults. A null
+*                         pointer disables the callback.
+*
+*                         - handler: The function to call on stack faults.
+********************************************************************************/
+void stack_set_trap_handler(stack_trap_handler handler);
+
+/********************************************************************************
+* stack_push_slow: Pushes value to the stack via data_memory_write, so that
+*                  watchpoints on the stack area are hit, or reports an
+*                  overflow if the stack pointer is outside the stack area.
+*                  Only called from the cold path of stack_push, with the
+*                  same return values.
+*
+*                  - value: 8 bit value to push to the stack.
+********************************************************************************/
+int stack_push_slow(const uint8_t value);
+
+/********************************************************************************
+* stack_pop_slow: Pops a value from the stack via data_memory_read, so that
+*                 watchpoints on the stack area are hit, or reports an
+*                 underflow if the stack is empty or the stack pointer is
+*                 outside the stack area. Only called from the cold path of
+*                 stack_pop, with the same return values.
+********************************************************************************/
+uint8_t stack_pop_slow(void);
+
+/********************************************************************************
+* stack_pointer: Returns the address of the stack pointer, which is read
+*                from the I/O registers SPL and SPH.
+********************************************************************************/
+static inline uint16_t stack_pointer(void)
+{
+   return (data_memory_content[SPH] << 8) | data_memory_content[SPL];
+}
+
+/********************************************************************************
+* stack_set_pointer: Stores specified address in the I/O registers SPL and SPH.
+*
+*                    - sp: The new address of the stack pointer.
+********************************************************************************/
+static inline void stack_set_pointer(const uint16_t sp)
+{
+   data_memory_content[SPL] = low(sp);
+   data_memory_content[SPH] = high(sp);
+   return;
+}
+
+/********************************************************************************
+* stack_push: Pushes value to the stack, unless it's full. Success code 0 is
+*             returned after successful push. If the stack pointer is outside
+*             the stack area, no push is performed, the overflow is reported
+*             to the trap handler and error code 1 is returned. Both bounds
+*             are checked by a single unsigned compare, and pushes to a page
+*             with write watches take the same cold path, see
+*             stack_push_slow. The low mark used for the high water mark
+*             costs one more compare.
+*
+*             - value: 8 bit value to push to the stack.
+********************************************************************************/
+static inline int stack_push(const uint8_t value)
+{
+   const uint16_t sp = stack_pointer();
+   if ((uint16_t)(sp - STACK_BOTTOM) > STACK_TOP - STACK_BOTTOM || !data_memory_plain_write(sp))
+   {
+      return stack_push_slow(value);
+   }
+
+   if (sp < stack_low_mark) stack_low_mark = sp;
+   data_memory_content[sp] = value;
+   stack_set_pointer(sp - 1);
+   return 0;
+}
+
+/********************************************************************************
+* stack_pop: Returns value popped from the stack. If the stack is empty,
+*            or the stack pointer is outside the stack area, the underflow is
+*            reported to the trap handler, the value 0x00 is returned and the
+*            stack pointer is left unchanged. Both bounds are checked by a
+*            single unsigned compare, and pops from a page with read watches
+*            take the same cold path, see stack_pop_slow.
+********************************************************************************/
+static inline uint8_t stack_pop(void)
+{
+   const uint16_t sp = stack_pointer() + 1;
+   if ((uint16_t)(sp - STACK_BOTTOM) > STACK_TOP - STACK_BOTTOM || !data_memory_plain_read(sp))
+   {
+      return stack_pop_slow();
+   }
+
+   stack_set_pointer(sp);
+   return data_memory_content[sp];
+}
+
+#endif /* STACK_H_ */
@@ -0,0 +1,250 @@
+/********************************************************************************
+* state_delta.c: Contains static variables and function definitions for the
+*                differential display of the processor state. The watch set
+*                is kept as bitmaps, so that a display only compares the
+*                selected locations against the snapshot.
+********************************************************************************/
+#include "state_delta.h"
+#include <string.h>
+
+/* Macro definitions: */
+#define STATE_DELTA_BUFFER_SIZE 65536 /* Size of the display buffer, fits every location changed. */
+
+/********************************************************************************
+* state_delta_snapshot: Structure for the compared part of the processor
+*                       state at the previous display.
+********************************************************************************/
+struct state_delta_snapshot
+{
+   uint8_t reg[CPU_REGISTER_ADDRESS_WIDTH];       /* CPU registers R0 - R31. */
+   uint8_t sr;                                    /* Status register. */
+   uint16_t sp;                                   /* Stack pointer. */
+   uint8_t memory[DATA_MEMORY_ADDRESS_WIDTH];     /* Data memory, including I/O and stack. */
+};
+
+/********************************************************************************
+* io_names: Names of the I/O registers, indexed by I/O address. Unnamed
+*           locations are printed by their address.
+********************************************************************************/
+static const char* io_names[IO_REGISTER_ADDRESS_WIDTH] =
+{
+   [DDRB]   = "DDRB",   [PORTB]  = "PORTB",  [PINB]   = "PINB",   [DDRC]   = "DDRC",
+   [PORTC]  = "PORTC",  [PINC]   = "PINC",   [DDRD]   = "DDRD",   [PORTD]  = "PORTD",
+   [PIND]   = "PIND",   [PCICR]  = "PCICR",  [PCIFR]  = "PCIFR",  [PCMSK0] = "PCMSK0",
+   [PCMSK1] = "PCMSK1", [PCMSK2] = "PCMSK2", [TCCR0A] = "TCCR0A", [TCCR0B] = "TCCR0B",
+   [TCNT0]  = "TCNT0",  [OCR0A]  = "OCR0A",  [TIMSK0] = "TIMSK0", [TIFR0]  = "TIFR0",
+   [TCCR1B] = "TCCR1B", [TCNT1L] = "TCNT1L", [TCNT1H] = "TCNT1H", [OCR1AL] = "OCR1AL",
+   [OCR1AH] = "OCR1AH", [TIMSK1] = "TIMSK1", [TIFR1]  = "TIFR1",  [UDR0]   = "UDR0",
+   [UCSR0A] = "UCSR0A", [UCSR0B] = "UCSR0B", [UBRR0L] = "UBRR0L", [UBRR0H] = "UBRR0H",
+   [SPL]    = "SPL",    [SPH]    = "SPH"
+};
+
+/* Static variables: */
+static struct state_delta_snapshot previous;                           /* State at the previous display. */
+static uint32_t watched_registers = (1UL << R16) | (1UL << R17) | (1UL << R18) | (1UL << R24) |
+   (1UL << XL) | (1UL << XH) | (1UL << YL) | (1UL << YH) | (1UL << ZL) | (1UL << ZH);
+static uint8_t watched_io[IO_REGISTER_ADDRESS_WIDTH / 8] =             /* One bit per I/O address. */
+   { (1 << DDRB) | (1 << PORTB) | (1 << PINB) };
+static bool watched_stack = true;                                      /* Indicates if the stack is watched. */
+
+/* Static functions: */
+static void append_change(struct text_buffer* text,
+                          const char* name,
+                          const uint16_t address,
+                          const uint8_t old_value,
+                          const uint8_t new_value,
+                          size_t* num_changes);
+
+/********************************************************************************
+* state_delta_watch_register: Adds or removes specified CPU register in the
+*                             watch set.
+*
+*                             - reg  : The CPU register, R0 - R31.
+*                             - watch: Indicates if the register is watched.
+********************************************************************************/
+void state_delta_watch_register(const uint8_t reg,
+                                const bool watch)
+{
+   if (reg >= CPU_REGISTER_ADDRESS_WIDTH) return;
+   if (watch) watched_registers |= 1UL << reg;
+   else watched_registers &= ~(1UL << reg);
+   return;
+}
+
+/********************************************************************************
+* state_delta_watch_io: Adds or removes specified I/O location in the watch
+*                       set.
+*
+*                       - address: The I/O address, 0 - 255.
+*                       - watch  : Indicates if the location is watched.
+********************************************************************************/
+void state_delta_watch_io(const uint8_t address,
+                          const bool watch)
+{
+   if (watch) watched_io[address / 8] |= (uint8_t)(1 << (address % 8));
+   else watched_io[address / 8] &= (uint8_t)~(1 << (address % 8));
+   return;
+}
+
+/********************************************************************************
+* state_delta_watch_stack: Sets if the used part of the stack, i.e. the bytes
+*                          above the stack pointer, is watched.
+*
+*                          - watch: Indicates if the stack is watched.
+********************************************************************************/
+void state_delta_watch_stack(const bool watch)
+{
+   watched_stack = watch;
+   return;
+}
+
+/********************************************************************************
+* state_delta_watch_all: Adds all CPU registers and I/O locations and the
+*                        stack to the watch set, or removes all of them.
+*
+*                        - watch: Indicates if everything is watched.
+********************************************************************************/
+void state_delta_watch_all(const bool watch)
+{
+   watched_registers = watch ? 0xFFFFFFFFUL : 0;
+   memset(watched_io, watch ? 0xFF : 0, sizeof(watched_io));
+   watched_stack = watch;
+   return;
+}
+
+/********************************************************************************
+* state_delta_update: Takes a snapshot of the current state, which the next
+*                     display is compared against, without printing.
+********************************************************************************/
+void state_delta_update(void)
+{
+   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; ++i)
+   {
+      previous.reg[i] = control_unit_register(i);
+   }
+
+   previous.sr = control_unit_status_register();
+   previous.sp = stack_pointer();
+   memcpy(previous.memory, data_memory_content, sizeof(previous.memory));
+   return;
+}
+
+/********************************************************************************
+* state_delta_print: Prints the clock cycle, program counter and every
+*                    watched location that changed since the previous
+*                    display or update and takes a new snapshot. Stack bytes
+*                    are compared between the stack pointer and the top of
+*                    the stack, data memory is read without I/O hooks.
+********************************************************************************/
+void state_delta_print(void)
+{
+   static char storage[STATE_DELTA_BUFFER_SIZE]; /* Too large for the stack. */
+   struct text_buffer text;
+   const uint16_t pc = control_unit_program_counter();
+   const uint8_t sr = control_unit_status_register();
+   const uint16_t sp = stack_pointer();
+   size_t num_changes = 0;
+
+   text_buffer_init(&text, storage, sizeof(storage));
+   text_buffer_append(&text, "Cycle ");
+   text_buffer_append_unsigned(&text, control_unit_cycle_count());
+   text_buffer_append(&text, ", PC ");
+   text_buffer_append_unsigned(&text, pc);
+   text_buffer_append(&text, " (");
+   text_buffer_append(&text, program_memory_subroutine_name(pc));
+   text_buffer_append(&text, "):");
+
+   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; ++i)
+   {
+      const uint8_t value = control_unit_register(i);
+
+      if (((watched_registers >> i) & 1) && value != previous.reg[i])
+      {
+         text_buffer_append(&text, num_changes++ ? ", R" : " R");
+         text_buffer_append_unsigned(&text, i);
+         text_buffer_append(&text, " 0x");
+         text_buffer_append_hex(&text, previous.reg[i], 2);
+         text_buffer_append(&text, " -> 0x");
+         text_buffer_append_hex(&text, value, 2);
+      }
+   }
+
+   if (sr != previous.sr)
+   {
+      text_buffer_append(&text, num_changes++ ? ", SR " : " SR ");
+      text_buffer_append_binary(&text, previous.sr, 6);
+      text_buffer_append(&text, " -> ");
+      text_buffer_append_binary(&text, sr, 6);
+   }
+
+   for (uint16_t i = 0; i < IO_REGISTER_ADDRESS_WIDTH; ++i)
+   {
+      if (((watched_io[i / 8] >> (i % 8)) & 1) && data_memory_content[i] != previous.memory[i] &&
+          i != SPL && i != SPH) /* The stack pointer is printed as a whole below. */
+      {
+         append_change(&text, io_names[i], i, previous.memory[i], data_memory_content[i], &num_changes);
+      }
+   }
+
+   if (sp != previous.sp)
+   {
+      text_buffer_append(&text, num_changes++ ? ", SP " : " SP ");
+      text_buffer_append_unsigned(&text, previous.sp);
+      text_buffer_append(&text, " -> ");
+      text_buffer_append_unsigned(&text, sp);
+   }
+
+   if (watched_stack)
+   {
+      for (uint32_t i = (uint32_t)sp + 1; i <= STACK_TOP && i < DATA_MEMORY_ADDRESS_WIDTH; ++i)
+      {
+         if (data_memory_content[i] != previous.memory[i])
+         {
+            append_change(&text, 0, (uint16_t)i, previous.memory[i], data_memory_content[i], &num_changes);
+         }
+      }
+   }
+
+   text_buffer_append(&text, num_changes ? "\n" : " no changes\n");
+   text_buffer_write(&text, stdout);
+   state_delta_update();
+   return;
+}
+
+/********************************************************************************
+* append_change: Appends a changed data memory location, printed by name if
+*                it has one and by address in brackets otherwise.
+*
+*                - text       : Reference to the text buffer.
+*                - name       : The name of the location, or null.
+*                - address    : The data memory address.
+*                - old_value  : The value at the previous display.
+*                - new_value  : The current value.
+*                - num_changes: Reference to the number of changes printed.
+********************************************************************************/
+static void append_change(struct text_buffer* text,
+                          const char* name,
+                          const uint16_t address,
+                          const uint8_t old_value,
+                          const uint8_t new_value,
+                          size_t* num_changes)
+{
+   text_buffer_append(text, (*num_changes)++ ? ", " : " ");
+
+   if (name)
+   {
+      text_buffer_append(text, name);
+   }
+   else
+   {
+      text_buffer_append_char(text, '[');
+      text_buffer_append_unsigned(text, address);
+      text_buffer_append_char(text, ']');
+   }
+
+   text_buffer_append(text, " 0x");
+   text_buffer_append_hex(text, old_value, 2);
+   text_buffer_append(text, " -> 0x");
+   text_buffer_append_hex(text, new_value, 2);
+   return;
+}
@@ -0,0 +1,73 @@
+/********************************************************************************
+* state_delta.h: Contains function declarations for a differential display of
+*                the processor state. Instead of the fixed block printed by
+*                control_unit_print, only the watched CPU registers, I/O
+*                locations and stack bytes that changed since the previous
+*                display are printed, on a single line per display, which
+*                keeps logs of long stepping sessions short.
+*
+*                The watch set initially holds the locations shown by
+*                control_unit_print, i.e. R16 - R18, R24, the X, Y and Z
+*                pointer registers, DDRB, PORTB, PINB and the stack. The
+*                status register and stack pointer are always compared.
+********************************************************************************/
+#ifndef STATE_DELTA_H_
+#define STATE_DELTA_H_
+
+/* Include directives: */
+#include "control_unit.h"
+
+/********************************************************************************
+* state_delta_watch_register: Adds or removes specified CPU register in the
+*                             watch set.
+*
+*                             - reg  : The CPU register, R0 - R31.
+*                             - watch: Indicates if the register is watched.
+********************************************************************************/
+void state_delta_watch_register(const uint8_t reg,
+                                const bool watch);
+
+/********************************************************************************
+* state_delta_watch_io: Adds or removes specified I/O location in the watch
+*                       set.
+*
+*                       - address: The I/O address, 0 - 255.
+*                       - watch  : Indicates if the location is watched.
+********************************************************************************/
+void state_delta_watch_io(const uint8_t address,
+                          const bool watch);
+
+/********************************************************************************
+* state_delta_watch_stack: Sets if the used part of the stack, i.e. the bytes
+*                          above the stack pointer, is watched.
+*
+*                          - watch: Indicates if the stack is watched.
+********************************************************************************/
+void state_delta_watch_stack(const bool watch);
+
+/********************************************************************************
+* state_delta_watch_all: Adds all CPU registers and I/O locations and the
+*                        stack to the watch set, or removes all of them.
+*
+*                        - watch: Indicates if everything is watched.
+********************************************************************************/
+void state_delta_watch_all(const bool watch);
+
+/********************************************************************************
+* state_delta_update: Takes a snapshot of the current state, which the next
+*                     display is compared against, without printing.
+********************************************************************************/
+void state_delta_update(void);
+
+/********************************************************************************
+* state_delta_print: Prints the clock cycle, program counter and every
+*                    watched location that changed since the previous
+*                    display or update, for instance
+*
+*                    "Cycle 42, PC 28 (main): R16 0x00 -> 0x01, ..."
+*
+*                    and takes a new snapshot.
+********************************************************************************/
+void state_delta_print(void);
+
+#endif /* STATE_DELTA_H_ */
@@ -0,0 +1,299 @@
+/********************************************************************************
+* state_export.c: Contains static variables and function definitions for
+*                 export of the processor state and run statistics as JSON
+*                 lines or CSV.
+********************************************************************************/
+#include "state_export.h"
+#include <string.h>
+
+/* Macro definitions: */
+#define STATE_EXPORT_BUFFER_SIZE 32768 /* Fits a record with all of data memory exported. */
+
+/********************************************************************************
+* state_export_range: Structure for an exported range of data memory.
+********************************************************************************/
+struct state_export_range
+{
+   uint16_t first; /* First address of the range. */
+   uint16_t last;  /* Last address of the range. */
+};
+
+/* Static variables: */
+static FILE* output = 0;                                          /* The export file. */
+static enum state_export_format record_format;                    /* The export format. */
+static struct state_export_range ranges[STATE_EXPORT_MAX_RANGES]; /* Exported data memory ranges. */
+static size_t num_ranges;                                         /* Number of exported ranges. */
+static size_t num_range_bytes;                                    /* Total size of the ranges. */
+static uint64_t open_time_ns;                                     /* Host time the export was opened. */
+static char storage[STATE_EXPORT_BUFFER_SIZE];                    /* Buffer records are formatted in. */
+
+/* Static functions: */
+static void write_header(struct text_buffer* text);
+static void write_json(struct text_buffer* text);
+static void write_csv(struct text_buffer* text);
+static inline bool exported_opcode(const uint8_t op_code);
+
+/********************************************************************************
+* state_export_add_range: Adds a range of data memory addresses to export.
+*                         Ranges must be added before the export is opened,
+*                         since they determine the CSV columns. After
+*                         success, 0 is returned. If the range is invalid,
+*                         the export is already open or too many ranges were
+*                         added, error code 1 is returned.
+*
+*                         - first: First data memory address of the range.
+*                         - last : Last data memory address of the range.
+********************************************************************************/
+int state_export_add_range(const uint16_t first,
+                           const uint16_t last)
+{
+   if (output || num_ranges == STATE_EXPORT_MAX_RANGES) return 1;
+   if (first > last || last >= DATA_MEMORY_ADDRESS_WIDTH) return 1;
+   if (num_range_bytes + (last - first + 1) > DATA_MEMORY_ADDRESS_WIDTH) return 1;
+
+   ranges[num_ranges].first = first;
+   ranges[num_ranges].last = last;
+   num_ranges++;
+   num_range_bytes += last - first + 1;
+   return 0;
+}
+
+/********************************************************************************
+* state_export_open: Opens specified file for export in specified format and
+*                    writes the CSV header. When exporting to stdout, all
+*                    other output to stdout goes to stderr instead, so that
+*                    stdout carries the records only. After success, 0 is
+*                    returned. If the file couldn't be opened, error code 1
+*                    is returned.
+*
+*                    - path  : Path to the file, or "-" for stdout.
+*                    - format: The export format.
+********************************************************************************/
+int state_export_open(const char* path,
+                      const enum state_export_format format)
+{
+   struct text_buffer text;
+
+   state_export_close();
+   output = strcmp(path, "-") ? fopen(path, "w") : host_take_stdout();
+   if (!output) return 1;
+
+   record_format = format;
+   open_time_ns = host_time_ns();
+
+   if (record_format == STATE_EXPORT_CSV)
+   {
+      text_buffer_init(&text, storage, sizeof(storage));
+      write_header(&text);
+      text_buffer_write(&text, output);
+   }
+   return 0;
+}
+
+/********************************************************************************
+* state_export_write: Writes a record of the current state and statistics,
+*                     unless the export isn't open.
+********************************************************************************/
+void state_export_write(void)
+{
+   struct text_buffer text;
+   if (!output) return;
+
+   text_buffer_init(&text, storage, sizeof(storage));
+   if (record_format == STATE_EXPORT_JSON) write_json(&text);
+   else write_csv(&text);
+   text_buffer_write(&text, output);
+   fflush(output);
+   return;
+}
+
+/********************************************************************************
+* state_export_close: Closes the export file.
+********************************************************************************/
+void state_export_close(void)
+{
+   if (output) fclose(output);
+   output = 0;
+   return;
+}
+
+/********************************************************************************
+* state_export_is_open: Indicates if the export is open.
+********************************************************************************/
+bool state_export_is_open(void)
+{
+   return output != 0;
+}
+
+/********************************************************************************
+* write_header: Formats the CSV header row, the column names follow the JSON
+*               keys with one column per register, address and OP code.
+*
+*               - text: Reference to the text buffer.
+********************************************************************************/
+static void write_header(struct text_buffer* text)
+{
+   text_buffer_append(text, "cycles,instructions,pc,sr,sp");
+
+   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; ++i)
+   {
+      text_buffer_append(text, ",r");
+      text_buffer_append_unsigned(text, i);
+   }
+
+   for (size_t i = 0; i < num_ranges; ++i)
+   {
+      for (uint32_t address = ranges[i].first; address <= ranges[i].last; ++address)
+      {
+         text_buffer_append(text, ",mem");
+         text_buffer_append_unsigned(text, address);
+      }
+   }
+
+   text_buffer_append(text, ",run_cycles,run_time_ns,wall_time_ns");
+
+   for (uint16_t i = 0; i < 256; ++i)
+   {
+      if (exported_opcode((uint8_t)i))
+      {
+         text_buffer_append(text, ",op_");
+         text_buffer_append(text, cpu_instruction_name((uint8_t)i));
+      }
+   }
+   text_buffer_append_char(text, '\n');
+   return;
+}
+
+/********************************************************************************
+* write_json: Formats a record as a single line JSON object, for instance
+*             {"cycles":17,...,"r":[0,...],"memory":{"1":[7,...]},...}
+*             where the memory ranges are keyed by their first address and
+*             only executed OP codes are listed.
+*
+*             - text: Reference to the text buffer.
+********************************************************************************/
+static void write_json(struct text_buffer* text)
+{
+   bool first_opcode = true;
+
+   text_buffer_append(text, "{\"cycles\":");
+   text_buffer_append_unsigned(text, control_unit_cycle_count());
+   text_buffer_append(text, ",\"instructions\":");
+   text_buffer_append_unsigned(text, control_unit_instruction_count());
+   text_buffer_append(text, ",\"pc\":");
+   text_buffer_append_unsigned(text, control_unit_program_counter());
+   text_buffer_append(text, ",\"sr\":");
+   text_buffer_append_unsigned(text, control_unit_status_register());
+   text_buffer_append(text, ",\"sp\":");
+   text_buffer_append_unsigned(text, stack_pointer());
+   text_buffer_append(text, ",\"r\":[");
+
+   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; ++i)
+   {
+      if (i) text_buffer_append_char(text, ',');
+      text_buffer_append_unsigned(text, control_unit_register(i));
+   }
+
+   text_buffer_append(text, "],\"memory\":{");
+
+   for (size_t i = 0; i < num_ranges; ++i)
+   {
+      text_buffer_append(text, i ? ",\"" : "\"");
+      text_buffer_append_unsigned(text, ranges[i].first);
+      text_buffer_append(text, "\":[");
+
+      for (uint32_t address = ranges[i].first; address <= ranges[i].last; ++address)
+      {
+         if (address != ranges[i].first) text_buffer_append_char(text, ',');
+         text_buffer_append_unsigned(text, data_memory_content[address]);
+      }
+      text_buffer_append_char(text, ']');
+   }
+
+   text_buffer_append(text, "},\"run_cycles\":");
+   text_buffer_append_unsigned(text, control_unit_run_cycle_count());
+   text_buffer_append(text, ",\"run_time_ns\":");
+   text_buffer_append_unsigned(text, control_unit_run_time_ns());
+   text_buffer_append(text, ",\"wall_time_ns\":");
+   text_buffer_append_unsigned(text, host_time_ns() - open_time_ns);
+   text_buffer_append(text, ",\"opcodes\":{");
+
+   for (uint16_t i = 0; i < 256; ++i)
+   {
+      const uint64_t count = control_unit_opcode_count((uint8_t)i);
+
+      if (count && exported_opcode((uint8_t)i))
+      {
+         text_buffer_append(text, first_opcode ? "\"" : ",\"");
+         text_buffer_append(text, cpu_instruction_name((uint8_t)i));
+         text_buffer_append(text, "\":");
+         text_buffer_append_unsigned(text, count);
+         first_opcode = false;
+      }
+   }
+   text_buffer_append(text, "}}\n");
+   return;
+}
+
+/********************************************************************************
+* write_csv: Formats a record as a CSV row in the order of the header.
+*
+*            - text: Reference to the text buffer.
+********************************************************************************/
+static void write_csv(struct text_buffer* text)
+{
+   text_buffer_append_unsigned(text, control_unit_cycle_count());
+   text_buffer_append_char(text, ',');
+   text_buffer_append_unsigned(text, control_unit_instruction_count());
+   text_buffer_append_char(text, ',');
+   text_buffer_append_unsigned(text, control_unit_program_counter());
+   text_buffer_append_char(text, ',');
+   text_buffer_append_unsigned(text, control_unit_status_register());
+   text_buffer_append_char(text, ',');
+   text_buffer_append_unsigned(text, stack_pointer());
+
+   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; ++i)
+   {
+      text_buffer_append_char(text, ',');
+      text_buffer_append_unsigned(text, control_unit_register(i));
+   }
+
+   for (size_t i = 0; i < num_ranges; ++i)
+   {
+      for (uint32_t address = ranges[i].first; address <= ranges[i].last; ++address)
+      {
+         text_buffer_append_char(text, ',');
+         text_buffer_append_unsigned(text, data_memory_content[address]);
+      }
+   }
+
+   text_buffer_append_char(text, ',');
+   text_buffer_append_unsigned(text, control_unit_run_cycle_count());
+   text_buffer_append_char(text, ',');
+   text_buffer_append_unsigned(text, control_unit_run_time_ns());
+   text_buffer_append_char(text, ',');
+   text_buffer_append_unsigned(text, host_time_ns() - open_time_ns);
+
+   for (uint16_t i = 0; i < 256; ++i)
+   {
+      if (exported_opcode((uint8_t)i))
+      {
+         text_buffer_append_char(text, ',');
+         text_buffer_append_unsigned(text, control_unit_opcode_count((uint8_t)i));
+      }
+   }
+   text_buffer_append_char(text, '\n');
+   return;
+}
+
+/********************************************************************************
+* exported_opcode: Indicates if specified OP code has a column of its own,
+*                  i.e. if it's a known instruction other than the
+*                  breakpoint marker.
+*
+*                  - op_code: The OP code.
+********************************************************************************/
+static inline bool exported_opcode(const uint8_t op_code)
+{
+   return op_code != BRK && strcmp(cpu_instruction_name(op_code), "Unknown");
+}
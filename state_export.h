@@ -0,0 +1,76 @@
+/********************************************************************************
+* state_export.h: Contains definitions and function declarations for export
+*                 of the processor state and run statistics in machine
+*                 readable form, either as JSON lines (one object per record)
+*                 or as CSV with a header row. Each record holds the clock
+*                 cycle, the number of instructions, PC, SR, SP, R0 - R31, the
+*                 selected data memory ranges, the cycles and host time of
+*                 continuous runs, the wall clock time since the export was
+*                 opened and the number of executions per OP code.
+*
+*                 Records are formatted in a preallocated buffer without a
+*                 printf call per field and written with a single write.
+********************************************************************************/
+#ifndef STATE_EXPORT_H_
+#define STATE_EXPORT_H_
+
+/* Include directives: */
+#include "control_unit.h"
+
+/* Macro definitions: */
+#define STATE_EXPORT_MAX_RANGES 8 /* Max number of exported data memory ranges. */
+
+/********************************************************************************
+* state_export_format: Enumeration for the export formats.
+********************************************************************************/
+enum state_export_format
+{
+   STATE_EXPORT_JSON, /* One JSON object per line. */
+   STATE_EXPORT_CSV   /* Comma separated values with a header row. */
+};
+
+/********************************************************************************
+* state_export_add_range: Adds a range of data memory addresses to export.
+*                         Ranges must be added before the export is opened,
+*                         since they determine the CSV columns. After
+*                         success, 0 is returned. If the range is invalid,
+*                         the export is already open or too many ranges were
+*                         added, error code 1 is returned.
+*
+*                         - first: First data memory address of the range.
+*                         - last : Last data memory address of the range.
+********************************************************************************/
+int state_export_add_range(const uint16_t first,
+                           const uint16_t last);
+
+/********************************************************************************
+* state_export_open: Opens specified file for export in specified format and
+*                    writes the CSV header. When exporting to stdout, all
+*                    other output to stdout goes to stderr instead, so that
+*                    stdout carries the records only. After success, 0 is
+*                    returned. If the file couldn't be opened, error code 1
+*                    is returned.
+*
+*                    - path  : Path to the file, or "-" for stdout.
+*                    - format: The export format.
+********************************************************************************/
+int state_export_open(const char* path,
+                      const enum state_export_format format);
+
+/********************************************************************************
+* state_export_write: Writes a record of the current state and statistics,
+*                     unless the export isn't open.
+********************************************************************************/
+void state_export_write(void);
+
+/********************************************************************************
+* state_export_close: Closes the export file.
+********************************************************************************/
+void state_export_close(void);
+
+/********************************************************************************
+* state_export_is_open: Indicates if the export is open.
+********************************************************************************/
+bool state_export_is_open(void);
+
+#endif /* STATE_EXPORT_H_ */
@@ -0,0 +1,155 @@
+/********************************************************************************
+* text_buffer.c: Contains function definitions for building text in a
+*                preallocated buffer.
+********************************************************************************/
+#include "text_buffer.h"
+#include <string.h>
+
+/* Static functions: */
+static inline void append_bytes(struct text_buffer* self,
+                                const char* bytes,
+                                size_t size);
+
+/********************************************************************************
+* text_buffer_init: Initializes an empty text buffer in specified storage.
+*
+*                   - self: Reference to the text buffer.
+*                   - data: Reference to the storage.
+*                   - size: Size of the storage in bytes, at least 1.
+********************************************************************************/
+void text_buffer_init(struct text_buffer* self,
+                      char* data,
+                      const size_t size)
+{
+   self->data = data;
+   self->size = size;
+   self->length = 0;
+   self->data[0] = '\0';
+   return;
+}
+
+/********************************************************************************
+* text_buffer_append: Appends specified text.
+*
+*                     - self: Reference to the text buffer.
+*                     - text: The text to append.
+********************************************************************************/
+void text_buffer_append(struct text_buffer* self,
+                        const char* text)
+{
+   append_bytes(self, text, strlen(text));
+   return;
+}
+
+/********************************************************************************
+* text_buffer_append_char: Appends specified character.
+*
+*                          - self     : Reference to the text buffer.
+*                          - character: The character to append.
+********************************************************************************/
+void text_buffer_append_char(struct text_buffer* self,
+                             const char character)
+{
+   append_bytes(self, &character, 1);
+   return;
+}
+
+/********************************************************************************
+* text_buffer_append_unsigned: Appends specified number in decimal form.
+*                              The digits are produced backwards from the
+*                              least significant one.
+*
+*                              - self : Reference to the text buffer.
+*                              - value: The number to append.
+********************************************************************************/
+void text_buffer_append_unsigned(struct text_buffer* self,
+                                 uint64_t value)
+{
+   char digits[20];
+   size_t first = sizeof(digits);
+
+   do
+   {
+      digits[--first] = (char)('0' + value % 10);
+      value /= 10;
+   } while (value);
+
+   append_bytes(self, digits + first, sizeof(digits) - first);
+   return;
+}
+
+/********************************************************************************
+* text_buffer_append_hex: Appends specified number as specified number of
+*                         upper case hexadecimal digits, without prefix.
+*
+*                         - self      : Reference to the text buffer.
+*                         - value     : The number to append.
+*                         - num_digits: The number of digits (max 8).
+********************************************************************************/
+void text_buffer_append_hex(struct text_buffer* self,
+                            const uint32_t value,
+                            const uint8_t num_digits)
+{
+   static const char hex_digits[] = "0123456789ABCDEF";
+   char digits[8];
+   const uint8_t size = num_digits < 8 ? num_digits : 8;
+
+   for (uint8_t i = 0; i < size; ++i)
+   {
+      digits[size - 1 - i] = hex_digits[(value >> (4 * i)) & 0x0F];
+   }
+
+   append_bytes(self, digits, size);
+   return;
+}
+
+/********************************************************************************
+* text_buffer_append_binary: Appends the specified number of least
+*                            significant bits of a byte as binary digits.
+*
+*                            - self    : Reference to the text buffer.
+*                            - value   : The byte to append.
+*                            - num_bits: The number of bits (max 8).
+********************************************************************************/
+void text_buffer_append_binary(struct text_buffer* self,
+                               const uint8_t value,
+                               const uint8_t num_bits)
+{
+   const uint8_t size = num_bits < 8 ? num_bits : 8;
+   append_bytes(self, cpu_binary_byte(value) + 8 - size, size);
+   return;
+}
+
+/********************************************************************************
+* text_buffer_write: Writes the text to specified stream with a single write
+*                    and empties the buffer.
+*
+*                    - self  : Reference to the text buffer.
+*                    - stream: The stream to write to.
+********************************************************************************/
+void text_buffer_write(struct text_buffer* self,
+                       FILE* stream)
+{
+   fwrite(self->data, 1, self->length, stream);
+   self->length = 0;
+   self->data[0] = '\0';
+   return;
+}
+
+/********************************************************************************
+* append_bytes: Appends specified bytes, cut off at the end of the storage.
+*
+*               - self : Reference to the text buffer.
+*               - bytes: Reference to the bytes to append.
+*               - size : The number of bytes.
+********************************************************************************/
+static inline void append_bytes(struct text_buffer* self,
+                                const char* bytes,
+                                size_t size)
+{
+   if (size > self->size - 1 - self->length) size = self->size - 1 - self->length;
+   memcpy(self->data + self->length, bytes, size);
+   self->length += size;
+   self->data[self->length] = '\0';
+   return;
+}
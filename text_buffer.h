@@ -0,0 +1,97 @@
+/********************************************************************************
+* text_buffer.h: Contains definitions and function declarations for building
+*                text in a preallocated buffer, so that a report consisting of
+*                many fields can be formatted without a printf call per field
+*                and emitted with a single write. Text that doesn't fit is cut
+*                off, the buffer is never overrun.
+********************************************************************************/
+#ifndef TEXT_BUFFER_H_
+#define TEXT_BUFFER_H_
+
+/* Include directives: */
+#include "cpu.h"
+
+/********************************************************************************
+* text_buffer: Structure for text built in caller-provided storage. The text
+*              is always terminated by a null character.
+********************************************************************************/
+struct text_buffer
+{
+   char* data;    /* The storage. */
+   size_t size;   /* Size of the storage in bytes, including the terminator. */
+   size_t length; /* Length of the text. */
+};
+
+/********************************************************************************
+* text_buffer_init: Initializes an empty text buffer in specified storage.
+*
+*                   - self: Reference to the text buffer.
+*                   - data: Reference to the storage.
+*                   - size: Size of the storage in bytes, at least 1.
+********************************************************************************/
+void text_buffer_init(struct text_buffer* self,
+                      char* data,
+                      const size_t size);
+
+/********************************************************************************
+* text_buffer_append: Appends specified text.
+*
+*                     - self: Reference to the text buffer.
+*                     - text: The text to append.
+********************************************************************************/
+void text_buffer_append(struct text_buffer* self,
+                        const char* text);
+
+/********************************************************************************
+* text_buffer_append_char: Appends specified character.
+*
+*                          - self     : Reference to the text buffer.
+*                          - character: The character to append.
+********************************************************************************/
+void text_buffer_append_char(struct text_buffer* self,
+                             const char character);
+
+/********************************************************************************
+* text_buffer_append_unsigned: Appends specified number in decimal form.
+*
+*                              - self : Reference to the text buffer.
+*                              - value: The number to append.
+********************************************************************************/
+void text_buffer_append_unsigned(struct text_buffer* self,
+                                 uint64_t value);
+
+/********************************************************************************
+* text_buffer_append_hex: Appends specified number as specified number of
+*                         upper case hexadecimal digits, without prefix.
+*
+*                         - self      : Reference to the text buffer.
+*                         - value     : The number to append.
+*                         - num_digits: The number of digits (max 8).
+********************************************************************************/
+void text_buffer_append_hex(struct text_buffer* self,
+                            const uint32_t value,
+                            const uint8_t num_digits);
+
+/********************************************************************************
+* text_buffer_append_binary: Appends the specified number of least
+*                            significant bits of a byte as binary digits.
+*
+*                            - self    : Reference to the text buffer.
+*                            - value   : The byte to append.
+*                            - num_bits: The number of bits (max 8).
+********************************************************************************/
+void text_buffer_append_binary(struct text_buffer* self,
+                               const uint8_t value,
+                               const uint8_t num_bits);
+
+/********************************************************************************
+* text_buffer_write: Writes the text to specified stream with a single write
+*                    and empties the buffer.
+*
+*                    - self  : Reference to the text buffer.
+*                    - stream: The stream to write to.
+********************************************************************************/
+void text_buffer_write(struct text_buffer* self,
+                       FILE* stream);
+
+#endif /* TEXT_BUFFER_H_ */
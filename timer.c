@@ -0,0 +1,464 @@
+/********************************************************************************
+* timer.c: Contains static variables and function definitions for
+*          implementation of the 8-bit Timer 0 and the 16-bit Timer 1.
+*          Each timer stores its counter value together with the clock cycle
+*          at which the value was valid. The current counter value as well as
+*          the clock cycle of next overflow and compare match are calculated
+*          from these when needed.
+********************************************************************************/
+#include "timer.h"
+#include "control_unit.h"
+#include "event_queue.h"
+
+/* Macro definitions: */
+#define TIMER_NO_EVENT   UINT64_MAX /* Event cycle used when a timer is stopped. */
+#define TIMER_FLAGS_MASK 0x03       /* Overflow and compare match A flags/enable bits. */
+
+/********************************************************************************
+* timer: Structure for a timer/counter. The overflow and compare match flags
+*        as well as the interrupt enable bits use the same bit numbers for
+*        both timers (TOV0/TOV1 and OCF0A/OCF1A).
+********************************************************************************/
+struct timer
+{
+   uint8_t index;          /* Timer number, passed as argument to the scheduled events. */
+   uint16_t max;           /* Max counter value, 0xFF for Timer 0 and 0xFFFF for Timer 1. */
+   uint16_t ocr;           /* Output compare register A. */
+   uint16_t prescaler;     /* Number of clock cycles per timer tick, 0 if stopped. */
+   bool ctc;               /* Indicates clear timer on compare match mode. */
+   uint8_t timsk;          /* Interrupt mask register. */
+   uint8_t tifr;           /* Interrupt flag register. */
+   uint16_t base_count;    /* Counter value at clock cycle base_cycle. */
+   uint64_t base_cycle;    /* Clock cycle at which the counter had value base_count. */
+   uint64_t next_overflow; /* Clock cycle at which the counter wraps to zero next time. */
+   uint64_t next_compare;  /* Clock cycle of next compare match. */
+};
+
+/* Static variables: */
+static struct timer timer0;    /* 8-bit Timer 0. */
+static struct timer timer1;    /* 16-bit Timer 1. */
+static bool interrupt_pending; /* Indicates if an enabled timer interrupt flag is set. */
+static uint8_t temp;           /* Temporary register for 16-bit accesses to Timer 1. */
+
+/* Static functions: */
+static void timer_init(struct timer* self,
+                       const uint8_t index,
+                       const uint16_t max);
+static uint16_t prescaler_from_clock_select(const uint8_t clock_select);
+static uint16_t counter_value(const struct timer* self,
+                              const uint64_t cycle);
+static void synchronize(struct timer* self,
+                        const uint64_t cycle);
+static uint32_t ticks_until(const struct timer* self,
+                            const uint16_t value);
+static void schedule(struct timer* self);
+static void process_events(struct timer* self,
+                           const uint64_t cycle);
+static void timer_event(const uint64_t cycle,
+                        const uint32_t index);
+static void refresh(void);
+static uint8_t write_register(const uint16_t address,
+                              const uint8_t value);
+static uint8_t read_register(const uint16_t address,
+                             const uint8_t value);
+
+/********************************************************************************
+* timer_reset: Stops both timers, clears their registers and attaches the
+*              timer registers to the I/O space of data memory. The event
+*              queue must be reset before the timers.
+********************************************************************************/
+void timer_reset(void)
+{
+   static const uint8_t registers[] =
+   {
+      TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0,
+      TCCR1B, TCNT1L, TCNT1H, OCR1AL, OCR1AH, TIMSK1, TIFR1
+   };
+
+   timer_init(&timer0, 0, 0xFF);
+   timer_init(&timer1, 1, 0xFFFF);
+   temp = 0x00;
+   refresh();
+
+   for (size_t i = 0; i < sizeof(registers); ++i)
+   {
+      data_memory_set_io_hooks(registers[i], write_register, read_register);
+   }
+   return;
+}
+
+/********************************************************************************
+* timer_interrupt_pending: Indicates if any timer interrupt flag is set while
+*                          the corresponding interrupt is enabled.
+********************************************************************************/
+bool timer_interrupt_pending(void)
+{
+   return interrupt_pending;
+}
+
+/********************************************************************************
+* timer_acknowledge_interrupt: Clears the flag of the pending timer interrupt
+*                              with highest priority and returns its interrupt
+*                              vector. If no timer interrupt is pending,
+*                              RESET_vect is returned.
+********************************************************************************/
+uint8_t timer_acknowledge_interrupt(void)
+{
+   uint8_t vector = RESET_vect;
+   const uint8_t pending1 = timer1.tifr & timer1.timsk;
+   const uint8_t pending0 = timer0.tifr & timer0.timsk;
+
+   if (read(pending1, OCF1A))
+   {
+      clr(timer1.tifr, OCF1A);
+      vector = TIMER1_COMPA_vect;
+   }
+   else if (read(pending1, TOV1))
+   {
+      clr(timer1.tifr, TOV1);
+      vector = TIMER1_OVF_vect;
+   }
+   else if (read(pending0, OCF0A))
+   {
+      clr(timer0.tifr, OCF0A);
+      vector = TIMER0_COMPA_vect;
+   }
+   else if (read(pending0, TOV0))
+   {
+      clr(timer0.tifr, TOV0);
+      vector = TIMER0_OVF_vect;
+   }
+
+   refresh();
+   return vector;
+}
+
+/********************************************************************************
+* timer_init: Stops specified timer, clears its registers and removes its
+*             scheduled events.
+*
+*             - self : Reference to the timer.
+*             - index: Timer number.
+*             - max  : Max counter value of the timer.
+********************************************************************************/
+static void timer_init(struct timer* self,
+                       const uint8_t index,
+                       const uint16_t max)
+{
+   event_queue_cancel(timer_event, index);
+   self->index = index;
+   self->max = max;
+   self->ocr = 0x00;
+   self->prescaler = 0;
+   self->ctc = false;
+   self->timsk = 0x00;
+   self->tifr = 0x00;
+   self->base_count = 0;
+   self->base_cycle = 0;
+   self->next_overflow = TIMER_NO_EVENT;
+   self->next_compare = TIMER_NO_EVENT;
+   return;
+}
+
+/********************************************************************************
+* prescaler_from_clock_select: Returns the number of clock cycles per timer
+*                              tick for specified clock select bits CSn2 - CSn0.
+*                              0 is returned for stopped timers as well as for
+*                              external clock sources, which are not supported.
+*
+*                              - clock_select: The clock select bits.
+********************************************************************************/
+static uint16_t prescaler_from_clock_select(const uint8_t clock_select)
+{
+   static const uint16_t prescalers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+   return prescalers[clock_select & 0x07];
+}
+
+/********************************************************************************
+* counter_value: Returns the counter value of specified timer at specified
+*                clock cycle. All events up to the clock cycle must have been
+*                processed, hence the counter has not wrapped since the base.
+*
+*                - self : Reference to the timer.
+*                - cycle: The clock cycle.
+********************************************************************************/
+static uint16_t counter_value(const struct timer* self,
+                              const uint64_t cycle)
+{
+   if (!self->prescaler) return self->base_count;
+   return self->base_count + (uint16_t)((cycle - self->base_cycle) / self->prescaler);
+}
+
+/********************************************************************************
+* synchronize: Processes all events of specified timer up to specified clock
+*              cycle and moves the base to the last timer tick, which must be
+*              done before the counter value, mode or prescaler is changed.
+*
+*              - self : Reference to the timer.
+*              - cycle: The current clock cycle.
+********************************************************************************/
+static void synchronize(struct timer* self,
+                        const uint64_t cycle)
+{
+   process_events(self, cycle);
+
+   if (self->prescaler)
+   {
+      const uint64_t ticks = (cycle - self->base_cycle) / self->prescaler;
+      self->base_count += (uint16_t)ticks;
+      self->base_cycle += ticks * self->prescaler;
+   }
+   else
+   {
+      self->base_cycle = cycle;
+   }
+   return;
+}
+
+/********************************************************************************
+* ticks_until: Returns the number of timer ticks from the base until the
+*              counter of specified timer next reaches specified value. In CTC
+*              mode the counter wraps after reaching OCRnA, unless it has
+*              already passed OCRnA, in which case it counts up to max first.
+*
+*              - self : Reference to the timer.
+*              - value: The counter value to reach.
+********************************************************************************/
+static uint32_t ticks_until(const struct timer* self,
+                            const uint16_t value)
+{
+   const uint32_t period = self->ctc && self->base_count <= self->ocr ?
+      self->ocr + 1UL : self->max + 1UL;
+
+   if (value > self->base_count)
+   {
+      return value - self->base_count;
+   }
+   else
+   {
+      return period - self->base_count + value;
+   }
+}
+
+/********************************************************************************
+* schedule: Calculates the clock cycles of next overflow and compare match
+*           of specified timer from its base and replaces the scheduled event
+*           of the timer in the event queue with the earliest of them.
+*
+*           - self: Reference to the timer.
+********************************************************************************/
+static void schedule(struct timer* self)
+{
+   event_queue_cancel(timer_event, self->index);
+
+   if (self->prescaler)
+   {
+      self->next_overflow = self->base_cycle + (uint64_t)ticks_until(self, 0) * self->prescaler;
+      self->next_compare = self->base_cycle + (uint64_t)ticks_until(self, self->ocr) * self->prescaler;
+      event_queue_schedule(self->next_overflow < self->next_compare ?
+         self->next_overflow : self->next_compare, timer_event, self->index);
+   }
+   else
+   {
+      self->next_overflow = TIMER_NO_EVENT;
+      self->next_compare = TIMER_NO_EVENT;
+   }
+   return;
+}
+
+/********************************************************************************
+* process_events: Sets the interrupt flags of specified timer for all overflows
+*                 and compare matches up to specified clock cycle. In CTC mode
+*                 the overflow flag is only set if OCRnA equals max, since
+*                 the counter otherwise never reaches max.
+*
+*                 - self : Reference to the timer.
+*                 - cycle: The current clock cycle.
+********************************************************************************/
+static void process_events(struct timer* self,
+                           const uint64_t cycle)
+{
+   while (self->next_overflow <= cycle || self->next_compare <= cycle)
+   {
+      const uint64_t event = self->next_overflow < self->next_compare ?
+         self->next_overflow : self->next_compare;
+
+      self->base_cycle = event;
+
+      if (event == self->next_overflow)
+      {
+         self->base_count = 0;
+         if (!self->ctc || self->ocr == self->max) set(self->tifr, TOV0);
+      }
+      if (event == self->next_compare)
+      {
+         self->base_count = self->ocr;
+         set(self->tifr, OCF0A);
+      }
+      schedule(self);
+   }
+   return;
+}
+
+/********************************************************************************
+* timer_event: Handler for the scheduled events of the timers, which sets the
+*              interrupt flags of the overflows and compare matches that have
+*              occured and schedules the next event.
+*
+*              - cycle: The clock cycle the event was scheduled at.
+*              - index: Timer number.
+********************************************************************************/
+static void timer_event(const uint64_t cycle,
+                        const uint32_t index)
+{
+   process_events(index ? &timer1 : &timer0, cycle);
+   refresh();
+   return;
+}
+
+/********************************************************************************
+* refresh: Updates the indication of pending timer interrupts.
+********************************************************************************/
+static void refresh(void)
+{
+   interrupt_pending = ((timer0.tifr & timer0.timsk) | (timer1.tifr & timer1.timsk)) & TIMER_FLAGS_MASK;
+   return;
+}
+
+/********************************************************************************
+* write_register: Hook for writes to the timer registers. The timer is
+*                 synchronized to the current clock cycle before the change,
+*                 after which the next events are recalculated. Flags are
+*                 cleared by writing ones to them, as on ATmega328P. 16-bit
+*                 registers of Timer 1 are written high byte first via the
+*                 temporary register.
+*
+*                 - address: The written timer register.
+*                 - value  : The value written by the CPU.
+********************************************************************************/
+static uint8_t write_register(const uint16_t address,
+                              const uint8_t value)
+{
+   const uint64_t cycle = control_unit_cycle_count();
+   struct timer* self = address < TCCR1B ? &timer0 : &timer1;
+   uint8_t stored = value;
+
+   synchronize(self, cycle);
+
+   switch (address)
+   {
+      case TCCR0A:
+      {
+         self->ctc = read(value, WGM01);
+         break;
+      }
+      case TCCR0B:
+      {
+         self->prescaler = prescaler_from_clock_select(value);
+         break;
+      }
+      case TCCR1B:
+      {
+         self->ctc = read(value, WGM12);
+         self->prescaler = prescaler_from_clock_select(value);
+         break;
+      }
+      case TCNT0:
+      {
+         self->base_count = value;
+         self->base_cycle = cycle;
+         break;
+      }
+      case TCNT1L:
+      {
+         self->base_count = (temp << 8) | value;
+         self->base_cycle = cycle;
+         break;
+      }
+      case OCR0A:
+      {
+         self->ocr = value;
+         break;
+      }
+      case OCR1AL:
+      {
+         self->ocr = (temp << 8) | value;
+         break;
+      }
+      case TCNT1H: case OCR1AH:
+      {
+         temp = value;
+         break;
+      }
+      case TIMSK0: case TIMSK1:
+      {
+         self->timsk = value;
+         break;
+      }
+      case TIFR0: case TIFR1:
+      {
+         self->tifr &= ~value;
+         stored = self->tifr;
+         break;
+      }
+      default:
+      {
+         break;
+      }
+   }
+
+   schedule(self);
+   refresh();
+   return stored;
+}
+
+/********************************************************************************
+* read_register: Hook for reads of the timer registers. The counter registers
+*                return the value at the current clock cycle, whereas the
+*                flag registers return the flags set up to the current clock
+*                cycle, even if the scheduled event of the timer has not yet
+*                been serviced. Reading the low byte of TCNT1 latches the high byte
+*                into the temporary register, from which it is read next.
+*
+*                - address: The read timer register.
+*                - value  : The value stored at the address.
+********************************************************************************/
+static uint8_t read_register(const uint16_t address,
+                             const uint8_t value)
+{
+   const uint64_t cycle = control_unit_cycle_count();
+   struct timer* self = address < TCCR1B ? &timer0 : &timer1;
+
+   process_events(self, cycle);
+   refresh();
+
+   switch (address)
+   {
+      case TCNT0:
+      {
+         return (uint8_t)counter_value(self, cycle);
+      }
+      case TCNT1L:
+      {
+         const uint16_t count = counter_value(self, cycle);
+         temp = high(count);
+         return low(count);
+      }
+      case TCNT1H:
+      {
+         return temp;
+      }
+      case TIFR0:
+      {
+         return timer0.tifr;
+      }
+      case TIFR1:
+      {
+         return timer1.tifr;
+      }
+      default:
+      {
+         return value;
+      }
+   }
+}
@@ -0,0 +1,38 @@
+/********************************************************************************
+* timer.h: Contains function declarations for implementation of the 8-bit
+*          Timer 0 and the 16-bit Timer 1, controlled via I/O registers in
+*          data memory. The timers are driven by the cycle counter of the
+*          control unit, but instead of incrementing the counters every clock
+*          cycle, the clock cycle of the next overflow or compare match is
+*          calculated in advance and scheduled in the event queue, so that
+*          no work is done between events.
+********************************************************************************/
+#ifndef TIMER_H_
+#define TIMER_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "data_memory.h"
+
+/********************************************************************************
+* timer_reset: Stops both timers, clears their registers and attaches the
+*              timer registers to the I/O space of data memory. The event
+*              queue must be reset before the timers.
+********************************************************************************/
+void timer_reset(void);
+
+/********************************************************************************
+* timer_interrupt_pending: Indicates if any timer interrupt flag is set while
+*                          the corresponding interrupt is enabled.
+********************************************************************************/
+bool timer_interrupt_pending(void);
+
+/********************************************************************************
+* timer_acknowledge_interrupt: Clears the flag of the pending timer interrupt
+*                              with highest priority and returns its interrupt
+*                              vector. If no timer interrupt is pending,
+*                              RESET_vect is returned.
+********************************************************************************/
+uint8_t timer_acknowledge_interrupt(void);
+
+#endif /* TIMER_H_ */
@@ -0,0 +1,366 @@
+/********************************************************************************
+* trace.c: Contains static variables and function definitions for the binary
+*          execution trace. The CPU thread only copies fixed-size records to
+*          the ring buffer; encoding and file output are done by the host
+*          thread.
+*
+*          Each record is encoded as a flags byte followed by fields that
+*          are only present when needed:
+*
+*          flags bit 3 - 0: Kind of write (TRACE_KIND_*).
+*          flags bit 4    : The status register changed, a byte follows.
+*          flags bit 5    : The stack pointer changed, a zigzag varint delta follows.
+*          flags bit 6    : The address isn't the previous address + 1, a
+*                           zigzag varint delta follows.
+*          flags bit 7    : The record describes an interrupt entry.
+*
+*          The fields follow in the order: cycle delta (varint), address
+*          delta, instruction (varint), status register, stack pointer delta,
+*          destination (varint) and value (1 byte, or 2 bytes with the high
+*          byte first for TRACE_KIND_DATA16).
+********************************************************************************/
+#include "trace.h"
+#include "ring_buffer.h"
+#include "host.h"
+#include <string.h>
+
+/* Macro definitions: */
+#define TRACE_MARKER_CHECKPOINT 0x40 /* Kind of the record preceding a checkpoint in the ring buffer. */
+#define TRACE_MAX_ENCODED_SIZE  40   /* Max number of bytes of an encoded record. */
+
+/********************************************************************************
+* checkpoint_message: Structure for a checkpoint passed through the ring
+*                     buffer, preceded by a marker record.
+********************************************************************************/
+struct checkpoint_message
+{
+   struct trace_record marker;         /* Record with kind TRACE_MARKER_CHECKPOINT. */
+   struct trace_checkpoint checkpoint; /* The captured CPU state. */
+};
+
+/* Static variables: */
+static FILE* output;                          /* The trace file, null if not tracing. */
+static struct ring_buffer buffer;             /* Records not yet encoded. */
+static struct host_thread writer;             /* Host thread encoding and writing the trace. */
+static volatile size_t writer_stop;           /* Set to stop the host thread when the buffer is empty. */
+static trace_checkpoint_function capture;     /* Function capturing the CPU state. */
+static uint32_t block_records;                /* Number of records written to the current block (CPU thread). */
+static struct checkpoint_message message;     /* Checkpoint message being written (CPU thread). */
+
+static struct trace_checkpoint block_checkpoint; /* Checkpoint of the block being encoded (host thread). */
+static uint8_t* payload;                         /* Encoded records of the block being encoded. */
+static uint32_t payload_size;                    /* Number of bytes in the payload. */
+static uint32_t payload_records;                 /* Number of records in the payload. */
+static struct trace_record previous;             /* Previous encoded record of the block. */
+
+/* Static functions: */
+static void write_checkpoint(void);
+static void start_block(const struct trace_checkpoint* checkpoint);
+static void flush_block(void);
+static void encode(const struct trace_record* record);
+static inline uint64_t zigzag(const int64_t value);
+static void writer_run(void* arg);
+
+/********************************************************************************
+* trace_open: Starts tracing to specified file and starts the host thread
+*             writing it. The first block starts with a checkpoint captured
+*             immediately. After success, 0 is returned. If the file couldn't
+*             be opened or tracing is already in progress, error code 1 is
+*             returned.
+*
+*             - path      : Path to the trace file.
+*             - checkpoint: Function capturing the CPU state.
+********************************************************************************/
+int trace_open(const char* path,
+               trace_checkpoint_function checkpoint)
+{
+   const uint32_t records_per_block = TRACE_BLOCK_RECORDS;
+   if (output) return 1;
+
+   output = fopen(path, "wb");
+   if (!output) return 1;
+
+   payload = (uint8_t*)malloc(TRACE_BLOCK_RECORDS * TRACE_MAX_ENCODED_SIZE);
+
+   if (!payload || ring_buffer_init(&buffer, TRACE_BUFFER_SIZE))
+   {
+      trace_close();
+      return 1;
+   }
+
+   fwrite(TRACE_MAGIC, 1, 8, output);
+   fwrite(&records_per_block, sizeof(records_per_block), 1, output);
+
+   capture = checkpoint;
+   payload_records = 0;
+   write_checkpoint();
+   host_atomic_store(&writer_stop, 0);
+
+   if (host_thread_start(&writer, writer_run, 0))
+   {
+      trace_close();
+      return 1;
+   }
+   return 0;
+}
+
+/********************************************************************************
+* trace_write: Passes specified record to the host thread. If the ring buffer
+*              is full, the CPU thread waits for the host thread to catch up,
+*              so that no records are lost. When a block is full, a checkpoint
+*              is captured for the next block.
+*
+*              - record: Reference to the record.
+********************************************************************************/
+void trace_write(const struct trace_record* record)
+{
+   while (ring_buffer_write(&buffer, record, sizeof(*record)))
+   {
+      host_sleep_ms(1);
+   }
+
+   if (++block_records == TRACE_BLOCK_RECORDS)
+   {
+      write_checkpoint();
+   }
+   return;
+}
+
+/********************************************************************************
+* trace_close: Writes all traced records, stops the host thread and closes
+*              the trace file.
+********************************************************************************/
+void trace_close(void)
+{
+   if (!output) return;
+
+   if (writer.running)
+   {
+      host_atomic_store(&writer_stop, 1);
+      host_thread_join(&writer);
+   }
+
+   fclose(output);
+   output = 0;
+   free(payload);
+   payload = 0;
+   ring_buffer_clear(&buffer);
+   return;
+}
+
+/********************************************************************************
+* trace_restart: Starts a new block with a checkpoint captured immediately,
+*                for instance after a reset, since the cycle counter and the
+*                CPU state then change without any traced instruction.
+********************************************************************************/
+void trace_restart(void)
+{
+   if (output) write_checkpoint();
+   return;
+}
+
+/********************************************************************************
+* trace_encode_varint: Writes specified value as a varint, 7 bits per byte
+*                      with the most significant bit set in all bytes but
+*                      the last. Returns the number of bytes written.
+*
+*                      - buffer: Reference to storage for at least 10 bytes.
+*                      - value : The value to encode.
+********************************************************************************/
+size_t trace_encode_varint(uint8_t* buffer,
+                           uint64_t value)
+{
+   size_t size = 0;
+
+   while (value >= 0x80)
+   {
+      buffer[size++] = (uint8_t)(value | 0x80);
+      value >>= 7;
+   }
+
+   buffer[size++] = (uint8_t)value;
+   return size;
+}
+
+/********************************************************************************
+* trace_decode_varint: Reads a varint from specified buffer. Returns the
+*                      number of bytes read, or 0 if the varint doesn't end
+*                      before the end of the buffer.
+*
+*                      - buffer: Reference to the encoded bytes.
+*                      - size  : Number of bytes available in the buffer.
+*                      - value : Reference to storage for the decoded value.
+********************************************************************************/
+size_t trace_decode_varint(const uint8_t* buffer,
+                           const size_t size,
+                           uint64_t* value)
+{
+   *value = 0;
+
+   for (size_t i = 0; i < size && i < 10; ++i)
+   {
+      *value |= (uint64_t)(buffer[i] & 0x7F) << (7 * i);
+      if (!(buffer[i] & 0x80)) return i + 1;
+   }
+   return 0;
+}
+
+/********************************************************************************
+* write_checkpoint: Captures the CPU state and passes it to the host thread,
+*                   which starts a new block with it.
+********************************************************************************/
+static void write_checkpoint(void)
+{
+   memset(&message.marker, 0, sizeof(message.marker));
+   message.marker.kind = TRACE_MARKER_CHECKPOINT;
+   capture(&message.checkpoint);
+
+   while (ring_buffer_write(&buffer, &message, sizeof(message)))
+   {
+      host_sleep_ms(1);
+   }
+
+   block_records = 0;
+   return;
+}
+
+/********************************************************************************
+* start_block: Starts encoding of a new block with specified checkpoint.
+*
+*              - checkpoint: The CPU state before the first record.
+********************************************************************************/
+static void start_block(const struct trace_checkpoint* checkpoint)
+{
+   block_checkpoint = *checkpoint;
+   payload_size = 0;
+   payload_records = 0;
+
+   memset(&previous, 0, sizeof(previous));
+   previous.cycle = checkpoint->cycle;
+   previous.pc = checkpoint->pc - 1;
+   previous.sp = checkpoint->sp;
+   previous.sr = checkpoint->sr;
+   return;
+}
+
+/********************************************************************************
+* flush_block: Writes the block being encoded to the trace file, unless it
+*              contains no records.
+********************************************************************************/
+static void flush_block(void)
+{
+   if (!payload_records) return;
+
+   fwrite(&payload_records, sizeof(payload_records), 1, output);
+   fwrite(&payload_size, sizeof(payload_size), 1, output);
+   fwrite(&block_checkpoint, sizeof(block_checkpoint), 1, output);
+   fwrite(payload, 1, payload_size, output);
+
+   payload_records = 0;
+   payload_size = 0;
+   return;
+}
+
+/********************************************************************************
+* encode: Appends specified record to the payload of the current block.
+*
+*         - record: Reference to the record.
+********************************************************************************/
+static void encode(const struct trace_record* record)
+{
+   uint8_t* data = payload + payload_size;
+   const uint8_t kind = record->kind & TRACE_KIND_MASK;
+   uint8_t flags = record->kind & (TRACE_KIND_MASK | TRACE_FLAG_INTERRUPT);
+   size_t size = 1;
+
+   if (record->sr != previous.sr) flags |= TRACE_FLAG_SR;
+   if (record->sp != previous.sp) flags |= TRACE_FLAG_SP;
+   if (record->pc != (uint16_t)(previous.pc + 1)) flags |= TRACE_FLAG_JUMP;
+
+   data[0] = flags;
+   size += trace_encode_varint(data + size, record->cycle - previous.cycle);
+
+   if (flags & TRACE_FLAG_JUMP)
+   {
+      size += trace_encode_varint(data + size, zigzag((int16_t)(record->pc - previous.pc)));
+   }
+
+   size += trace_encode_varint(data + size, record->instruction);
+
+   if (flags & TRACE_FLAG_SR)
+   {
+      data[size++] = record->sr;
+   }
+
+   if (flags & TRACE_FLAG_SP)
+   {
+      size += trace_encode_varint(data + size, zigzag((int16_t)(record->sp - previous.sp)));
+   }
+
+   if (kind != TRACE_KIND_NONE)
+   {
+      size += trace_encode_varint(data + size, record->destination);
+      if (kind == TRACE_KIND_DATA16) data[size++] = high(record->value);
+      data[size++] = low(record->value);
+   }
+
+   payload_size += (uint32_t)size;
+   payload_records++;
+   previous = *record;
+   return;
+}
+
+/********************************************************************************
+* zigzag: Maps specified signed value to an unsigned value, so that values
+*         close to zero get short varints (0, -1, 1, -2 => 0, 1, 2, 3).
+*
+*         - value: The signed value.
+********************************************************************************/
+static inline uint64_t zigzag(const int64_t value)
+{
+   return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+/********************************************************************************
+* writer_run: Runs the host thread, which encodes records from the ring
+*             buffer and writes each block when it's complete. The thread
+*             finishes when stopped and all records have been written.
+*
+*             - arg: Not used.
+********************************************************************************/
+static void writer_run(void* arg)
+{
+   (void)arg;
+   while (1)
+   {
+      if (ring_buffer_used(&buffer) >= sizeof(struct trace_record))
+      {
+         struct trace_record record;
+         ring_buffer_read(&buffer, &record, sizeof(record));
+
+         if (record.kind == TRACE_MARKER_CHECKPOINT)
+         {
+            struct trace_checkpoint checkpoint;
+            ring_buffer_read(&buffer, &checkpoint, sizeof(checkpoint));
+            flush_block();
+            start_block(&checkpoint);
+         }
+         else
+         {
+            encode(&record);
+         }
+      }
+      else if (host_atomic_load(&writer_stop) && !ring_buffer_used(&buffer))
+      {
+         break;
+      }
+      else
+      {
+         host_sleep_ms(1);
+      }
+   }
+
+   flush_block();
+   fflush(output);
+   return;
+}
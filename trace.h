@@ -0,0 +1,146 @@
+/********************************************************************************
+* trace.h: Contains definitions and function declarations for a binary
+*          execution trace. A fixed-size record is written for every executed
+*          instruction into a lock-free ring buffer, which is drained by a
+*          host thread that compresses the records and writes them to file.
+*
+*          The trace file starts with a header, followed by blocks of at most
+*          TRACE_BLOCK_RECORDS records. Each block starts with a checkpoint
+*          of the complete CPU state before its first record, so that a block
+*          can be decoded, and the machine state reconstructed, without
+*          reading the preceding blocks. All integers are stored in the byte
+*          order of the host:
+*
+*          Header: TRACE_MAGIC (8 bytes), block records (uint32_t).
+*          Block : number of records (uint32_t), payload size (uint32_t),
+*                  checkpoint (struct trace_checkpoint), payload.
+*
+*          In the payload, each record is delta-encoded against the previous
+*          record of the block (the checkpoint for the first record) as a
+*          flags byte followed by varints, see trace.c. Traces are read by
+*          the functions in trace_reader.h.
+********************************************************************************/
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "data_memory.h"
+
+/* Macro definitions: */
+#define TRACE_MAGIC         "AVRTRC01" /* Identifies a trace file (8 characters). */
+#define TRACE_BLOCK_RECORDS 4096       /* Max number of records per block. */
+#define TRACE_BUFFER_SIZE   4194304    /* Capacity in bytes of the ring buffer. */
+
+#define TRACE_KIND_NONE      0x00 /* The instruction wrote no register or data memory. */
+#define TRACE_KIND_REGISTER  0x01 /* A CPU register was written (8 bits). */
+#define TRACE_KIND_DATA      0x02 /* A location in data memory was written (8 bits). */
+#define TRACE_KIND_DATA16    0x03 /* Two locations were written, high byte at the lower address. */
+#define TRACE_KIND_MASK      0x0F /* Mask for the kinds above. */
+#define TRACE_FLAG_INTERRUPT 0x80 /* The record describes entry of an interrupt. */
+
+#define TRACE_FLAG_SR   0x10 /* Encoded record: the status register changed. */
+#define TRACE_FLAG_SP   0x20 /* Encoded record: the stack pointer changed. */
+#define TRACE_FLAG_JUMP 0x40 /* Encoded record: the address isn't the previous address + 1. */
+
+/********************************************************************************
+* trace_record: Structure for the trace record of an executed instruction.
+*               For interrupt entries, the instruction field holds the vector
+*               and the program counter the interrupted address.
+********************************************************************************/
+struct trace_record
+{
+   uint64_t cycle;       /* Clock cycle when the instruction was completed. */
+   uint32_t instruction; /* The executed instruction (24 bits). */
+   uint16_t pc;          /* Address of the executed instruction. */
+   uint16_t sp;          /* Stack pointer after the instruction. */
+   uint16_t destination; /* Written register or data memory address. */
+   uint16_t value;       /* Written value (16 bits for TRACE_KIND_DATA16). */
+   uint8_t sr;           /* Status register after the instruction. */
+   uint8_t kind;         /* Kind of write and flags, see TRACE_KIND_* and TRACE_FLAG_*. */
+};
+
+/********************************************************************************
+* trace_checkpoint: Structure for the complete CPU state at the start of a
+*                   block in the trace.
+********************************************************************************/
+struct trace_checkpoint
+{
+   uint64_t cycle;                            /* Clock cycle elapsed since reset. */
+   uint64_t instructions;                     /* Number of instructions executed since reset. */
+   uint16_t pc;                               /* Program counter. */
+   uint16_t sp;                               /* Stack pointer. */
+   uint8_t sr;                                /* Status register. */
+   uint8_t reg[CPU_REGISTER_ADDRESS_WIDTH];   /* CPU registers R0 - R31. */
+   uint8_t data[DATA_MEMORY_ADDRESS_WIDTH];   /* Data memory, including the I/O space. */
+};
+
+/********************************************************************************
+* trace_checkpoint_function: Function called to capture the CPU state when a
+*                            new block is started.
+*
+*                            - checkpoint: Reference to storage for the state.
+********************************************************************************/
+typedef void (*trace_checkpoint_function)(struct trace_checkpoint* checkpoint);
+
+/********************************************************************************
+* trace_open: Starts tracing to specified file and starts the host thread
+*             writing it. The first block starts with a checkpoint captured
+*             immediately. After success, 0 is returned. If the file couldn't
+*             be opened or tracing is already in progress, error code 1 is
+*             returned.
+*
+*             - path      : Path to the trace file.
+*             - checkpoint: Function capturing the CPU state.
+********************************************************************************/
+int trace_open(const char* path,
+               trace_checkpoint_function checkpoint);
+
+/********************************************************************************
+* trace_write: Passes specified record to the host thread. If the ring buffer
+*              is full, the CPU thread waits for the host thread to catch up,
+*              so that no records are lost. When a block is full, a checkpoint
+*              is captured for the next block.
+*
+*              - record: Reference to the record.
+********************************************************************************/
+void trace_write(const struct trace_record* record);
+
+/********************************************************************************
+* trace_restart: Starts a new block with a checkpoint captured immediately,
+*                for instance after a reset, since the cycle counter and the
+*                CPU state then change without any traced instruction.
+********************************************************************************/
+void trace_restart(void);
+
+/********************************************************************************
+* trace_close: Writes all traced records, stops the host thread and closes
+*              the trace file.
+********************************************************************************/
+void trace_close(void);
+
+/********************************************************************************
+* trace_encode_varint: Writes specified value as a varint, 7 bits per byte
+*                      with the most significant bit set in all bytes but
+*                      the last. Returns the number of bytes written.
+*
+*                      - buffer: Reference to storage for at least 10 bytes.
+*                      - value : The value to encode.
+********************************************************************************/
+size_t trace_encode_varint(uint8_t* buffer,
+                           uint64_t value);
+
+/********************************************************************************
+* trace_decode_varint: Reads a varint from specified buffer. Returns the
+*                      number of bytes read, or 0 if the varint doesn't end
+*                      before the end of the buffer.
+*
+*                      - buffer: Reference to the encoded bytes.
+*                      - size  : Number of bytes available in the buffer.
+*                      - value : Reference to storage for the decoded value.
+********************************************************************************/
+size_t trace_decode_varint(const uint8_t* buffer,
+                           const size_t size,
+                           uint64_t* value);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,739 @@
+/********************************************************************************
+* trace_reader.c: Contains static functions and function definitions for
+*                 reading binary execution traces. Only the block headers are
+*                 read to build the index, and only one block is held in
+*                 memory while decoding, so traces may be far larger than
+*                 the memory of the host.
+********************************************************************************/
+#include "trace_reader.h"
+#include "host.h"
+#include <string.h>
+
+/* Macro definitions: */
+#define TRACE_BLOCK_HEADER_SIZE (2 * sizeof(uint32_t)) /* Size of the block header before the checkpoint. */
+
+/* Static functions: */
+static int load_index(struct trace_reader* self,
+                      const char* index_path,
+                      const uint64_t file_size);
+static int build_index(struct trace_reader* self,
+                       const uint64_t file_size);
+static int index_key(const struct trace_reader* self,
+                     uint64_t* key);
+static void save_index(const struct trace_reader* self,
+                       const char* index_path,
+                       const uint64_t file_size);
+static size_t find_block_from(const struct trace_reader* self,
+                              const uint64_t cycle,
+                              size_t first);
+static inline bool starts_segment(const struct trace_reader* self,
+                                  const size_t block);
+static int decode(struct trace_reader* self,
+                  struct trace_record* record);
+static int read_varint(struct trace_reader* self,
+                       uint64_t* value);
+static inline int64_t unzigzag(const uint64_t value);
+static bool record_writes(const struct trace_record* record,
+                          const uint64_t address);
+
+/********************************************************************************
+* trace_reader_open: Opens specified trace file and loads or builds its block
+*                    index. After success, 0 is returned. If the file couldn't
+*                    be opened or isn't a valid trace, error code 1 is
+*                    returned.
+*
+*                    - self: Reference to the reader.
+*                    - path: Path to the trace file.
+********************************************************************************/
+int trace_reader_open(struct trace_reader* self,
+                      const char* path)
+{
+   char magic[8];
+   uint32_t records_per_block = 0;
+   uint32_t max_payload_size = 1;
+   uint64_t file_size;
+   char* index_path = (char*)malloc(strlen(path) + 5);
+
+   memset(self, 0, sizeof(*self));
+   self->file = fopen(path, "rb");
+
+   if (!index_path || !self->file ||
+       fread(magic, 1, sizeof(magic), self->file) != sizeof(magic) ||
+       memcmp(magic, TRACE_MAGIC, sizeof(magic)) ||
+       fread(&records_per_block, sizeof(records_per_block), 1, self->file) != 1 ||
+       host_file_seek(self->file, 0, true))
+   {
+      free(index_path);
+      trace_reader_close(self);
+      return 1;
+   }
+
+   file_size = host_file_tell(self->file);
+   strcpy(index_path, path);
+   strcat(index_path, ".idx");
+
+   if (load_index(self, index_path, file_size))
+   {
+      if (build_index(self, file_size))
+      {
+         free(index_path);
+         trace_reader_close(self);
+         return 1;
+      }
+      save_index(self, index_path, file_size);
+   }
+
+   free(index_path);
+
+   for (size_t i = 0; i < self->num_blocks; ++i)
+   {
+      if (self->blocks[i].payload_size > max_payload_size) max_payload_size = self->blocks[i].payload_size;
+      self->num_records += self->blocks[i].records;
+   }
+
+   self->payload = (uint8_t*)malloc(max_payload_size);
+   self->block = self->num_blocks;
+
+   if (!self->payload)
+   {
+      trace_reader_close(self);
+      return 1;
+   }
+   return 0;
+}
+
+/********************************************************************************
+* trace_reader_close: Closes the trace file and frees the index.
+*
+*                     - self: Reference to the reader.
+********************************************************************************/
+void trace_reader_close(struct trace_reader* self)
+{
+   if (self->file) fclose(self->file);
+   free(self->blocks);
+   free(self->payload);
+   memset(self, 0, sizeof(*self));
+   return;
+}
+
+/********************************************************************************
+* trace_reader_find_block: Returns the index of the block with the last
+*                          checkpoint at or before specified clock cycle,
+*                          within the first segment starting at or before
+*                          the cycle. If no segment starts at or before the
+*                          cycle, the number of blocks is returned.
+*
+*                          - self : Reference to the reader.
+*                          - cycle: The clock cycle to find.
+********************************************************************************/
+size_t trace_reader_find_block(const struct trace_reader* self,
+                               const uint64_t cycle)
+{
+   return find_block_from(self, cycle, 0);
+}
+
+/********************************************************************************
+* trace_reader_seek_block: Loads specified block, so that the next record read
+*                          is the first record of the block. After success, 0
+*                          is returned. If the block doesn't exist or couldn't
+*                          be read, error code 1 is returned.
+*
+*                          - self : Reference to the reader.
+*                          - block: Index of the block.
+********************************************************************************/
+int trace_reader_seek_block(struct trace_reader* self,
+                            const size_t block)
+{
+   if (block >= self->num_blocks) return 1;
+   const struct trace_block* entry = &self->blocks[block];
+
+   if (host_file_seek(self->file, (int64_t)(entry->offset + TRACE_BLOCK_HEADER_SIZE), false) ||
+       fread(&self->checkpoint, sizeof(self->checkpoint), 1, self->file) != 1 ||
+       fread(self->payload, 1, entry->payload_size, self->file) != entry->payload_size)
+   {
+      self->block = self->num_blocks;
+      return 1;
+   }
+
+   self->block = block;
+   self->position = 0;
+   self->record = 0;
+
+   memset(&self->previous, 0, sizeof(self->previous));
+   self->previous.cycle = self->checkpoint.cycle;
+   self->previous.pc = self->checkpoint.pc - 1;
+   self->previous.sp = self->checkpoint.sp;
+   self->previous.sr = self->checkpoint.sr;
+   return 0;
+}
+
+/********************************************************************************
+* trace_reader_next: Reads the next record, continuing with the next block at
+*                    the end of the loaded block. After success, 0 is
+*                    returned. At the end of the trace, or if the trace is
+*                    corrupt, 1 is returned.
+*
+*                    - self  : Reference to the reader.
+*                    - record: Reference to storage for the record.
+********************************************************************************/
+int trace_reader_next(struct trace_reader* self,
+                      struct trace_record* record)
+{
+   while (self->block >= self->num_blocks || self->record == self->blocks[self->block].records)
+   {
+      const size_t next = self->block >= self->num_blocks ? 0 : self->block + 1;
+      if (trace_reader_seek_block(self, next)) return 1;
+   }
+   return decode(self, record);
+}
+
+/********************************************************************************
+* trace_reader_apply: Updates specified state with the effect of a record.
+*                     The program counter is set to the address following
+*                     the instruction, or to the vector of an interrupt.
+*
+*                     - state : Reference to the state.
+*                     - record: Reference to the record.
+********************************************************************************/
+void trace_reader_apply(struct trace_checkpoint* state,
+                        const struct trace_record* record)
+{
+   const uint16_t destination = record->destination;
+
+   state->cycle = record->cycle;
+   state->sp = record->sp;
+   state->sr = record->sr;
+   state->data[SPL] = low(record->sp);
+   state->data[SPH] = high(record->sp);
+
+   switch (record->kind & TRACE_KIND_MASK)
+   {
+   case TRACE_KIND_REGISTER:
+      if (destination < CPU_REGISTER_ADDRESS_WIDTH) state->reg[destination] = low(record->value);
+      break;
+   case TRACE_KIND_DATA:
+      if (destination < DATA_MEMORY_ADDRESS_WIDTH) state->data[destination] = low(record->value);
+      break;
+   case TRACE_KIND_DATA16:
+      if (destination + 1 < DATA_MEMORY_ADDRESS_WIDTH)
+      {
+         state->data[destination] = high(record->value);
+         state->data[destination + 1] = low(record->value);
+      }
+      break;
+   }
+
+   if (record->kind & TRACE_FLAG_INTERRUPT)
+   {
+      state->pc = (uint16_t)record->instruction;
+   }
+   else
+   {
+      state->instructions++;
+      state->pc = record->pc + 1;
+   }
+   return;
+}
+
+/********************************************************************************
+* trace_reader_state: Reconstructs the machine state after all instructions
+*                     completed at or before specified clock cycle, by
+*                     applying the records of one block to its checkpoint.
+*                     The program counter is the address of the next
+*                     instruction, as far as known from the trace. After
+*                     success, 0 is returned. If the trace doesn't reach the
+*                     cycle, error code 1 is returned.
+*
+*                     - self : Reference to the reader.
+*                     - cycle: The clock cycle.
+*                     - state: Reference to storage for the state.
+********************************************************************************/
+int trace_reader_state(struct trace_reader* self,
+                       const uint64_t cycle,
+                       struct trace_checkpoint* state)
+{
+   size_t block = find_block_from(self, cycle, 0);
+
+   while (block < self->num_blocks)
+   {
+      struct trace_record record;
+      if (trace_reader_seek_block(self, block)) return 1;
+      *state = self->checkpoint;
+
+      while (self->record < self->blocks[block].records)
+      {
+         if (decode(self, &record)) return 1;
+
+         if (record.cycle > cycle)
+         {
+            state->pc = record.pc;
+            return 0;
+         }
+         trace_reader_apply(state, &record);
+      }
+
+      if (block + 1 < self->num_blocks && !starts_segment(self, block + 1))
+      {
+         if (trace_reader_seek_block(self, block + 1)) return 1;
+         state->pc = self->checkpoint.pc;
+         return 0;
+      }
+
+      if (state->cycle == cycle) return 0;
+
+      /* The segment ended before the cycle, continue with the next segment. */
+      do block++;
+      while (block < self->num_blocks && !starts_segment(self, block));
+      block = find_block_from(self, cycle, block);
+   }
+   return 1;
+}
+
+/********************************************************************************
+* trace_reader_print: Prints the records selected by specified filter, one
+*                     line per record with the disassembled instruction and
+*                     the written location. The number of printed records
+*                     is returned.
+*
+*                     - self  : Reference to the reader.
+*                     - filter: Reference to the filter.
+********************************************************************************/
+uint64_t trace_reader_print(struct trace_reader* self,
+                            const struct trace_filter* filter)
+{
+   struct trace_record record;
+   uint64_t printed = 0;
+   const size_t block = filter->first_cycle == TRACE_READER_NONE ? 0 :
+      find_block_from(self, filter->first_cycle, 0);
+
+   if (trace_reader_seek_block(self, block < self->num_blocks ? block : 0)) return 0;
+   printf("%12s  %-7s  %-24s %s\n", "Cycle", "Address", "Instruction", "Written");
+
+   while (!trace_reader_next(self, &record))
+   {
+      char text[32];
+      char written[32] = "";
+      const uint8_t kind = record.kind & TRACE_KIND_MASK;
+
+      if (filter->last_cycle != TRACE_READER_NONE && record.cycle > filter->last_cycle) break;
+      if (filter->first_cycle != TRACE_READER_NONE && record.cycle < filter->first_cycle) continue;
+      if (filter->first_pc != TRACE_READER_NONE && record.pc < filter->first_pc) continue;
+      if (filter->last_pc != TRACE_READER_NONE && record.pc > filter->last_pc) continue;
+      if (filter->address != TRACE_READER_NONE && !record_writes(&record, filter->address)) continue;
+
+      if (record.kind & TRACE_FLAG_INTERRUPT)
+      {
+         snprintf(text, sizeof(text), "Interrupt 0x%02X", (unsigned)record.instruction);
+      }
+      else
+      {
+         cpu_disassemble(record.instruction, text, sizeof(text));
+      }
+
+      if (kind == TRACE_KIND_REGISTER)
+      {
+         snprintf(written, sizeof(written), "R%hu = 0x%02X", record.destination, low(record.value));
+      }
+      else if (kind == TRACE_KIND_DATA)
+      {
+         snprintf(written, sizeof(written), "[0x%04X] = 0x%02X", record.destination, low(record.value));
+      }
+      else if (kind == TRACE_KIND_DATA16)
+      {
+         snprintf(written, sizeof(written), "[0x%04X] = 0x%04X", record.destination, record.value);
+      }
+
+      printf("%12llu  0x%04X   %-24s %s\n", (unsigned long long)record.cycle, record.pc, text, written);
+      printed++;
+   }
+   return printed;
+}
+
+/********************************************************************************
+* trace_reader_print_state: Prints specified state with all CPU registers and
+*                           the rows of data memory that aren't cleared.
+*
+*                           - state: Reference to the state.
+********************************************************************************/
+void trace_reader_print_state(const struct trace_checkpoint* state)
+{
+   printf("--------------------------------------------------------------------------------\n");
+   printf("Clock cycle:\t\t\t\t\t%llu\n", (unsigned long long)state->cycle);
+   printf("Executed instructions:\t\t\t\t%llu\n", (unsigned long long)state->instructions);
+   printf("Program counter:\t\t\t\t0x%04X\n", state->pc);
+   printf("Stack pointer:\t\t\t\t\t0x%04X\n", state->sp);
+   printf("Status register (ISNZVC):\t\t\t0x%02X\n\n", state->sr);
+
+   for (uint8_t i = 0; i < CPU_REGISTER_ADDRESS_WIDTH; i += 8)
+   {
+      printf("R%-2u - R%-2u:", i, i + 7);
+      for (uint8_t j = i; j < i + 8; ++j) printf(" %02X", state->reg[j]);
+      printf("\n");
+   }
+
+   printf("\nData memory (cleared rows omitted):\n");
+
+   for (uint16_t i = 0; i < DATA_MEMORY_ADDRESS_WIDTH; i += 16)
+   {
+      const uint16_t end = i + 16 < DATA_MEMORY_ADDRESS_WIDTH ? i + 16 : DATA_MEMORY_ADDRESS_WIDTH;
+      bool cleared = true;
+
+      for (uint16_t j = i; j < end; ++j)
+      {
+         if (state->data[j]) cleared = false;
+      }
+
+      if (cleared) continue;
+      printf("0x%04X:", i);
+      for (uint16_t j = i; j < end; ++j) printf(" %02X", state->data[j]);
+      printf("\n");
+   }
+
+   printf("--------------------------------------------------------------------------------\n\n");
+   return;
+}
+
+/********************************************************************************
+* load_index: Loads the block index from specified index file. After success,
+*             0 is returned. If the file is missing, corrupt or was built for
+*             another trace, error code 1 is returned. The index belongs to
+*             the trace if both the size of the trace and the key of its
+*             first and last block match, see index_key, since a trace
+*             recorded again for the same number of cycles may have the
+*             same size.
+*
+*             - self      : Reference to the reader.
+*             - index_path: Path to the index file.
+*             - file_size : Size of the trace file in bytes.
+********************************************************************************/
+static int load_index(struct trace_reader* self,
+                      const char* index_path,
+                      const uint64_t file_size)
+{
+   FILE* file = fopen(index_path, "rb");
+   char magic[8];
+   uint64_t indexed_size = 0;
+   uint64_t indexed_key = 0;
+   uint64_t key = 0;
+   uint64_t num_blocks = 0;
+   int result = 1;
+
+   if (!file) return 1;
+
+   if (fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+       !memcmp(magic, TRACE_INDEX_MAGIC, sizeof(magic)) &&
+       fread(&indexed_size, sizeof(indexed_size), 1, file) == 1 &&
+       fread(&indexed_key, sizeof(indexed_key), 1, file) == 1 &&
+       fread(&num_blocks, sizeof(num_blocks), 1, file) == 1 &&
+       indexed_size == file_size && num_blocks && num_blocks < SIZE_MAX / sizeof(struct trace_block))
+   {
+      self->blocks = (struct trace_block*)malloc((size_t)num_blocks * sizeof(struct trace_block));
+
+      if (self->blocks &&
+          fread(self->blocks, sizeof(struct trace_block), (size_t)num_blocks, file) == num_blocks)
+      {
+         self->num_blocks = (size_t)num_blocks;
+         result = index_key(self, &key) || key != indexed_key;
+      }
+
+      if (result)
+      {
+         free(self->blocks);
+         self->blocks = 0;
+         self->num_blocks = 0;
+      }
+   }
+
+   fclose(file);
+   return result;
+}
+
+/********************************************************************************
+* build_index: Builds the block index by reading the header of each block.
+*              A block cut off at the end of the file, for instance if the
+*              simulator was killed, is not indexed. After success, 0 is
+*              returned. If the trace contains no complete block, error code
+*              1 is returned.
+*
+*              - self     : Reference to the reader.
+*              - file_size: Size of the trace file in bytes.
+********************************************************************************/
+static int build_index(struct trace_reader* self,
+                       const uint64_t file_size)
+{
+   size_t capacity = 0;
+   uint64_t offset = sizeof(TRACE_MAGIC) - 1 + sizeof(uint32_t);
+   uint64_t first_record = 0;
+
+   while (offset + TRACE_BLOCK_HEADER_SIZE + sizeof(struct trace_checkpoint) <= file_size)
+   {
+      struct trace_block block;
+      block.offset = offset;
+      block.first_record = first_record;
+
+      if (host_file_seek(self->file, (int64_t)offset, false) ||
+          fread(&block.records, sizeof(block.records), 1, self->file) != 1 ||
+          fread(&block.payload_size, sizeof(block.payload_size), 1, self->file) != 1 ||
+          fread(&block.cycle, sizeof(block.cycle), 1, self->file) != 1)
+      {
+         break;
+      }
+
+      offset += TRACE_BLOCK_HEADER_SIZE + sizeof(struct trace_checkpoint) + block.payload_size;
+      if (offset > file_size) break;
+
+      if (self->num_blocks == capacity)
+      {
+         const size_t new_capacity = capacity ? capacity * 2 : 1024;
+         struct trace_block* blocks = (struct trace_block*)realloc(self->blocks,
+            new_capacity * sizeof(struct trace_block));
+         if (!blocks) return 1;
+         self->blocks = blocks;
+         capacity = new_capacity;
+      }
+
+      self->blocks[self->num_blocks++] = block;
+      first_record += block.records;
+   }
+
+   return self->num_blocks == 0;
+}
+
+/********************************************************************************
+* index_key: Computes the key identifying the trace an index belongs to, an
+*            FNV-1a hash of the header and checkpoint of the first and the
+*            last indexed block as stored in the trace file. The last block
+*            differs between two traces of the same run length as soon as
+*            their states differ. After success, 0 is returned. If a block
+*            couldn't be read, error code 1 is returned.
+*
+*            - self: Reference to the reader with the block index.
+*            - key : Reference to storage for the key.
+********************************************************************************/
+static int index_key(const struct trace_reader* self,
+                     uint64_t* key)
+{
+   const size_t blocks[2] = { 0, self->num_blocks - 1 };
+   uint8_t data[TRACE_BLOCK_HEADER_SIZE + sizeof(struct trace_checkpoint)];
+   uint64_t hash = 0xcbf29ce484222325ULL;
+
+   if (!self->num_blocks) return 1;
+
+   for (size_t i = 0; i < 2; ++i)
+   {
+      if (host_file_seek(self->file, (int64_t)self->blocks[blocks[i]].offset, false) ||
+          fread(data, 1, sizeof(data), self->file) != sizeof(data))
+      {
+         return 1;
+      }
+
+      for (size_t j = 0; j < sizeof(data); ++j)
+      {
+         hash = (hash ^ data[j]) * 0x100000001b3ULL;
+      }
+   }
+
+   *key = hash;
+   return 0;
+}
+
+/********************************************************************************
+* save_index: Writes the block index to specified index file, so that it
+*             doesn't need to be built the next time. Failure to write the
+*             index is ignored, since it's only used to speed up opening.
+*
+*             - self      : Reference to the reader.
+*             - index_path: Path to the index file.
+*             - file_size : Size of the trace file in bytes.
+********************************************************************************/
+static void save_index(const struct trace_reader* self,
+                       const char* index_path,
+                       const uint64_t file_size)
+{
+   const uint64_t num_blocks = self->num_blocks;
+   uint64_t key;
+   FILE* file;
+
+   if (index_key(self, &key)) return;
+   file = fopen(index_path, "wb");
+   if (!file) return;
+
+   fwrite(TRACE_INDEX_MAGIC, 1, sizeof(TRACE_INDEX_MAGIC) - 1, file);
+   fwrite(&file_size, sizeof(file_size), 1, file);
+   fwrite(&key, sizeof(key), 1, file);
+   fwrite(&num_blocks, sizeof(num_blocks), 1, file);
+   fwrite(self->blocks, sizeof(struct trace_block), self->num_blocks, file);
+   fclose(file);
+   return;
+}
+
+/********************************************************************************
+* find_block_from: Returns the index of the block containing the state at
+*                  specified clock cycle, searching from specified block. The
+*                  checkpoints of a segment are in ascending order, so the
+*                  segment containing the cycle is found by stepping over
+*                  segments and the block by binary search within it.
+*
+*                  - self : Reference to the reader.
+*                  - cycle: The clock cycle to find.
+*                  - first: Index of the first block to search.
+********************************************************************************/
+static size_t find_block_from(const struct trace_reader* self,
+                              const uint64_t cycle,
+                              size_t first)
+{
+   while (first < self->num_blocks)
+   {
+      size_t end = first + 1;
+      while (end < self->num_blocks && !starts_segment(self, end)) end++;
+
+      if (self->blocks[first].cycle <= cycle)
+      {
+         size_t low = first;
+         size_t high = end - 1;
+
+         while (low < high)
+         {
+            const size_t middle = low + (high - low + 1) / 2;
+            if (self->blocks[middle].cycle <= cycle) low = middle;
+            else high = middle - 1;
+         }
+         return low;
+      }
+      first = end;
+   }
+   return self->num_blocks;
+}
+
+/********************************************************************************
+* starts_segment: Indicates if specified block starts a new segment, which is
+*                 the case when its checkpoint doesn't come after the
+*                 checkpoint of the previous block.
+*
+*                 - self : Reference to the reader.
+*                 - block: Index of the block.
+********************************************************************************/
+static inline bool starts_segment(const struct trace_reader* self,
+                                  const size_t block)
+{
+   return block == 0 || self->blocks[block].cycle <= self->blocks[block - 1].cycle;
+}
+
+/********************************************************************************
+* decode: Decodes the next record of the loaded block, see trace.c for the
+*         encoding. After success, 0 is returned. If the payload ends before
+*         the record, error code 1 is returned.
+*
+*         - self  : Reference to the reader.
+*         - record: Reference to storage for the record.
+********************************************************************************/
+static int decode(struct trace_reader* self,
+                  struct trace_record* record)
+{
+   const uint32_t payload_size = self->blocks[self->block].payload_size;
+   const struct trace_record* previous = &self->previous;
+   uint64_t value;
+   uint8_t flags;
+
+   if (self->position >= payload_size) return 1;
+   flags = self->payload[self->position++];
+   *record = *previous;
+   record->kind = flags & (TRACE_KIND_MASK | TRACE_FLAG_INTERRUPT);
+
+   if (read_varint(self, &value)) return 1;
+   record->cycle = previous->cycle + value;
+
+   if (flags & TRACE_FLAG_JUMP)
+   {
+      if (read_varint(self, &value)) return 1;
+      record->pc = (uint16_t)(previous->pc + unzigzag(value));
+   }
+   else
+   {
+      record->pc = previous->pc + 1;
+   }
+
+   if (read_varint(self, &value)) return 1;
+   record->instruction = (uint32_t)value;
+
+   if (flags & TRACE_FLAG_SR)
+   {
+      if (self->position >= payload_size) return 1;
+      record->sr = self->payload[self->position++];
+   }
+
+   if (flags & TRACE_FLAG_SP)
+   {
+      if (read_varint(self, &value)) return 1;
+      record->sp = (uint16_t)(previous->sp + unzigzag(value));
+   }
+
+   record->destination = 0;
+   record->value = 0;
+
+   if ((flags & TRACE_KIND_MASK) != TRACE_KIND_NONE)
+   {
+      const uint32_t value_size = (flags & TRACE_KIND_MASK) == TRACE_KIND_DATA16 ? 2 : 1;
+      if (read_varint(self, &value)) return 1;
+      record->destination = (uint16_t)value;
+
+      if (self->position + value_size > payload_size) return 1;
+      for (uint32_t i = 0; i < value_size; ++i)
+      {
+         record->value = (record->value << 8) | self->payload[self->position++];
+      }
+   }
+
+   self->record++;
+   self->previous = *record;
+   return 0;
+}
+
+/********************************************************************************
+* read_varint: Reads a varint from the payload of the loaded block. After
+*              success, 0 is returned. If the payload ends before the varint,
+*              error code 1 is returned.
+*
+*              - self : Reference to the reader.
+*              - value: Reference to storage for the value.
+********************************************************************************/
+static int read_varint(struct trace_reader* self,
+                       uint64_t* value)
+{
+   const uint32_t payload_size = self->blocks[self->block].payload_size;
+   const size_t size = trace_decode_varint(self->payload + self->position,
+                                           payload_size - self->position, value);
+   self->position += (uint32_t)size;
+   return size == 0;
+}
+
+/********************************************************************************
+* unzigzag: Maps a zigzag encoded value back to the signed value, see trace.c.
+*
+*           - value: The encoded value.
+********************************************************************************/
+static inline int64_t unzigzag(const uint64_t value)
+{
+   return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/********************************************************************************
+* record_writes: Indicates if specified record writes specified data memory
+*                address.
+*
+*                - record : Reference to the record.
+*                - address: The data memory address.
+********************************************************************************/
+static bool record_writes(const struct trace_record* record,
+                          const uint64_t address)
+{
+   switch (record->kind & TRACE_KIND_MASK)
+   {
+   case TRACE_KIND_DATA:
+      return record->destination == address;
+   case TRACE_KIND_DATA16:
+      return record->destination == address || (uint64_t)record->destination + 1 == address;
+   default:
+      return false;
+   }
+}
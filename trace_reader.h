@@ -0,0 +1,173 @@
+/********************************************************************************
+* trace_reader.h: Contains definitions and function declarations for reading
+*                 binary execution traces written by trace.h.
+*
+*                 When a trace is opened, an index of its blocks is loaded
+*                 from the file <trace>.idx, or built from the block headers
+*                 and saved there if the index file is missing or belongs to
+*                 a trace of another size. Since each block starts with a
+*                 checkpoint, a position in the trace is reached by decoding
+*                 a single block, regardless of the size of the trace.
+*
+*                 Traces of a run containing resets consist of several
+*                 segments, since the clock cycle restarts from 0 after each
+*                 reset. Seeking by clock cycle stops at the first segment
+*                 reaching the cycle.
+********************************************************************************/
+#ifndef TRACE_READER_H_
+#define TRACE_READER_H_
+
+/* Include directives: */
+#include "trace.h"
+
+/* Macro definitions: */
+#define TRACE_INDEX_MAGIC  "AVRIDX02" /* Identifies a trace index file (8 characters). */
+#define TRACE_READER_NONE  UINT64_MAX /* Unused limit in a trace filter. */
+
+/********************************************************************************
+* trace_block: Structure for the index entry of a block in a trace file.
+********************************************************************************/
+struct trace_block
+{
+   uint64_t offset;       /* Position of the block header in the trace file. */
+   uint64_t first_record; /* Number of records in the trace before the block. */
+   uint64_t cycle;        /* Clock cycle of the checkpoint starting the block. */
+   uint32_t records;      /* Number of records in the block. */
+   uint32_t payload_size; /* Number of bytes of encoded records. */
+};
+
+/********************************************************************************
+* trace_reader: Structure for reading a trace file record by record.
+********************************************************************************/
+struct trace_reader
+{
+   FILE* file;                         /* The trace file. */
+   struct trace_block* blocks;         /* Index of all blocks in the trace. */
+   size_t num_blocks;                  /* Number of blocks in the trace. */
+   uint64_t num_records;               /* Number of records in the trace. */
+   size_t block;                       /* Index of the loaded block, num_blocks if none. */
+   struct trace_checkpoint checkpoint; /* Checkpoint of the loaded block. */
+   uint8_t* payload;                   /* Encoded records of the loaded block. */
+   uint32_t position;                  /* Position of the next record in the payload. */
+   uint32_t record;                    /* Number of records decoded in the loaded block. */
+   struct trace_record previous;       /* Last decoded record. */
+};
+
+/********************************************************************************
+* trace_filter: Structure for selection of records to print. Limits set to
+*               TRACE_READER_NONE are not used.
+********************************************************************************/
+struct trace_filter
+{
+   uint64_t first_cycle; /* Records before this clock cycle are skipped. */
+   uint64_t last_cycle;  /* Printing stops after this clock cycle. */
+   uint64_t first_pc;    /* Lowest address of printed instructions. */
+   uint64_t last_pc;     /* Highest address of printed instructions. */
+   uint64_t address;     /* Only records writing this data memory address are printed. */
+};
+
+/********************************************************************************
+* trace_reader_open: Opens specified trace file and loads or builds its block
+*                    index. After success, 0 is returned. If the file couldn't
+*                    be opened or isn't a valid trace, error code 1 is
+*                    returned.
+*
+*                    - self: Reference to the reader.
+*                    - path: Path to the trace file.
+********************************************************************************/
+int trace_reader_open(struct trace_reader* self,
+                      const char* path);
+
+/********************************************************************************
+* trace_reader_close: Closes the trace file and frees the index.
+*
+*                     - self: Reference to the reader.
+********************************************************************************/
+void trace_reader_close(struct trace_reader* self);
+
+/********************************************************************************
+* trace_reader_find_block: Returns the index of the block with the last
+*                          checkpoint at or before specified clock cycle,
+*                          within the first segment starting at or before
+*                          the cycle. If no segment starts at or before the
+*                          cycle, the number of blocks is returned.
+*
+*                          - self : Reference to the reader.
+*                          - cycle: The clock cycle to find.
+********************************************************************************/
+size_t trace_reader_find_block(const struct trace_reader* self,
+                               const uint64_t cycle);
+
+/********************************************************************************
+* trace_reader_seek_block: Loads specified block, so that the next record read
+*                          is the first record of the block. After success, 0
+*                          is returned. If the block doesn't exist or couldn't
+*                          be read, error code 1 is returned.
+*
+*                          - self : Reference to the reader.
+*                          - block: Index of the block.
+********************************************************************************/
+int trace_reader_seek_block(struct trace_reader* self,
+                            const size_t block);
+
+/********************************************************************************
+* trace_reader_next: Reads the next record, continuing with the next block at
+*                    the end of the loaded block. After success, 0 is
+*                    returned. At the end of the trace, or if the trace is
+*                    corrupt, 1 is returned.
+*
+*                    - self  : Reference to the reader.
+*                    - record: Reference to storage for the record.
+********************************************************************************/
+int trace_reader_next(struct trace_reader* self,
+                      struct trace_record* record);
+
+/********************************************************************************
+* trace_reader_apply: Updates specified state with the effect of a record.
+*                     The program counter is set to the address following
+*                     the instruction, or to the vector of an interrupt.
+*
+*                     - state : Reference to the state.
+*                     - record: Reference to the record.
+********************************************************************************/
+void trace_reader_apply(struct trace_checkpoint* state,
+                        const struct trace_record* record);
+
+/********************************************************************************
+* trace_reader_state: Reconstructs the machine state after all instructions
+*                     completed at or before specified clock cycle, by
+*                     applying the records of one block to its checkpoint.
+*                     The program counter is the address of the next
+*                     instruction, as far as known from the trace. After
+*                     success, 0 is returned. If the trace doesn't reach the
+*                     cycle, error code 1 is returned.
+*
+*                     - self : Reference to the reader.
+*                     - cycle: The clock cycle.
+*                     - state: Reference to storage for the state.
+********************************************************************************/
+int trace_reader_state(struct trace_reader* self,
+                       const uint64_t cycle,
+                       struct trace_checkpoint* state);
+
+/********************************************************************************
+* trace_reader_print: Prints the records selected by specified filter, one
+*                     line per record with the disassembled instruction and
+*                     the written location. The number of printed records
+*                     is returned.
+*
+*                     - self  : Reference to the reader.
+*                     - filter: Reference to the filter.
+********************************************************************************/
+uint64_t trace_reader_print(struct trace_reader* self,
+                            const struct trace_filter* filter);
+
+/********************************************************************************
+* trace_reader_print_state: Prints specified state with all CPU registers and
+*                           the rows of data memory that aren't cleared.
+*
+*                           - state: Reference to the state.
+********************************************************************************/
+void trace_reader_print_state(const struct trace_checkpoint* state);
+
+#endif /* TRACE_READER_H_ */
@@ -0,0 +1,439 @@
+/********************************************************************************
+* uart.c: Contains static variables and function definitions for
+*         implementation of a UART with buffered host-side streaming.
+*         Frame timing is modelled via the event queue: a transmitted byte
+*         occupies the transmit shift register for one frame time, after
+*         which the next byte is moved from the data register, and received
+*         bytes arrive one frame time apart.
+********************************************************************************/
+#include "uart.h"
+#include "control_unit.h"
+#include "event_queue.h"
+#include "ring_buffer.h"
+#include "host.h"
+#include <string.h>
+
+/* Macro definitions: */
+#define UART_WRITE_CHUNK 4096 /* Max number of bytes written to the host per call. */
+
+/* Static variables: */
+static uint8_t ucsr0a;         /* Control and status register A. */
+static uint8_t ucsr0b;         /* Control and status register B. */
+static uint16_t ubrr;          /* Baud rate register (12 bits). */
+static uint8_t rx_data;        /* Receive data register, read via UDR0. */
+static uint8_t tx_data;        /* Transmit data register, waiting for the shift register. */
+static bool tx_busy;           /* Indicates if the transmit shift register is busy. */
+static bool interrupt_pending; /* Indicates if an enabled UART interrupt flag is set. */
+
+static FILE* input;                  /* File feeding the receiver, null if none. */
+static FILE* output;                 /* File written by the host thread, null if none. */
+static struct ring_buffer tx_buffer; /* Transmitted bytes not yet written to the host. */
+static struct host_thread writer;    /* Host thread writing transmitted bytes. */
+static volatile size_t writer_stop;  /* Set to stop the host thread when the buffer is empty. */
+
+/* Static functions: */
+static inline uint64_t frame_cycles(void);
+static void start_transmission(const uint8_t value,
+                               const uint64_t cycle);
+static void transmission_complete(const uint64_t cycle,
+                                  const uint32_t arg);
+static void byte_received(const uint64_t cycle,
+                          const uint32_t arg);
+static void refresh(void);
+static uint8_t write_register(const uint16_t address,
+                              const uint8_t value);
+static uint8_t read_register(const uint16_t address,
+                             const uint8_t value);
+static void writer_run(void* arg);
+
+/********************************************************************************
+* uart_reset: Resets the UART registers, cancels frames in progress and
+*             attaches the UART registers to the I/O space of data memory.
+*             Opened host streams are kept. The event queue must be reset
+*             before the UART.
+********************************************************************************/
+void uart_reset(void)
+{
+   static const uint8_t registers[] = { UDR0, UCSR0A, UCSR0B, UBRR0L, UBRR0H };
+
+   event_queue_cancel(transmission_complete, 0);
+   event_queue_cancel(byte_received, 0);
+
+   ucsr0a = (1 << UDRE0);
+   ucsr0b = 0x00;
+   ubrr = 0;
+   rx_data = 0x00;
+   tx_data = 0x00;
+   tx_busy = false;
+   refresh();
+
+   for (size_t i = 0; i < sizeof(registers); ++i)
+   {
+      data_memory_set_io_hooks(registers[i], write_register, read_register);
+   }
+   return;
+}
+
+/********************************************************************************
+* uart_open_output: Directs transmitted bytes to specified file, or to stdout
+*                   if a null pointer or "-" is specified, and starts the host
+*                   thread writing them. After success, 0 is returned. If the
+*                   file couldn't be opened, error code 1 is returned.
+*
+*                   - path: Path to the output file, or null for stdout.
+********************************************************************************/
+int uart_open_output(const char* path)
+{
+   FILE* file = stdout;
+
+   if (path && strcmp(path, "-"))
+   {
+      file = fopen(path, "wb");
+      if (!file) return 1;
+   }
+
+   if (writer.running)
+   {
+      host_atomic_store(&writer_stop, 1);
+      host_thread_join(&writer);
+      if (output != stdout) fclose(output);
+   }
+
+   if (!tx_buffer.data && ring_buffer_init(&tx_buffer, UART_BUFFER_SIZE))
+   {
+      if (file != stdout) fclose(file);
+      return 1;
+   }
+
+   output = file;
+   host_atomic_store(&writer_stop, 0);
+   return host_thread_start(&writer, writer_run, 0);
+}
+
+/********************************************************************************
+* uart_open_input: Feeds the receiver with bytes read from specified file,
+*                  or stdin if "-" is specified. After success, 0 is returned.
+*                  If the file couldn't be opened, error code 1 is returned.
+*
+*                  - path: Path to the input file.
+********************************************************************************/
+int uart_open_input(const char* path)
+{
+   FILE* file = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+   if (!file) return 1;
+
+   if (input && input != stdin) fclose(input);
+   input = file;
+
+   event_queue_cancel(byte_received, 0);
+   if (read(ucsr0b, RXEN0))
+   {
+      event_queue_schedule(control_unit_cycle_count() + frame_cycles(), byte_received, 0);
+   }
+   return 0;
+}
+
+/********************************************************************************
+* uart_close: Writes all transmitted bytes, stops the host thread and closes
+*             the opened files.
+********************************************************************************/
+void uart_close(void)
+{
+   if (writer.running)
+   {
+      host_atomic_store(&writer_stop, 1);
+      host_thread_join(&writer);
+   }
+
+   if (output && output != stdout) fclose(output);
+   if (input && input != stdin) fclose(input);
+   output = 0;
+   input = 0;
+   ring_buffer_clear(&tx_buffer);
+   return;
+}
+
+/********************************************************************************
+* uart_interrupt_pending: Indicates if any UART interrupt flag is set while
+*                         the corresponding interrupt is enabled.
+********************************************************************************/
+bool uart_interrupt_pending(void)
+{
+   return interrupt_pending;
+}
+
+/********************************************************************************
+* uart_acknowledge_interrupt: Returns the interrupt vector of the pending UART
+*                             interrupt with highest priority. The transmit
+*                             complete flag is cleared when its interrupt is
+*                             entered, whereas the receive complete and data
+*                             register empty flags are cleared by reading and
+*                             writing UDR0, as on ATmega328P. If no UART
+*                             interrupt is pending, RESET_vect is returned.
+********************************************************************************/
+uint8_t uart_acknowledge_interrupt(void)
+{
+   uint8_t vector = RESET_vect;
+
+   if (read(ucsr0a, RXC0) && read(ucsr0b, RXCIE0))
+   {
+      vector = USART_RX_vect;
+   }
+   else if (read(ucsr0a, UDRE0) && read(ucsr0b, UDRIE0))
+   {
+      vector = USART_UDRE_vect;
+   }
+   else if (read(ucsr0a, TXC0) && read(ucsr0b, TXCIE0))
+   {
+      clr(ucsr0a, TXC0);
+      vector = USART_TX_vect;
+   }
+
+   refresh();
+   return vector;
+}
+
+/********************************************************************************
+* frame_cycles: Returns the number of clock cycles per frame for the current
+*               baud rate setting (16 clock cycles per bit and UBRR step).
+********************************************************************************/
+static inline uint64_t frame_cycles(void)
+{
+   return (uint64_t)UART_FRAME_BITS * 16 * (ubrr + 1);
+}
+
+/********************************************************************************
+* start_transmission: Moves specified byte to the transmit shift register,
+*                     passes it to the host thread and schedules the end of
+*                     the frame. If the ring buffer is full, the CPU thread
+*                     waits for the host thread to catch up.
+*
+*                     - value: The byte to transmit.
+*                     - cycle: The clock cycle at which the frame starts.
+********************************************************************************/
+static void start_transmission(const uint8_t value,
+                               const uint64_t cycle)
+{
+   if (!writer.running) uart_open_output(0);
+
+   while (ring_buffer_write(&tx_buffer, &value, 1))
+   {
+      host_sleep_ms(1);
+   }
+
+   tx_busy = true;
+   event_queue_schedule(cycle + frame_cycles(), transmission_complete, 0);
+   return;
+}
+
+/********************************************************************************
+* transmission_complete: Event handler called at the end of a transmitted
+*                        frame. A byte waiting in the data register is moved
+*                        to the shift register, otherwise the transmit
+*                        complete flag is set.
+*
+*                        - cycle: The clock cycle at which the frame ended.
+*                        - arg  : Not used.
+********************************************************************************/
+static void transmission_complete(const uint64_t cycle,
+                                  const uint32_t arg)
+{
+   (void)arg;
+   if (!read(ucsr0a, UDRE0))
+   {
+      set(ucsr0a, UDRE0);
+      start_transmission(tx_data, cycle);
+   }
+   else
+   {
+      tx_busy = false;
+      set(ucsr0a, TXC0);
+   }
+
+   refresh();
+   return;
+}
+
+/********************************************************************************
+* byte_received: Event handler called when a frame has been received. The
+*                next byte is read from the input file and placed in the
+*                receive data register, unless the previous byte hasn't been
+*                read yet, in which case the data overrun flag is set.
+*                The next frame is scheduled until the end of the file.
+*
+*                - cycle: The clock cycle at which the frame was received.
+*                - arg  : Not used.
+********************************************************************************/
+static void byte_received(const uint64_t cycle,
+                          const uint32_t arg)
+{
+   (void)arg;
+   const int c = input ? fgetc(input) : EOF;
+   if (c == EOF || !read(ucsr0b, RXEN0)) return;
+
+   if (read(ucsr0a, RXC0))
+   {
+      set(ucsr0a, DOR0);
+   }
+   else
+   {
+      rx_data = (uint8_t)c;
+      set(ucsr0a, RXC0);
+   }
+
+   event_queue_schedule(cycle + frame_cycles(), byte_received, 0);
+   refresh();
+   return;
+}
+
+/********************************************************************************
+* refresh: Updates the indication of pending UART interrupts.
+********************************************************************************/
+static void refresh(void)
+{
+   interrupt_pending = (read(ucsr0a, RXC0) && read(ucsr0b, RXCIE0)) ||
+                       (read(ucsr0a, UDRE0) && read(ucsr0b, UDRIE0)) ||
+                       (read(ucsr0a, TXC0) && read(ucsr0b, TXCIE0));
+   return;
+}
+
+/********************************************************************************
+* write_register: Hook for writes to the UART registers. A write to UDR0
+*                 starts a transmission if the transmitter is enabled and the
+*                 data register is empty, otherwise the byte is ignored. The
+*                 transmit complete flag is cleared by writing a one to it.
+*                 Enabling the receiver starts reception from the input file.
+*
+*                 - address: The written UART register.
+*                 - value  : The value written by the CPU.
+********************************************************************************/
+static uint8_t write_register(const uint16_t address,
+                              const uint8_t value)
+{
+   const uint64_t cycle = control_unit_cycle_count();
+
+   switch (address)
+   {
+      case UDR0:
+      {
+         if (read(ucsr0b, TXEN0) && read(ucsr0a, UDRE0))
+         {
+            if (tx_busy)
+            {
+               tx_data = value;
+               clr(ucsr0a, UDRE0);
+            }
+            else
+            {
+               start_transmission(value, cycle);
+            }
+         }
+         break;
+      }
+      case UCSR0A:
+      {
+         if (read(value, TXC0)) clr(ucsr0a, TXC0);
+         break;
+      }
+      case UCSR0B:
+      {
+         const bool receiver_enabled = read(ucsr0b, RXEN0);
+         ucsr0b = value;
+
+         if (read(value, RXEN0) && !receiver_enabled && input)
+         {
+            event_queue_schedule(cycle + frame_cycles(), byte_received, 0);
+         }
+         else if (!read(value, RXEN0))
+         {
+            event_queue_cancel(byte_received, 0);
+            clr(ucsr0a, RXC0);
+         }
+         break;
+      }
+      case UBRR0L:
+      {
+         ubrr = (ubrr & 0x0F00) | value;
+         break;
+      }
+      case UBRR0H:
+      {
+         ubrr = ((value & 0x0F) << 8) | (ubrr & 0x00FF);
+         break;
+      }
+      default:
+      {
+         break;
+      }
+   }
+
+   refresh();
+   return address == UCSR0A ? ucsr0a : value;
+}
+
+/********************************************************************************
+* read_register: Hook for reads of the UART registers. Reading UDR0 returns
+*                the received byte and clears the receive complete and data
+*                overrun flags.
+*
+*                - address: The read UART register.
+*                - value  : The value stored at the address.
+********************************************************************************/
+static uint8_t read_register(const uint16_t address,
+                             const uint8_t value)
+{
+   switch (address)
+   {
+      case UDR0:
+      {
+         clr(ucsr0a, RXC0);
+         clr(ucsr0a, DOR0);
+         refresh();
+         return rx_data;
+      }
+      case UCSR0A:
+      {
+         return ucsr0a;
+      }
+      default:
+      {
+         return value;
+      }
+   }
+}
+
+/********************************************************************************
+* writer_run: Runs the host thread, which writes transmitted bytes from the
+*             ring buffer to the output file in batches. The output is
+*             flushed whenever the buffer runs empty. The thread finishes
+*             when stopped and all bytes have been written.
+*
+*             - arg: Not used.
+********************************************************************************/
+static void writer_run(void* arg)
+{
+   uint8_t chunk[UART_WRITE_CHUNK];
+   (void)arg;
+
+   while (1)
+   {
+      const size_t size = ring_buffer_read(&tx_buffer, chunk, sizeof(chunk));
+
+      if (size)
+      {
+         fwrite(chunk, 1, size, output);
+      }
+      else if (host_atomic_load(&writer_stop) && !ring_buffer_used(&tx_buffer))
+      {
+         break;
+      }
+      else
+      {
+         fflush(output);
+         host_sleep_ms(1);
+      }
+   }
+
+   fflush(output);
+   return;
+}
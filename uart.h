@@ -0,0 +1,70 @@
+/********************************************************************************
+* uart.h: Contains function declarations for implementation of a UART
+*         (USART0 in asynchronous mode, 8N1), controlled via the I/O
+*         registers UDR0, UCSR0A, UCSR0B and UBRR0. Transmitted bytes are
+*         put in a lock-free ring buffer, which is drained to a file or
+*         stdout by a host thread, so the CPU never waits for host I/O.
+*         Received bytes are read from a file, one byte per frame time.
+********************************************************************************/
+#ifndef UART_H_
+#define UART_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "data_memory.h"
+
+/* Macro definitions: */
+#define UART_BUFFER_SIZE 65536 /* Capacity in bytes of the transmit ring buffer. */
+#define UART_FRAME_BITS  10    /* Start bit, 8 data bits and a stop bit per frame. */
+
+/********************************************************************************
+* uart_reset: Resets the UART registers, cancels frames in progress and
+*             attaches the UART registers to the I/O space of data memory.
+*             Opened host streams are kept. The event queue must be reset
+*             before the UART.
+********************************************************************************/
+void uart_reset(void);
+
+/********************************************************************************
+* uart_open_output: Directs transmitted bytes to specified file, or to stdout
+*                   if a null pointer or "-" is specified, and starts the host
+*                   thread writing them. After success, 0 is returned. If the
+*                   file couldn't be opened, error code 1 is returned.
+*
+*                   - path: Path to the output file, or null for stdout.
+********************************************************************************/
+int uart_open_output(const char* path);
+
+/********************************************************************************
+* uart_open_input: Feeds the receiver with bytes read from specified file,
+*                  or stdin if "-" is specified. After success, 0 is returned.
+*                  If the file couldn't be opened, error code 1 is returned.
+*
+*                  - path: Path to the input file.
+********************************************************************************/
+int uart_open_input(const char* path);
+
+/********************************************************************************
+* uart_close: Writes all transmitted bytes, stops the host thread and closes
+*             the opened files.
+********************************************************************************/
+void uart_close(void);
+
+/********************************************************************************
+* uart_interrupt_pending: Indicates if any UART interrupt flag is set while
+*                         the corresponding interrupt is enabled.
+********************************************************************************/
+bool uart_interrupt_pending(void);
+
+/********************************************************************************
+* uart_acknowledge_interrupt: Returns the interrupt vector of the pending UART
+*                             interrupt with highest priority. The transmit
+*                             complete flag is cleared when its interrupt is
+*                             entered, whereas the receive complete and data
+*                             register empty flags are cleared by reading and
+*                             writing UDR0, as on ATmega328P. If no UART
+*                             interrupt is pending, RESET_vect is returned.
+********************************************************************************/
+uint8_t uart_acknowledge_interrupt(void);
+
+#endif /* UART_H_ */
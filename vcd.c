@@ -0,0 +1,382 @@
+/********************************************************************************
+* vcd.c: Contains static variables and function definitions for recording of
+*        the I/O ports to a value change dump (VCD) file. Each port is dumped
+*        both as an 8-bit vector and as one wire per pin, where only the pins
+*        that changed are written.
+********************************************************************************/
+#include "vcd.h"
+#include "control_unit.h"
+#include "ring_buffer.h"
+#include "host.h"
+#include <string.h>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+/* Macro definitions: */
+#define VCD_NUM_PORTS      3                                    /* PORTB, PORTC and PORTD. */
+#define VCD_PS_PER_CYCLE   (1000000000000ULL / CPU_CLOCK_FREQUENCY) /* Picoseconds per clock cycle. */
+#define VCD_CHANGES_CHUNK  256                                  /* Max number of changes formatted per batch. */
+#define VCD_FIRST_ID       '!'                                  /* First printable VCD identifier code. */
+
+/********************************************************************************
+* vcd_change: Structure for a recorded change of a port.
+********************************************************************************/
+struct vcd_change
+{
+   uint64_t cycle;    /* Clock cycle at which the port was written. */
+   uint8_t port;      /* Index of the port, 0 = PORTB, 1 = PORTC, 2 = PORTD. */
+   uint8_t value;     /* New value of the port. */
+   uint8_t previous;  /* Previous value of the port. */
+   uint8_t padding[5];
+};
+
+/* Static variables: */
+static const uint8_t ports[VCD_NUM_PORTS] = { PORTB, PORTC, PORTD };
+static const char* const port_names[VCD_NUM_PORTS] = { "PORTB", "PORTC", "PORTD" };
+
+static uint8_t last_values[VCD_NUM_PORTS]; /* Last recorded value per port. */
+static FILE* output;                       /* The VCD file, null if not recording. */
+static bool piped;                         /* Indicates if the output is piped through gzip. */
+static struct ring_buffer changes;         /* Recorded changes not yet written. */
+static struct host_thread writer;          /* Host thread writing the VCD file. */
+static volatile size_t writer_stop;        /* Set to stop the host thread when the buffer is empty. */
+static uint64_t time_offset;               /* Cycles elapsed before the last reset of the control unit. */
+static uint64_t last_cycle;                /* Cycle of the last written timestamp, used by the host thread. */
+
+/* Static functions: */
+static inline char identifier(const uint8_t port,
+                              const int bit);
+static int quote_path(const char* path,
+                      char* buffer,
+                      const size_t size);
+static void write_header(void);
+static void write_change(const struct vcd_change* change);
+static void record(const uint8_t port,
+                   const uint8_t value,
+                   const uint64_t cycle);
+static uint8_t write_port(const uint16_t address,
+                          const uint8_t value);
+static void writer_run(void* arg);
+
+/********************************************************************************
+* vcd_open: Starts recording of the I/O ports to specified file. If the file
+*           name ends with ".gz", the output is compressed by piping it
+*           through gzip on the host. The current port values are dumped as
+*           initial values. After success, 0 is returned. If the file couldn't
+*           be opened or recording is already in progress, error code 1 is
+*           returned.
+*
+*           - path: Path to the VCD file.
+********************************************************************************/
+int vcd_open(const char* path)
+{
+   const size_t length = strlen(path);
+   if (output) return 1;
+
+   piped = length > 3 && !strcmp(path + length - 3, ".gz");
+
+   if (piped)
+   {
+      char quoted[512];
+      char command[sizeof(quoted) + 16];
+
+      if (quote_path(path, quoted, sizeof(quoted))) return 1;
+      snprintf(command, sizeof(command), "gzip -c > %s", quoted);
+      output = popen(command, "w");
+   }
+   else
+   {
+      output = fopen(path, "w");
+   }
+
+   if (!output) return 1;
+   time_offset = 0;
+   last_cycle = UINT64_MAX;
+
+   if (ring_buffer_init(&changes, VCD_BUFFER_SIZE))
+   {
+      vcd_close();
+      return 1;
+   }
+
+   for (uint8_t i = 0; i < VCD_NUM_PORTS; ++i)
+   {
+      last_values[i] = data_memory_read(ports[i]);
+      data_memory_set_io_hooks(ports[i], write_port, 0);
+   }
+
+   write_header();
+   host_atomic_store(&writer_stop, 0);
+
+   if (host_thread_start(&writer, writer_run, 0))
+   {
+      vcd_close();
+      return 1;
+   }
+   return 0;
+}
+
+/********************************************************************************
+* vcd_reset: Records that all ports are cleared by a reset of the control unit
+*            and accumulates the elapsed cycles, so that the timestamps keep
+*            increasing when the cycle counter restarts from zero. Must be
+*            called before the cycle counter is cleared.
+********************************************************************************/
+void vcd_reset(void)
+{
+   if (!output) return;
+   time_offset += control_unit_cycle_count();
+
+   for (uint8_t i = 0; i < VCD_NUM_PORTS; ++i)
+   {
+      if (last_values[i]) record(i, 0x00, time_offset);
+   }
+   return;
+}
+
+/********************************************************************************
+* vcd_close: Writes all recorded changes, stops the host thread, closes the
+*            file and detaches the recorder from the I/O ports.
+********************************************************************************/
+void vcd_close(void)
+{
+   if (!output) return;
+
+   for (uint8_t i = 0; i < VCD_NUM_PORTS; ++i)
+   {
+      data_memory_set_io_hooks(ports[i], 0, 0);
+   }
+
+   if (writer.running)
+   {
+      host_atomic_store(&writer_stop, 1);
+      host_thread_join(&writer);
+   }
+
+   fprintf(output, "#%llu\n", (unsigned long long)((time_offset + control_unit_cycle_count()) * VCD_PS_PER_CYCLE));
+
+   if (piped) pclose(output);
+   else fclose(output);
+
+   output = 0;
+   ring_buffer_clear(&changes);
+   return;
+}
+
+/********************************************************************************
+* identifier: Returns the VCD identifier code of specified port signal.
+*
+*             - port: Index of the port.
+*             - bit : Pin number of the wire, or -1 for the 8-bit vector.
+********************************************************************************/
+static inline char identifier(const uint8_t port,
+                              const int bit)
+{
+   return (char)(VCD_FIRST_ID + port * 9 + bit + 1);
+}
+
+/********************************************************************************
+* quote_path: Writes specified path quoted for the host shell to specified
+*             buffer, so that it's passed to gzip as a single word without
+*             any expansion. On POSIX hosts, the path is put in single quotes
+*             with each single quote written as '\''. On Windows, where cmd
+*             expands %variables% even within double quotes, paths containing
+*             double quotes or percent signs are rejected. After success, 0
+*             is returned. If the path can't be quoted or the quoted path
+*             doesn't fit in the buffer, error code 1 is returned.
+*
+*             - path  : The path to quote.
+*             - buffer: Reference to the buffer for the quoted path.
+*             - size  : The size of the buffer in bytes.
+********************************************************************************/
+static int quote_path(const char* path,
+                      char* buffer,
+                      const size_t size)
+{
+#ifdef _WIN32
+   const size_t length = strlen(path);
+   if (strchr(path, '"') || strchr(path, '%') || length + 3 > size) return 1;
+   snprintf(buffer, size, "\"%s\"", path);
+   return 0;
+#else
+   size_t length = 0;
+
+   if (size < 3) return 1;
+   buffer[length++] = '\'';
+
+   for (const char* c = path; *c; ++c)
+   {
+      if (*c == '\'')
+      {
+         if (length + 4 >= size - 1) return 1;
+         memcpy(buffer + length, "'\\''", 4);
+         length += 4;
+      }
+      else
+      {
+         if (length + 1 >= size - 1) return 1;
+         buffer[length++] = *c;
+      }
+   }
+
+   buffer[length++] = '\'';
+   buffer[length] = '\0';
+   return 0;
+#endif
+}
+
+/********************************************************************************
+* write_header: Writes the VCD header with declarations of all signals and
+*               the initial port values. The timescale is picoseconds, so
+*               that clock cycles at the simulated frequency convert exactly.
+********************************************************************************/
+static void write_header(void)
+{
+   fprintf(output, "$comment ATmega328P-based CPU simulator, %d Hz clock $end\n", CPU_CLOCK_FREQUENCY);
+   fprintf(output, "$timescale 1ps $end\n");
+   fprintf(output, "$scope module cpu $end\n");
+
+   for (uint8_t i = 0; i < VCD_NUM_PORTS; ++i)
+   {
+      fprintf(output, "$var wire 8 %c %s [7:0] $end\n", identifier(i, -1), port_names[i]);
+      for (int bit = 0; bit < 8; ++bit)
+      {
+         fprintf(output, "$var wire 1 %c %s%d $end\n", identifier(i, bit), port_names[i], bit);
+      }
+   }
+
+   fprintf(output, "$upscope $end\n$enddefinitions $end\n");
+   fprintf(output, "#%llu\n$dumpvars\n", (unsigned long long)(control_unit_cycle_count() * VCD_PS_PER_CYCLE));
+
+   for (uint8_t i = 0; i < VCD_NUM_PORTS; ++i)
+   {
+      fprintf(output, "b%s %c\n", cpu_binary_byte(last_values[i]), identifier(i, -1));
+      for (int bit = 0; bit < 8; ++bit)
+      {
+         fprintf(output, "%c%c\n", read(last_values[i], bit) ? '1' : '0', identifier(i, bit));
+      }
+   }
+
+   fprintf(output, "$end\n");
+   return;
+}
+
+/********************************************************************************
+* write_change: Writes specified change as the new vector value followed by
+*               the wires of the pins that changed. Called by the host thread
+*               only, which also keeps track of the last written timestamp.
+*
+*               - change: Reference to the change.
+********************************************************************************/
+static void write_change(const struct vcd_change* change)
+{
+   const uint8_t toggled = change->value ^ change->previous;
+   char vector[9];
+
+   if (change->cycle != last_cycle)
+   {
+      fprintf(output, "#%llu\n", (unsigned long long)(change->cycle * VCD_PS_PER_CYCLE));
+      last_cycle = change->cycle;
+   }
+
+   for (int bit = 0; bit < 8; ++bit)
+   {
+      vector[7 - bit] = read(change->value, bit) ? '1' : '0';
+   }
+   vector[8] = '\0';
+   fprintf(output, "b%s %c\n", vector, identifier(change->port, -1));
+
+   for (int bit = 0; bit < 8; ++bit)
+   {
+      if (read(toggled, bit))
+      {
+         fprintf(output, "%c%c\n", read(change->value, bit) ? '1' : '0', identifier(change->port, bit));
+      }
+   }
+   return;
+}
+
+/********************************************************************************
+* record: Passes a change of specified port to the host thread. If the ring
+*         buffer is full, the CPU thread waits for the host thread to catch up.
+*
+*         - port : Index of the port.
+*         - value: The new value of the port.
+*         - cycle: Clock cycle of the change, including the time offset.
+********************************************************************************/
+static void record(const uint8_t port,
+                   const uint8_t value,
+                   const uint64_t cycle)
+{
+   struct vcd_change change = { 0 };
+   change.cycle = cycle;
+   change.port = port;
+   change.value = value;
+   change.previous = last_values[port];
+   last_values[port] = value;
+
+   while (ring_buffer_write(&changes, &change, sizeof(change)))
+   {
+      host_sleep_ms(1);
+   }
+   return;
+}
+
+/********************************************************************************
+* write_port: Hook for writes to the I/O ports, which records the write only
+*             if the port value changed.
+*
+*             - address: The written I/O port.
+*             - value  : The value written by the CPU.
+********************************************************************************/
+static uint8_t write_port(const uint16_t address,
+                          const uint8_t value)
+{
+   const uint8_t port = address == PORTB ? 0 : address == PORTC ? 1 : 2;
+
+   if (value != last_values[port])
+   {
+      record(port, value, time_offset + control_unit_cycle_count());
+   }
+   return value;
+}
+
+/********************************************************************************
+* writer_run: Runs the host thread, which formats recorded changes from the
+*             ring buffer in batches and writes them to the VCD file. The
+*             thread finishes when stopped and all changes have been written.
+*
+*             - arg: Not used.
+********************************************************************************/
+static void writer_run(void* arg)
+{
+   struct vcd_change chunk[VCD_CHANGES_CHUNK];
+   (void)arg;
+
+   while (1)
+   {
+      const size_t size = ring_buffer_read(&changes, chunk, sizeof(chunk));
+
+      if (size)
+      {
+         for (size_t i = 0; i < size / sizeof(struct vcd_change); ++i)
+         {
+            write_change(&chunk[i]);
+         }
+      }
+      else if (host_atomic_load(&writer_stop) && !ring_buffer_used(&changes))
+      {
+         break;
+      }
+      else
+      {
+         host_sleep_ms(1);
+      }
+   }
+
+   fflush(output);
+   return;
+}
@@ -0,0 +1,45 @@
+/********************************************************************************
+* vcd.h: Contains function declarations for recording of the I/O ports
+*        PORTB, PORTC and PORTD to a value change dump (VCD) file, which can
+*        be viewed as waveforms in for instance GTKWave. Only changes are
+*        recorded, timestamped with the cycle counter of the control unit,
+*        so idle periods cost nothing. The changes are passed via a bounded
+*        ring buffer to a host thread, which formats and writes the file.
+********************************************************************************/
+#ifndef VCD_H_
+#define VCD_H_
+
+/* Include directives: */
+#include "cpu.h"
+#include "data_memory.h"
+
+/* Macro definitions: */
+#define VCD_BUFFER_SIZE 1048576 /* Capacity in bytes of the ring buffer for changes. */
+
+/********************************************************************************
+* vcd_open: Starts recording of the I/O ports to specified file. If the file
+*           name ends with ".gz", the output is compressed by piping it
+*           through gzip on the host. The current port values are dumped as
+*           initial values. After success, 0 is returned. If the file couldn't
+*           be opened or recording is already in progress, error code 1 is
+*           returned.
+*
+*           - path: Path to the VCD file.
+********************************************************************************/
+int vcd_open(const char* path);
+
+/********************************************************************************
+* vcd_reset: Records that all ports are cleared by a reset of the control unit
+*            and accumulates the elapsed cycles, so that the timestamps keep
+*            increasing when the cycle counter restarts from zero. Must be
+*            called before the cycle counter is cleared.
+********************************************************************************/
+void vcd_reset(void);
+
+/********************************************************************************
+* vcd_close: Writes all recorded changes, stops the host thread, closes the
+*            file and detaches the recorder from the I/O ports.
+********************************************************************************/
+void vcd_close(void);
+
+#endif /* VCD_H_ */